@@ -1,3 +1,204 @@
 const tonlib = require(`./build/lib/tonlib-js.abi-${process.versions.modules}`);
 
+// Submission ring layout, must match `submission_ring.hpp`
+const RING_MAGIC = 0x524a5354;
+const RING_HEADER_WORDS = 16;
+const RING_SLOT_WORDS = 4;
+const WORD_MAGIC = 0;
+const WORD_SLOT_COUNT = 1;
+const WORD_SLOT_SIZE = 2;
+const WORD_TAIL = 3;
+const WORD_COMPLETIONS = 4;
+const WORD_CLOSED = 5;
+const WORD_SUBMISSIONS = 6;
+const SLOT_SEQUENCE = 0;
+const SLOT_REQUEST_LENGTH = 1;
+const SLOT_RESPONSE_LENGTH = 2;
+// Offsets of the slot sequence from the position of its request
+const STAGE_SUBMITTED = 1;
+const STAGE_COMPLETED = 2;
+const CLOSED_CHECK_INTERVAL_MS = 100;
+
+function submissionRingSize(slots, slotSize) {
+  return (RING_HEADER_WORDS + slots * RING_SLOT_WORDS) * 4 + 2 * slots * slotSize;
+}
+
+// Creates a shared buffer and attaches it to the client. The buffer can be sent to worker threads
+function createSubmissionRing(client, options = {}) {
+  const slots = options.slots != null ? options.slots : 1024;
+  const slotSize = options.slotSize != null ? options.slotSize : 16384;
+  const buffer = new SharedArrayBuffer(submissionRingSize(slots, slotSize));
+  const words = new Int32Array(buffer);
+  // Producers notify `Submissions`, so the ring is scanned on demand instead of being polled while idle
+  const wakeable = typeof Atomics.waitAsync === 'function';
+  const defaults = wakeable ? { pollIntervalMs: 0 } : {};
+  const ring = client.attachSubmissionRing(words, Object.assign(defaults, options, { slots, slotSize }));
+
+  let closed = false;
+  if (wakeable) {
+    (async () => {
+      let seen = Atomics.load(words, WORD_SUBMISSIONS);
+      while (!closed) {
+        const result = Atomics.waitAsync(words, WORD_SUBMISSIONS, seen);
+        if (result.async) {
+          await result.value;
+        }
+        if (closed) {
+          break;
+        }
+        // Submissions made after this load wake the next wait right away
+        seen = Atomics.load(words, WORD_SUBMISSIONS);
+        ring.wake();
+      }
+    })();
+  }
+  return {
+    buffer,
+    close: () => {
+      closed = true;
+      Atomics.notify(words, WORD_SUBMISSIONS);
+      ring.close();
+    }
+  };
+}
+
+// Issues requests through a submission ring. Blocks the calling thread, so it is intended for worker threads.
+// Several requests may be outstanding: `submit` returns a ticket, `collect` waits for its response
+class SubmissionRingProducer {
+  constructor(buffer) {
+    this.words = new Int32Array(buffer);
+    this.bytes = new Uint8Array(buffer);
+    if (Atomics.load(this.words, WORD_MAGIC) !== RING_MAGIC) {
+      throw new Error('Submission ring is not initialized');
+    }
+    this.slots = this.words[WORD_SLOT_COUNT];
+    this.slotSize = this.words[WORD_SLOT_SIZE];
+    this.requestsOffset = (RING_HEADER_WORDS + this.slots * RING_SLOT_WORDS) * 4;
+    this.responsesOffset = this.requestsOffset + this.slots * this.slotSize;
+    // Uncollected tickets by slot, and responses collected early by ticket
+    this.outstanding = new Map();
+    this.collected = new Map();
+  }
+
+  // Sends a serialized request and returns a copy of the serialized response
+  request(data) {
+    return this.collect(this.submit(data));
+  }
+
+  // Sends a serialized request without waiting for its response and returns a ticket for `collect`.
+  // Responses which are not collected within the `stallTimeoutMs` of the ring are dropped
+  submit(data) {
+    if (data.byteLength > this.slotSize) {
+      throw new Error(`Request is too large: ${data.byteLength} bytes`);
+    }
+    const position = Atomics.add(this.words, WORD_TAIL, 1) >>> 0;
+    const slot = position % this.slots;
+    const sequence = this._sequence(slot);
+
+    // Sequences are raw int32 words which wrap around together with positions.
+    // The slot is ours once the producer of the previous round has taken its response. That may be
+    // another producer waiting for a slot we hold, so our responses are copied out before waiting
+    let stashed = false;
+    while (true) {
+      const current = Atomics.load(this.words, sequence);
+      const distance = (current - position) | 0;
+      if (distance === 0 && !this.outstanding.has(slot)) {
+        break;
+      }
+      if (!stashed) {
+        stashed = true;
+        this._collectOutstanding();
+        continue;
+      }
+      if (distance > 0) {
+        // The ring gave up on the position, `collect` reports it
+        this.outstanding.set(slot, position);
+        return position;
+      }
+      this._wait(sequence, current);
+    }
+    this.outstanding.set(slot, position);
+
+    this.bytes.set(new Uint8Array(data.buffer || data, data.byteOffset || 0, data.byteLength), this.requestsOffset + slot * this.slotSize);
+    Atomics.store(this.words, RING_HEADER_WORDS + slot * RING_SLOT_WORDS + SLOT_REQUEST_LENGTH, data.byteLength);
+    // Fails only when the ring gave up on the position while the request was written
+    if (Atomics.compareExchange(this.words, sequence, position | 0, (position + STAGE_SUBMITTED) | 0) === (position | 0)) {
+      Atomics.add(this.words, WORD_SUBMISSIONS, 1);
+      Atomics.notify(this.words, WORD_SUBMISSIONS);
+    }
+    return position;
+  }
+
+  // Waits for the response of a ticket returned by `submit` and returns a copy of it
+  collect(ticket) {
+    if (this.collected.has(ticket)) {
+      const response = this.collected.get(ticket);
+      this.collected.delete(ticket);
+      if (response instanceof Error) {
+        throw response;
+      }
+      return response;
+    }
+    const slot = ticket % this.slots;
+    if (this.outstanding.get(slot) !== ticket) {
+      throw new Error('Unknown submission ring ticket');
+    }
+    this.outstanding.delete(slot);
+    return this._collect(ticket);
+  }
+
+  // Copies out the responses of all outstanding tickets, which completes without other producers
+  _collectOutstanding() {
+    for (const ticket of this.outstanding.values()) {
+      try {
+        this.collected.set(ticket, this._collect(ticket));
+      } catch (e) {
+        this.collected.set(ticket, e);
+      }
+    }
+    this.outstanding.clear();
+  }
+
+  _collect(position) {
+    const slot = position % this.slots;
+    const sequence = this._sequence(slot);
+    const completed = (position + STAGE_COMPLETED) | 0;
+    while (true) {
+      const completions = Atomics.load(this.words, WORD_COMPLETIONS);
+      const distance = (Atomics.load(this.words, sequence) - position) | 0;
+      if (distance === STAGE_COMPLETED) {
+        break;
+      }
+      if (distance >= this.slots) {
+        throw new Error('Response was dropped before it was collected');
+      }
+      this._wait(WORD_COMPLETIONS, completions);
+    }
+
+    const length = Atomics.load(this.words, RING_HEADER_WORDS + slot * RING_SLOT_WORDS + SLOT_RESPONSE_LENGTH);
+    const offset = this.responsesOffset + slot * this.slotSize;
+    const response = this.bytes.slice(offset, offset + length);
+    if (Atomics.compareExchange(this.words, sequence, completed, (position + this.slots) | 0) !== completed) {
+      throw new Error('Response was dropped before it was collected');
+    }
+    Atomics.notify(this.words, sequence);
+    return response;
+  }
+
+  _sequence(slot) {
+    return RING_HEADER_WORDS + slot * RING_SLOT_WORDS + SLOT_SEQUENCE;
+  }
+
+  _wait(index, value) {
+    if (Atomics.load(this.words, WORD_CLOSED) !== 0) {
+      throw new Error('Submission ring is closed');
+    }
+    // Waiters for free slots are not woken on close, so the flag is rechecked periodically
+    Atomics.wait(this.words, index, value, CLOSED_CHECK_INTERVAL_MS);
+  }
+}
+
+tonlib.createSubmissionRing = createSubmissionRing;
+tonlib.SubmissionRingProducer = SubmissionRingProducer;
+
 module.exports = tonlib;
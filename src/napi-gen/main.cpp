@@ -76,13 +76,13 @@ auto tl_type_to_js(const td::tl::simple::Type* arg_type) -> std::string
         case td::tl::simple::Type::SecureBytes:
         case td::tl::simple::Type::Int128:
         case td::tl::simple::Type::Int256:
-            return "ArrayBuffer";
+            return "ArrayBuffer | string";
         case td::tl::simple::Type::Bool:
             return "boolean";
         case td::tl::simple::Type::True:
             return "true";
         case td::tl::simple::Type::Custom: {
-            return "null | " + gen_js_class_name(arg_type->custom->name);
+            return "null | NativeHandle | " + gen_js_class_name(arg_type->custom->name);
         }
         case td::tl::simple::Type::Vector:
             return tl_type_to_js(arg_type->vector_value_type) + "[]";
@@ -168,13 +168,17 @@ void gen_to_napi_constructor(td::StringBuilder& sb, const T* constructor, bool i
         return;
     }
 
-    sb << "  auto props = Napi::Object::New(env);\n";
+    sb << "  auto props = Napi::Object::New(env);\n"
+       << "  const auto* fields = current_napi_fields;\n";
 
     for (auto& arg : constructor->args) {
         const auto js_field = gen_js_field_name(arg.name);
         const auto field = td::tl::simple::gen_cpp_field_name(arg.name);
         const bool is_custom = arg.type->type == td::tl::simple::Type::Custom;
 
+        // Unselected fields are skipped before any of their values are created
+        sb << "  if (NapiFieldScope scope{fields, \"" << js_field << "\"}; scope) {\n";
+
         if (is_custom) {
             sb << "  if (data." << field << ") {\n  ";
         }
@@ -202,6 +206,8 @@ void gen_to_napi_constructor(td::StringBuilder& sb, const T* constructor, bool i
             sb << "    props.Set(\"" << js_field << "\", env.Null());\n";
             sb << "  }\n";
         }
+
+        sb << "  }\n";
     }
 
     sb << "  return " << js_class_name << "::constructor->New({props});\n";
@@ -436,6 +442,200 @@ void gen_napi_converter_file(const td::tl::simple::Schema& schema, const std::st
     }
 }
 
+template <class T>
+void gen_tl_clone_constructor(td::StringBuilder& sb, const T* constructor, bool is_header)
+{
+    const auto cpp_name = PSTRING() << "ton::" << tl_name << "::" << td::tl::simple::gen_cpp_name(constructor->name);
+    sb << "auto tl_clone(const " << cpp_name << "& from) -> ton::tl_object_ptr<" << cpp_name << ">";
+    if (is_header) {
+        sb << ";\n";
+        return;
+    }
+
+    sb << "\n{\n"
+       << "  auto to = ton::create_tl_object<" << cpp_name << ">();\n";
+    for (const auto& arg : constructor->args) {
+        const auto field = td::tl::simple::gen_cpp_field_name(arg.name);
+        sb << "  to->" << field << " = tl_clone_field(from." << field << ");\n";
+    }
+    sb << "  return to;\n"
+       << "}\n";
+}
+
+void gen_tl_clone_downcast(td::StringBuilder& sb, const std::string& type_name, bool is_header)
+{
+    const auto cpp_name = PSTRING() << "ton::" << tl_name << "::" << type_name;
+    sb << "auto tl_clone(const " << cpp_name << "& from) -> ton::tl_object_ptr<" << cpp_name << ">";
+    if (is_header) {
+        sb << ";\n";
+        return;
+    }
+
+    sb << "\n{\n"
+       << "  ton::tl_object_ptr<" << cpp_name << "> res;\n"
+       << "  ton::" << tl_name << "::downcast_call(const_cast<" << cpp_name << "&>(from), [&res](const auto& x) { res = tl_clone(x); });\n"
+       << "  return res;\n"
+       << "}\n";
+}
+
+void gen_tl_clone(td::StringBuilder& sb, const td::tl::simple::Schema& schema, bool is_header)
+{
+    for (auto* custom_type : schema.custom_types) {
+        for (auto* constructor : custom_type->constructors) {
+            gen_tl_clone_constructor(sb, constructor, is_header);
+        }
+        if (custom_type->constructors.size() > 1) {
+            gen_tl_clone_downcast(sb, td::tl::simple::gen_cpp_name(custom_type->name), is_header);
+        }
+    }
+    for (auto* function : schema.functions) {
+        gen_tl_clone_constructor(sb, function, is_header);
+    }
+    gen_tl_clone_downcast(sb, "Object", is_header);
+    gen_tl_clone_downcast(sb, "Function", is_header);
+}
+
+void gen_tl_get_field_constructor(td::StringBuilder& sb, const td::tl::simple::Constructor* constructor, bool is_header)
+{
+    const auto cpp_name = PSTRING() << "ton::" << tl_name << "::" << td::tl::simple::gen_cpp_name(constructor->name);
+    sb << "auto tl_get_field(const " << cpp_name << "& from, td::Slice name) -> const ton::" << tl_name << "::Object*";
+    if (is_header) {
+        sb << ";\n";
+        return;
+    }
+
+    sb << "\n{\n";
+    for (const auto& arg : constructor->args) {
+        if (arg.type->type != td::tl::simple::Type::Custom) {
+            continue;
+        }
+        sb << "  if (name == td::Slice{\"" << gen_js_field_name(arg.name) << "\"}) {\n"
+           << "    return from." << td::tl::simple::gen_cpp_field_name(arg.name) << ".get();\n"
+           << "  }\n";
+    }
+    sb << "  return nullptr;\n"
+       << "}\n";
+}
+
+void gen_tl_get_field(td::StringBuilder& sb, const td::tl::simple::Schema& schema, bool is_header)
+{
+    for (auto* custom_type : schema.custom_types) {
+        for (auto* constructor : custom_type->constructors) {
+            gen_tl_get_field_constructor(sb, constructor, is_header);
+        }
+    }
+
+    sb << "auto tl_get_field(const ton::" << tl_name << "::Object& from, td::Slice name) -> const ton::" << tl_name << "::Object*";
+    if (is_header) {
+        sb << ";\n";
+        return;
+    }
+    sb << "\n{\n"
+       << "  const ton::" << tl_name << "::Object* res = nullptr;\n"
+       << "  ton::" << tl_name << "::downcast_call(const_cast<ton::" << tl_name
+       << "::Object&>(from), [&res, name](const auto& x) { res = tl_get_field(x, name); });\n"
+       << "  return res;\n"
+       << "}\n";
+}
+
+template <class T>
+void gen_tl_memory_size_constructor(td::StringBuilder& sb, const T* constructor, bool is_header)
+{
+    const auto cpp_name = PSTRING() << "ton::" << tl_name << "::" << td::tl::simple::gen_cpp_name(constructor->name);
+    sb << "auto tl_memory_size(const " << cpp_name << "& from) -> size_t";
+    if (is_header) {
+        sb << ";\n";
+        return;
+    }
+
+    sb << "\n{\n"
+       << "  size_t size = sizeof(" << cpp_name << ");\n";
+    for (const auto& arg : constructor->args) {
+        const auto field = td::tl::simple::gen_cpp_field_name(arg.name);
+        sb << "  size += tl_memory_size_field(from." << field << ");\n";
+    }
+    sb << "  return size;\n"
+       << "}\n";
+}
+
+void gen_tl_memory_size_downcast(td::StringBuilder& sb, const std::string& type_name, bool is_header)
+{
+    const auto cpp_name = PSTRING() << "ton::" << tl_name << "::" << type_name;
+    sb << "auto tl_memory_size(const " << cpp_name << "& from) -> size_t";
+    if (is_header) {
+        sb << ";\n";
+        return;
+    }
+
+    sb << "\n{\n"
+       << "  size_t res = 0;\n"
+       << "  ton::" << tl_name << "::downcast_call(const_cast<" << cpp_name << "&>(from), [&res](const auto& x) { res = tl_memory_size(x); });\n"
+       << "  return res;\n"
+       << "}\n";
+}
+
+void gen_tl_memory_size(td::StringBuilder& sb, const td::tl::simple::Schema& schema, bool is_header)
+{
+    for (auto* custom_type : schema.custom_types) {
+        for (auto* constructor : custom_type->constructors) {
+            gen_tl_memory_size_constructor(sb, constructor, is_header);
+        }
+        if (custom_type->constructors.size() > 1) {
+            gen_tl_memory_size_downcast(sb, td::tl::simple::gen_cpp_name(custom_type->name), is_header);
+        }
+    }
+    for (auto* function : schema.functions) {
+        gen_tl_memory_size_constructor(sb, function, is_header);
+    }
+    gen_tl_memory_size_downcast(sb, "Object", is_header);
+    gen_tl_memory_size_downcast(sb, "Function", is_header);
+}
+
+void gen_tl_utils_file(const td::tl::simple::Schema& schema, const std::string& output_path, const std::string& file_name_base, bool is_header)
+{
+    auto file_name = is_header ? (file_name_base + ".h") : (file_name_base + ".cpp");
+    auto old_file_content = [&] {
+        auto r_content = td::read_file(output_path + "/" + file_name);
+        if (r_content.is_error()) {
+            return td::BufferSlice();
+        }
+        return r_content.move_as_ok();
+    }();
+
+    std::string buf(2000000, ' ');
+    td::StringBuilder sb(td::MutableSlice{buf});
+
+    if (is_header) {
+        sb << "#pragma once\n\n";
+
+        sb << "#include <auto/tl/" << tl_name << ".h>\n";
+        sb << "#include <auto/tl/" << tl_name << ".hpp>\n\n";
+
+        sb << "#include <td/utils/Slice.h>\n";
+        sb << "#include <tl/TlObject.h>\n\n";
+    }
+    else {
+        sb << "#include \"" << file_name_base << ".h\"\n\n";
+
+        sb << "#include \"../tl_utils.hpp\"\n\n";
+    }
+
+    sb << "namespace tjs {\n";
+
+    gen_tl_clone(sb, schema, is_header);
+    gen_tl_get_field(sb, schema, is_header);
+    gen_tl_memory_size(sb, schema, is_header);
+
+    sb << "}  // namespace tjs\n";
+
+    CHECK(!sb.is_error())
+    buf.resize(sb.as_cslice().size());
+    auto new_file_content = std::move(buf);
+    if (new_file_content != old_file_content.as_slice()) {
+        td::write_file(output_path + "/" + file_name, new_file_content).ensure();
+    }
+}
+
 template <typename T>
 void gen_js_type_definition(td::StringBuilder& sb, const T* constructor)
 {
@@ -509,13 +709,245 @@ void gen_js_type_definitions(td::StringBuilder& sb, const td::tl::simple::Schema
 
     //
     sb << "\n"
+          "export type Priority = 'interactive' | 'bulk';\n"
+          "export type BytesEncoding = 'arraybuffer' | 'base64' | 'base64url' | 'hex';\n"
+          "export type TonlibClientOptions = {\n"
+          "  maxInFlight?: number,\n"
+          "  reservedInteractive?: number,\n"
+          "  maxQueueSize?: number,\n"
+          "  pinLiteServers?: boolean,\n"
+          "  hedge?: boolean,\n"
+          "  hedgeQuantile?: number,\n"
+          "  minHedgeDelayMs?: number,\n"
+          "  workerThreads?: number,\n"
+          "  stateFile?: string,\n"
+          "  stateSaveIntervalMs?: number,\n"
+          "  cacheDir?: string,\n"
+          "  cacheMaxSize?: number,\n"
+          "  smcPoolBudget?: number,\n"
+          "  smcPoolMaxAgeMs?: number,\n"
+          "  blockPollIntervalMs?: number,\n"
+          "  bytesEncoding?: BytesEncoding,\n"
+          "  timeSliceMs?: number,\n"
+          "  minSlicedLength?: number,\n"
+          "}\n"
+          "export type FieldMask = { [field: string]: true | FieldMask };\n"
+          "export type SendOptions = {\n"
+          "  priority?: Priority,\n"
+          "  handle?: boolean,\n"
+          "  bytesEncoding?: BytesEncoding,\n"
+          "  timeSliceMs?: number,\n"
+          "  minSlicedLength?: number,\n"
+          "  fields?: string[] | FieldMask,\n"
+          "}\n"
+          "export class NativeHandle {\n"
+          "  constructor(object: " << gen_js_class_name("Object") << ");\n"
+          "  get(field: string): NativeHandle | null;\n"
+          "  toObject(): " << gen_js_class_name("Object") << ";\n"
+          "}\n"
+          "export type IterateTransactionsOptions = SendOptions & {\n"
+          "  prefetchPages?: number,\n"
+          "}\n"
+          "export type ScanBlocksOptions = SendOptions & {\n"
+          "  concurrency?: number,\n"
+          "}\n"
+          "export type ScannedBlockTransactions = {\n"
+          "  id: " << gen_js_class_name("ton.blockIdExt") << ",\n"
+          "  transactions: " << gen_js_class_name("blocks.shortTxId") << "[],\n"
+          "}\n"
+          "export type ScannedBlock = ScannedBlockTransactions & {\n"
+          "  shards: ScannedBlockTransactions[],\n"
+          "}\n"
+          "export type SkippedBlocks = {\n"
+          "  workchain: number,\n"
+          "  shard: string,\n"
+          "  fromSeqno: number,\n"
+          "  toSeqno: number,\n"
+          "}\n"
+          "export type NewBlock = {\n"
+          "  id: " << gen_js_class_name("ton.blockIdExt") << ",\n"
+          "  shards?: " << gen_js_class_name("ton.blockIdExt") << "[],\n"
+          "  skipped?: SkippedBlocks[],\n"
+          "}\n"
+          "export type WatchAccountsOptions = SendOptions & {\n"
+          "  concurrency?: number,\n"
+          "}\n"
+          "export type AccountChanges = {\n"
+          "  block: " << gen_js_class_name("ton.blockIdExt") << ",\n"
+          "  accounts: { address: string, lt: string, hash: ArrayBuffer | string }[],\n"
+          "}\n"
+          "export interface AccountWatcher {\n"
+          "  add(addresses: string[]): void;\n"
+          "  remove(addresses: string[]): void;\n"
+          "  close(): void;\n"
+          "}\n"
+          "export type SubmitMessagesOptions = SendOptions & {\n"
+          "  concurrency?: number,\n"
+          "}\n"
+          "export type SubmitResult = {\n"
+          "  index: number,\n"
+          "  hash: ArrayBuffer | string | null,\n"
+          "  status: 'sent' | 'duplicate' | 'failed',\n"
+          "  duplicateOf?: number,\n"
+          "  error?: string,\n"
+          "}\n"
+          "export type BatchOptions = SendOptions & {\n"
+          "  concurrency?: number,\n"
+          "}\n"
+          "export type GetMethodOptions = SendOptions & {\n"
+          "  stack?: " << gen_js_class_name("tvm.StackEntry") << "[],\n"
+          "}\n"
+          "export type GetMethodBatchOptions = BatchOptions & {\n"
+          "  stack?: " << gen_js_class_name("tvm.StackEntry") << "[],\n"
+          "}\n"
+          "export type AccountsSnapshotOptions = BatchOptions & {\n"
+          "  block?: " << gen_js_class_name("ton.blockIdExt") << ",\n"
+          "}\n"
+          "export type SnapshotAccount = {\n"
+          "  shard: " << gen_js_class_name("ton.blockIdExt") << ",\n"
+          "  state: " << gen_js_class_name("raw.fullAccountState") << ",\n"
+          "}\n"
+          "export type AccountsSnapshot = {\n"
+          "  block: " << gen_js_class_name("ton.blockIdExt") << ",\n"
+          "  shards: " << gen_js_class_name("ton.blockIdExt") << "[],\n"
+          "  accounts: Settled<SnapshotAccount>[],\n"
+          "}\n"
+          "export type RunLocalCall = {\n"
+          "  address: string,\n"
+          "  call: " << gen_js_class_name("ftabi.FunctionCall") << ",\n"
+          "}\n"
+          "export type Settled<T> = { status: 'fulfilled', value: T } | { status: 'rejected', reason: Error };\n"
+          "export type ConversionOptions = {\n"
+          "  bytesEncoding?: BytesEncoding,\n"
+          "  timeSliceMs?: number,\n"
+          "  minSlicedLength?: number,\n"
+          "}\n"
+          "export type AbiMessage = {\n"
+          "  body: ArrayBuffer | string,\n"
+          "  internal?: boolean,\n"
+          "  output?: boolean,\n"
+          "}\n"
+          "export type DecodedMessage = {\n"
+          "  function: string,\n"
+          "  output: boolean,\n"
+          "  values: " << gen_js_class_name("Object") << ",\n"
+          "}\n"
+          "export type GeneratedKeyPair = {\n"
+          "  publicKey: string,\n"
+          "  privateKey: ArrayBuffer | string,\n"
+          "}\n"
+          "export type SignRequest = {\n"
+          "  privateKey: ArrayBuffer | string,\n"
+          "  data: ArrayBuffer | string,\n"
+          "}\n"
+          "export type LaneStats = {\n"
+          "  queued: number,\n"
+          "  inFlight: number,\n"
+          "  started: number,\n"
+          "  rejected: number,\n"
+          "  avgWaitMs: number,\n"
+          "  maxWaitMs: number,\n"
+          "}\n"
+          "export type BackendStats = {\n"
+          "  ready: boolean,\n"
+          "  outstanding: number,\n"
+          "  completed: number,\n"
+          "  errors: number,\n"
+          "  avgLatencyMs: number,\n"
+          "}\n"
+          "export type MemoryStats = {\n"
+          "  requests: number,\n"
+          "  responses: number,\n"
+          "  handles: number,\n"
+          "  total: number,\n"
+          "  peak: number,\n"
+          "}\n"
+          "export type SmcPoolStats = {\n"
+          "  entries: number,\n"
+          "  bytes: number,\n"
+          "  hits: number,\n"
+          "  misses: number,\n"
+          "  evictions: number,\n"
+          "  invalidations: number,\n"
+          "}\n"
+          "export type ClientStats = {\n"
+          "  interactive: LaneStats,\n"
+          "  bulk: LaneStats,\n"
+          "  backends: BackendStats[],\n"
+          "  hedged: number,\n"
+          "  hedgeWins: number,\n"
+          "  hedgeDelayMs: number,\n"
+          "  cacheHits: number,\n"
+          "  cacheMisses: number,\n"
+          "  memory: MemoryStats,\n"
+          "  smcPool: SmcPoolStats,\n"
+          "}\n"
+          "export type SubmissionRingOptions = {\n"
+          "  priority?: Priority,\n"
+          "  slots?: number,\n"
+          "  slotSize?: number,\n"
+          "  pollIntervalMs?: number,\n"
+          "  stallTimeoutMs?: number,\n"
+          "}\n"
+          "export interface SubmissionRing {\n"
+          "  wake(): void;\n"
+          "  close(): void;\n"
+          "}\n"
+          "export function createSubmissionRing(client: TonlibClient, options?: SubmissionRingOptions): { buffer: SharedArrayBuffer, close(): void };\n"
+          "export class SubmissionRingProducer {\n"
+          "  constructor(buffer: SharedArrayBuffer);\n"
+          "  request(data: ArrayBuffer | Uint8Array): Uint8Array;\n"
+          "  submit(data: ArrayBuffer | Uint8Array): number;\n"
+          "  collect(ticket: number): Uint8Array;\n"
+          "}\n"
+          "export type LogRecord = {\n"
+          "  clientId: number,\n"
+          "  level: number,\n"
+          "  time: number,\n"
+          "  message: string,\n"
+          "}\n"
+          "export function setLogHandler(handler: ((records: LogRecord[]) => void) | null): void;\n"
+          "export function setLogVerbosity(level: number): void;\n"
+          "export function getLogStats(): { delivered: number, dropped: number };\n"
+          "\n"
           "export class TonlibClient {\n"
-          "    constructor();\n";
+          "    constructor(options?: TonlibClientOptions);\n";
+    sb << "    send(request: " << gen_js_class_name("Function") << ", options: SendOptions & { handle: true }): Promise<NativeHandle>;\n";
     for (const auto* item : schema.functions) {
         const auto type = tl_type_to_js(item->type);
-        sb << "    send(request: " << gen_js_class_name(item->name) << "): Promise<" << type << ">;\n";
+        sb << "    send(request: " << gen_js_class_name(item->name) << ", options?: SendOptions): Promise<" << type << ">;\n";
+    }
+    sb << "    ready(): Promise<" << gen_js_class_name("ton.blockIdExt") << ">;\n";
+    sb << "    iterateTransactions(request: " << gen_js_class_name("raw.getTransactions")
+       << ", options?: IterateTransactionsOptions): AsyncIterableIterator<" << gen_js_class_name("raw.transaction") << ">;\n";
+    sb << "    scanBlocks(fromSeqno: number, toSeqno: number, options?: ScanBlocksOptions): AsyncIterableIterator<ScannedBlock>;\n";
+    sb << "    subscribeBlocks(listener: (block: NewBlock) => void, options?: { shards?: boolean }): () => void;\n";
+    sb << "    watchAccounts(listener: (changes: AccountChanges) => void, options?: WatchAccountsOptions): AccountWatcher;\n";
+    sb << "    submitMessages(messages: (ArrayBuffer | string)[], options?: SubmitMessagesOptions): AsyncIterableIterator<SubmitResult>;\n";
+    sb << "    runGetMethod(address: string, method: string, options?: GetMethodOptions): Promise<" << gen_js_class_name("smc.runResult") << ">;\n";
+    sb << "    runGetMethodBatch(method: string, addresses: string[], options?: GetMethodBatchOptions): Promise<Settled<"
+       << gen_js_class_name("smc.runResult") << ">[]>;\n";
+    sb << "    getAccountsSnapshot(addresses: string[], options?: AccountsSnapshotOptions): Promise<AccountsSnapshot>;\n";
+    for (const auto* item : schema.functions) {
+        if (item->name == "ftabi.runLocal") {
+            sb << "    runLocalBatch(fn: " << gen_js_class_name("ftabi.function") << " | NativeHandle, calls: RunLocalCall[], options?: BatchOptions): Promise<Settled<"
+               << tl_type_to_js(item->type) << ">[]>;\n";
+        }
     }
-    sb << "    execute(request: " << gen_js_class_name("Object") << "): object;\n";
+    sb << "    generateKeyPairs(count: number, options?: ConversionOptions): Promise<GeneratedKeyPair[]>;\n";
+    sb << "    signBatch(requests: SignRequest[], options?: ConversionOptions): Promise<Settled<ArrayBuffer | string>[]>;\n";
+    sb << "    executeBatch(requests: " << gen_js_class_name("Function") << "[], options?: ConversionOptions): Promise<Settled<"
+       << gen_js_class_name("Object") << ">[]>;\n";
+    sb << "    decodeMessages(abi: string, messages: AbiMessage[], options?: ConversionOptions): Promise<Settled<DecodedMessage>[]>;\n";
+    sb << "    decodeTransactions(abi: string, transactions: (" << gen_js_class_name("raw.transaction")
+       << " | NativeHandle)[], options?: ConversionOptions): Promise<Settled<DecodedMessage>[][]>;\n";
+    sb << "    attachSubmissionRing(array: Int32Array, options?: SubmissionRingOptions): SubmissionRing;\n";
+    sb << "    stats(): ClientStats;\n";
+    sb << "    readonly id: number;\n";
+    sb << "    setLogVerbosity(level: number): void;\n";
+    sb << "    execute(request: " << gen_js_class_name("Object") << ", options?: { bytesEncoding?: BytesEncoding }): object;\n";
+    sb << "    static serialize(request: " << gen_js_class_name("Function") << ", options?: { bytesEncoding?: BytesEncoding }): ArrayBuffer | string;\n";
+    sb << "    static deserialize(data: ArrayBuffer | string, options?: { bytesEncoding?: BytesEncoding }): " << gen_js_class_name("Object") << ";\n";
     sb << "}\n\n";
 }
 
@@ -552,6 +984,10 @@ auto main(int argc, char** argv) -> int
     tjs::gen_napi_converter_file(schema, napi_output_path, cpp_file_name, true);
     tjs::gen_napi_converter_file(schema, napi_output_path, cpp_file_name, false);
 
+    const auto tl_utils_file_name = "tonlib_tl";
+    tjs::gen_tl_utils_file(schema, napi_output_path, tl_utils_file_name, true);
+    tjs::gen_tl_utils_file(schema, napi_output_path, tl_utils_file_name, false);
+
     tjs::gen_js_type_definitions_file(schema, ts_output_path);
 
     return 0;
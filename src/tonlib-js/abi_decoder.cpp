@@ -0,0 +1,253 @@
+#include "abi_decoder.hpp"
+
+#include <td/utils/JsonBuilder.h>
+#include <vm/boc.h>
+#include <vm/cellslice.h>
+
+#include <algorithm>
+#include <optional>
+
+#include "tl_utils.hpp"
+#include "worker_pool.hpp"
+
+namespace tjs
+{
+namespace
+{
+// Decoding takes tens of microseconds, so the messages are grouped to amortize scheduling
+constexpr size_t decode_chunk_size = 32;
+
+auto get_function_names(const std::string& abi) -> td::Result<std::vector<std::string>>
+{
+    std::string buffer = abi;
+    TRY_RESULT(json, td::json_decode(td::MutableSlice{buffer}))
+    if (json.type() != td::JsonValue::Type::Object) {
+        return td::Status::Error("Expected ABI object");
+    }
+
+    std::vector<std::string> names;
+    for (auto& field : json.get_object()) {
+        if (field.first != td::Slice{"functions"} || field.second.type() != td::JsonValue::Type::Array) {
+            continue;
+        }
+        for (auto& function : field.second.get_array()) {
+            if (function.type() != td::JsonValue::Type::Object) {
+                return td::Status::Error("Expected ABI function object");
+            }
+            for (auto& function_field : function.get_object()) {
+                if (function_field.first == td::Slice{"name"} && function_field.second.type() == td::JsonValue::Type::String) {
+                    names.emplace_back(function_field.second.get_string().str());
+                }
+            }
+        }
+    }
+    if (names.empty()) {
+        return td::Status::Error("ABI has no functions");
+    }
+    return std::move(names);
+}
+
+auto execute(Client::Request request) -> td::Result<Client::Response>
+{
+    auto response = Client::execute(std::move(request));
+    if (response == nullptr) {
+        return td::Status::Error("Empty response");
+    }
+    if (response->get_id() == tonlib_api::error::ID) {
+        const auto& error = static_cast<const tonlib_api::error&>(*response);
+        return td::Status::Error(error.code_, error.message_);
+    }
+    return std::move(response);
+}
+
+// Bodies of internal messages and outputs start with the function id. Inputs of
+// external messages have a header before it, which depends on the ABI
+auto get_function_id(const AbiMessage& message) -> std::optional<uint32_t>
+{
+    if (!message.internal && !message.output) {
+        return std::nullopt;
+    }
+    auto r_cell = vm::std_boc_deserialize(message.body);
+    if (r_cell.is_error()) {
+        return std::nullopt;
+    }
+    auto slice = vm::load_cell_slice(r_cell.move_as_ok());
+    if (slice.size() < 32) {
+        return std::nullopt;
+    }
+    return static_cast<uint32_t>(slice.prefetch_ulong(32));
+}
+
+}  // namespace
+
+// Thread-safe, shared by all requests with the same ABI
+class AbiDecoder final {
+public:
+    AbiDecoder(std::vector<std::string> names, std::vector<tonlib_api::object_ptr<tonlib_api::ftabi_function>> functions)
+        : names_{std::move(names)}
+        , functions_{std::move(functions)}
+    {
+    }
+
+    auto decode(const AbiMessage& message) -> td::Result<DecodedMessage>
+    {
+        const auto id = get_function_id(message);
+        if (id.has_value()) {
+            if (const auto index = find_known(*id, message.output); index.has_value()) {
+                return decode_with(message, *index);
+            }
+        }
+
+        // Functions are matched by trying them in order until the first one
+        // which accepts the body, then the id of the body is remembered. Ids
+        // without a match are not, since any malformed body would add one
+        for (size_t index = 0; index < functions_.size(); ++index) {
+            auto r_decoded = decode_with(message, index);
+            if (r_decoded.is_ok()) {
+                if (id.has_value()) {
+                    remember(*id, message.output, index);
+                }
+                return r_decoded;
+            }
+        }
+        return td::Status::Error("No matching function");
+    }
+
+private:
+    static auto known_key(uint32_t id, bool output) -> uint64_t { return (static_cast<uint64_t>(output) << 32) | id; }
+
+    auto find_known(uint32_t id, bool output) -> std::optional<size_t>
+    {
+        std::lock_guard<std::mutex> guard{mutex_};
+        const auto it = known_.find(known_key(id, output));
+        if (it == known_.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    void remember(uint32_t id, bool output, size_t index)
+    {
+        std::lock_guard<std::mutex> guard{mutex_};
+        known_.emplace(known_key(id, output), index);
+    }
+
+    auto decode_with(const AbiMessage& message, size_t index) const -> td::Result<DecodedMessage>
+    {
+        Client::Request request;
+        if (message.output) {
+            request = tonlib_api::make_object<tonlib_api::ftabi_decodeOutput>(tl_clone(*functions_[index]), message.body);
+        }
+        else {
+            request = tonlib_api::make_object<tonlib_api::ftabi_decodeInput>(tl_clone(*functions_[index]), message.body, message.internal);
+        }
+        TRY_RESULT(values, execute(std::move(request)))
+        return DecodedMessage{names_[index], message.output, std::move(values)};
+    }
+
+    std::vector<std::string> names_;
+    std::vector<tonlib_api::object_ptr<tonlib_api::ftabi_function>> functions_;
+
+    std::mutex mutex_;  // for known_
+    std::unordered_map<uint64_t, size_t> known_;
+};
+
+namespace
+{
+auto create_decoder(const std::string& abi) -> td::Result<std::shared_ptr<AbiDecoder>>
+{
+    TRY_RESULT(names, get_function_names(abi))
+
+    std::vector<tonlib_api::object_ptr<tonlib_api::ftabi_function>> functions;
+    functions.reserve(names.size());
+    for (const auto& name : names) {
+        TRY_RESULT_PREFIX(function, execute(tonlib_api::make_object<tonlib_api::ftabi_getFunction>(abi, name)),
+                          PSLICE() << "Invalid function " << name << ": ")
+        if (function->get_id() != tonlib_api::ftabi_function::ID) {
+            return td::Status::Error(PSLICE() << "Unexpected function object for " << name);
+        }
+        functions.emplace_back(ton::move_tl_object_as<tonlib_api::ftabi_function>(function));
+    }
+    return std::make_shared<AbiDecoder>(std::move(names), std::move(functions));
+}
+
+auto get_body(const tonlib_api::object_ptr<tonlib_api::raw_message>& message) -> const std::string*
+{
+    if (message == nullptr || message->msg_data_ == nullptr || message->msg_data_->get_id() != tonlib_api::msg_dataRaw::ID) {
+        return nullptr;
+    }
+    const auto& body = static_cast<const tonlib_api::msg_dataRaw&>(*message->msg_data_).body_;
+    return body.empty() ? nullptr : &body;
+}
+
+auto has_address(const tonlib_api::object_ptr<tonlib_api::accountAddress>& address) -> bool
+{
+    return address != nullptr && !address->account_address_.empty();
+}
+
+}  // namespace
+
+auto transaction_messages(const tonlib_api::raw_transaction& transaction) -> std::vector<AbiMessage>
+{
+    std::vector<AbiMessage> messages;
+    if (const auto* body = get_body(transaction.in_msg_); body != nullptr) {
+        messages.emplace_back(AbiMessage{*body, has_address(transaction.in_msg_->source_), false});
+    }
+    for (const auto& out_msg : transaction.out_msgs_) {
+        // Internal outbound messages are calls of other contracts, which usually have a different ABI
+        if (const auto* body = get_body(out_msg); body != nullptr && !has_address(out_msg->destination_)) {
+            messages.emplace_back(AbiMessage{*body, false, true});
+        }
+    }
+    return messages;
+}
+
+AbiDecoderCache::AbiDecoderCache(size_t capacity)
+    : capacity_{std::max<size_t>(capacity, 1)}
+{
+}
+
+auto AbiDecoderCache::get(const std::string& abi) -> td::Result<std::shared_ptr<AbiDecoder>>
+{
+    {
+        std::lock_guard<std::mutex> guard{mutex_};
+        if (auto it = entries_.find(abi); it != entries_.end()) {
+            order_.splice(order_.begin(), order_, it->second.position);
+            return it->second.decoder;
+        }
+    }
+
+    // Parsed without the lock, concurrent misses of one ABI keep the decoder which was stored first
+    TRY_RESULT(decoder, create_decoder(abi))
+
+    std::lock_guard<std::mutex> guard{mutex_};
+    if (auto it = entries_.find(abi); it != entries_.end()) {
+        return it->second.decoder;
+    }
+    order_.push_front(abi);
+    entries_.emplace(abi, Entry{decoder, order_.begin()});
+    while (entries_.size() > capacity_) {
+        entries_.erase(order_.back());
+        order_.pop_back();
+    }
+    return std::move(decoder);
+}
+
+void decode_messages(const std::shared_ptr<WorkerPool>& workers, const std::shared_ptr<AbiDecoderCache>& decoders, std::string abi,
+                     std::vector<AbiMessage>&& messages, td::Promise<DecodedMessages>&& promise)
+{
+    auto items = std::make_shared<const std::vector<AbiMessage>>(std::move(messages));
+    workers->run<std::shared_ptr<AbiDecoder>>(
+        [decoders, abi = std::move(abi)]() { return decoders->get(abi); },
+        td::PromiseCreator::lambda([workers, items, promise = std::move(promise)](td::Result<std::shared_ptr<AbiDecoder>> r_decoder) mutable {
+            if (r_decoder.is_error()) {
+                promise.set_error(r_decoder.move_as_error());
+                return;
+            }
+            workers->map<DecodedMessage>(
+                items->size(), decode_chunk_size, [decoder = r_decoder.move_as_ok(), items](size_t i) { return decoder->decode((*items)[i]); },
+                std::move(promise));
+        }));
+}
+
+}  // namespace tjs
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <td/utils/Status.h>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "client.hpp"
+#include "tl_utils.hpp"
+#include "worker_pool.hpp"
+
+namespace tjs
+{
+struct AbiMessage {
+    // BOC of the message body
+    std::string body;
+    // Inbound message from another contract, which has no external message header
+    bool internal{false};
+    // Outbound external message of the contract, decoded as the output of a function
+    bool output{false};
+};
+
+struct DecodedMessage {
+    std::string function;
+    bool output{false};
+    // `ftabi.decodedInput` or `ftabi.decodedOutput`
+    Client::Response values;
+};
+
+inline auto tl_memory_size_field(const AbiMessage& message) -> size_t
+{
+    return tl_memory_size_field(message.body);
+}
+
+inline auto tl_memory_size_field(const DecodedMessage& message) -> size_t
+{
+    return tl_memory_size_field(message.function) + tl_memory_size_field(message.values);
+}
+
+using DecodedMessages = std::vector<td::Result<DecodedMessage>>;
+
+class AbiDecoder;
+
+// Decoders of recently used ABIs. A decoder keeps the function ids it has
+// matched, so later messages of the same ABI skip trying every function
+class AbiDecoderCache final {
+public:
+    static constexpr size_t default_capacity = 32;
+
+    explicit AbiDecoderCache(size_t capacity = default_capacity);
+
+    // Parses the ABI on a miss, so it must be called on a worker thread
+    auto get(const std::string& abi) -> td::Result<std::shared_ptr<AbiDecoder>>;
+
+private:
+    using Order = std::list<std::string>;
+    struct Entry {
+        std::shared_ptr<AbiDecoder> decoder;
+        Order::iterator position;
+    };
+
+    const size_t capacity_;
+    std::mutex mutex_;  // for entries_ and order_
+    std::unordered_map<std::string, Entry> entries_;
+    // Most recently used first
+    Order order_;
+};
+
+// Inbound message first, then outbound external messages. Messages without a raw body are skipped
+auto transaction_messages(const tonlib_api::raw_transaction& transaction) -> std::vector<AbiMessage>;
+
+// Matches each message with a function of the ABI and decodes it on the worker threads,
+// including the parsing of the ABI. Results are in the same order as messages
+void decode_messages(const std::shared_ptr<WorkerPool>& workers, const std::shared_ptr<AbiDecoderCache>& decoders, std::string abi,
+                     std::vector<AbiMessage>&& messages, td::Promise<DecodedMessages>&& promise);
+
+}  // namespace tjs
@@ -0,0 +1,194 @@
+#include "account_watcher.hpp"
+
+#include <block/block.h>
+
+#include "block_subscription.hpp"
+#include "dispatcher.hpp"
+#include "tl_utils.hpp"
+
+namespace tjs
+{
+namespace
+{
+// Fill account, lt and hash of the transaction ids
+constexpr int32_t transactions_mode = 1 | 2 | 4;
+constexpr int32_t transactions_after_mode = 128;
+constexpr int32_t transactions_page_size = 256;
+
+}  // namespace
+
+auto parse_account_key(td::Slice address) -> td::Result<AccountKey>
+{
+    TRY_RESULT(std_address, block::StdAddress::parse(address))
+    return AccountKey{std_address.workchain, std_address.addr};
+}
+
+auto to_raw_address(const AccountKey& key) -> std::string
+{
+    return PSTRING() << key.workchain << ':' << key.address.to_hex();
+}
+
+AccountWatcher::AccountWatcher(td::actor::ActorId<RequestDispatcher> dispatcher, td::actor::ActorId<BlockSubscription> blocks, const Options& options,
+                               AccountChangesListener listener)
+    : dispatcher_{std::move(dispatcher)}
+    , blocks_{std::move(blocks)}
+    , options_{options}
+    , listener_{std::move(listener)}
+    , subscription_id_{BlockSubscription::make_subscription_id()}
+{
+}
+
+void AccountWatcher::add(std::vector<AccountKey> accounts)
+{
+    accounts_.reserve(accounts_.size() + accounts.size());
+    for (const auto& account : accounts) {
+        // The first seen transaction is reported, so the state is not requested
+        accounts_.emplace(account, AccountState{});
+    }
+}
+
+void AccountWatcher::remove(std::vector<AccountKey> accounts)
+{
+    for (const auto& account : accounts) {
+        accounts_.erase(account);
+    }
+}
+
+void AccountWatcher::start_up()
+{
+    td::actor::send_closure(blocks_, &BlockSubscription::subscribe, subscription_id_, true,
+                            [self = actor_id(this)](std::shared_ptr<const NewBlock> block) {
+                                td::actor::send_closure(self, &AccountWatcher::on_block, std::move(block));
+                            });
+}
+
+void AccountWatcher::tear_down()
+{
+    td::actor::send_closure(blocks_, &BlockSubscription::unsubscribe, subscription_id_);
+}
+
+void AccountWatcher::alarm()
+{
+    if (waiting_retry_) {
+        waiting_retry_ = false;
+        start_block();
+        fill();
+    }
+}
+
+void AccountWatcher::on_block(std::shared_ptr<const NewBlock> block)
+{
+    queue_.emplace_back(std::move(block));
+    if (queue_.size() == 1) {
+        start_block();
+        fill();
+    }
+}
+
+void AccountWatcher::start_block()
+{
+    const auto& block = *queue_.front();
+
+    generation_++;
+    block_ids_.clear();
+    block_ids_.emplace_back(block.id.get());
+    // Intermediate blocks of shards which produced several blocks since the previous masterchain block are included
+    for (const auto& shard : block.shards) {
+        block_ids_.emplace_back(shard.get());
+    }
+    next_block_id_ = 0;
+    remaining_block_ids_ = block_ids_.size();
+    candidates_.clear();
+}
+
+void AccountWatcher::fill()
+{
+    while (!queue_.empty() && !waiting_retry_ && next_block_id_ < block_ids_.size() && in_flight_ < options_.concurrency) {
+        fetch_transactions(next_block_id_++, nullptr);
+    }
+}
+
+void AccountWatcher::fetch_transactions(size_t index, tonlib_api::object_ptr<tonlib_api::blocks_accountTransactionId> after)
+{
+    const auto mode = after == nullptr ? transactions_mode : transactions_mode | transactions_after_mode;
+    if (after == nullptr) {
+        after = tonlib_api::make_object<tonlib_api::blocks_accountTransactionId>();
+    }
+
+    in_flight_++;
+    auto request = tonlib_api::make_object<tonlib_api::blocks_getTransactions>(tl_clone(*block_ids_[index]), mode, transactions_page_size, std::move(after));
+    td::actor::send_closure(dispatcher_, &RequestDispatcher::request, std::move(request), options_.priority,
+                            td::PromiseCreator::lambda([self = actor_id(this), generation = generation_, index](td::Result<Client::Response> R) {
+                                td::actor::send_closure(self, &AccountWatcher::on_transactions, generation, index, std::move(R));
+                            }));
+}
+
+void AccountWatcher::on_transactions(uint64_t generation, size_t index, td::Result<Client::Response> result)
+{
+    in_flight_--;
+    if (generation != generation_ || waiting_retry_) {
+        fill();
+        return;
+    }
+
+    auto r_page = expect_object<tonlib_api::blocks_transactions>(std::move(result));
+    if (r_page.is_error()) {
+        LOG(WARNING) << "Failed to get block transactions, retrying: " << r_page.error();
+        waiting_retry_ = true;
+        alarm_timestamp() = td::Timestamp::in(options_.retry_interval_ms / 1000.0);
+        return;
+    }
+    auto page = r_page.move_as_ok();
+
+    AccountKey key{block_ids_[index]->workchain_, {}};
+    for (const auto& transaction : page->transactions_) {
+        if (transaction->account_.size() != key.address.size() / 8) {
+            continue;
+        }
+        key.address.as_slice().copy_from(transaction->account_);
+        if (accounts_.find(key) == accounts_.end()) {
+            continue;
+        }
+
+        auto& candidate = candidates_[key];
+        if (transaction->lt_ > candidate.lt && transaction->hash_.size() == candidate.hash.size() / 8) {
+            candidate.lt = transaction->lt_;
+            candidate.hash.as_slice().copy_from(transaction->hash_);
+        }
+    }
+
+    if (page->incomplete_ && !page->transactions_.empty()) {
+        const auto& last = page->transactions_.back();
+        fetch_transactions(index, tonlib_api::make_object<tonlib_api::blocks_accountTransactionId>(last->account_, last->lt_));
+    }
+    else if (--remaining_block_ids_ == 0) {
+        finish_block();
+    }
+    fill();
+}
+
+void AccountWatcher::finish_block()
+{
+    const auto& block = *queue_.front();
+    AccountChanges changes{tl_clone(*block.id), {}, block.skipped};
+    for (const auto& [key, candidate] : candidates_) {
+        auto it = accounts_.find(key);
+        if (it == accounts_.end() || it->second.lt >= candidate.lt) {
+            continue;
+        }
+        it->second = candidate;
+        changes.accounts.emplace_back(AccountChange{key, candidate.lt, candidate.hash});
+    }
+    candidates_.clear();
+
+    if (!changes.accounts.empty() || !changes.skipped.empty()) {
+        listener_(std::move(changes));
+    }
+
+    queue_.pop_front();
+    if (!queue_.empty()) {
+        start_block();
+    }
+}
+
+}  // namespace tjs
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <crypto/common/bitstring.h>
+#include <td/actor/actor.h>
+
+#include <cstring>
+#include <deque>
+#include <unordered_map>
+
+#include "block_subscription.hpp"
+#include "client.hpp"
+#include "tl_utils.hpp"
+
+namespace tjs
+{
+struct AccountKey {
+    int32_t workchain{0};
+    td::Bits256 address{};
+
+    auto operator==(const AccountKey& other) const -> bool { return workchain == other.workchain && address == other.address; }
+};
+
+struct AccountKeyHash {
+    auto operator()(const AccountKey& key) const -> size_t
+    {
+        // Addresses are hashes already
+        size_t result;
+        std::memcpy(&result, key.address.data(), sizeof(result));
+        return result ^ static_cast<size_t>(key.workchain);
+    }
+};
+
+auto parse_account_key(td::Slice address) -> td::Result<AccountKey>;
+auto to_raw_address(const AccountKey& key) -> std::string;
+
+struct AccountChange {
+    AccountKey account;
+    int64_t lt;
+    td::Bits256 hash;
+};
+
+struct AccountChanges {
+    tonlib_api::object_ptr<tonlib_api::ton_blockIdExt> block;
+    std::vector<AccountChange> accounts;
+    // Blocks which were not scanned, so changes in them are reported late or not at all
+    std::vector<SkippedBlocks> skipped;
+};
+
+inline auto tl_memory_size_field(const AccountChanges& changes) -> size_t
+{
+    return tl_memory_size_field(changes.block) + tl_memory_size_field(changes.accounts) + tl_memory_size_field(changes.skipped);
+}
+
+// Called on the client's scheduler thread
+using AccountChangesListener = std::function<void(AccountChanges&&)>;
+
+// Detects new transactions of a large set of accounts.
+//
+// For each new masterchain block, transaction lists of the block and all shard
+// blocks since the previous one are fetched with bounded concurrency and
+// matched against the watched set. Only the last transaction (lt, hash) of each account is kept,
+// and only accounts which got a newer transaction are reported, so the work
+// per block depends on the block size and not on the number of accounts.
+class AccountWatcher final : public td::actor::Actor {
+public:
+    struct Options {
+        // Max number of transaction list requests at the same time
+        size_t concurrency{16};
+        Priority priority{Priority::Bulk};
+        double retry_interval_ms{1000.0};
+    };
+
+    AccountWatcher(td::actor::ActorId<RequestDispatcher> dispatcher, td::actor::ActorId<BlockSubscription> blocks, const Options& options,
+                   AccountChangesListener listener);
+
+    void add(std::vector<AccountKey> accounts);
+    void remove(std::vector<AccountKey> accounts);
+
+private:
+    struct AccountState {
+        int64_t lt{0};
+        td::Bits256 hash{};
+    };
+    using AccountTable = std::unordered_map<AccountKey, AccountState, AccountKeyHash>;
+
+    void start_up() final;
+    void tear_down() final;
+    void alarm() final;
+
+    void on_block(std::shared_ptr<const NewBlock> block);
+    void start_block();
+    void fill();
+    void fetch_transactions(size_t index, tonlib_api::object_ptr<tonlib_api::blocks_accountTransactionId> after);
+    void on_transactions(uint64_t generation, size_t index, td::Result<Client::Response> result);
+    void finish_block();
+
+    td::actor::ActorId<RequestDispatcher> dispatcher_;
+    td::actor::ActorId<BlockSubscription> blocks_;
+    Options options_;
+    AccountChangesListener listener_;
+    uint64_t subscription_id_;
+
+    AccountTable accounts_;
+
+    std::deque<std::shared_ptr<const NewBlock>> queue_;
+    // Masterchain and shard blocks of the front block in the queue
+    std::vector<const tonlib_api::ton_blockIdExt*> block_ids_;
+    size_t next_block_id_{0};
+    size_t remaining_block_ids_{0};
+    // Newest transactions of watched accounts in the current block
+    AccountTable candidates_;
+    // Responses of the restarted block are ignored
+    uint64_t generation_{0};
+    bool waiting_retry_{false};
+    size_t in_flight_{0};
+};
+
+}  // namespace tjs
@@ -0,0 +1,274 @@
+#include "batch.hpp"
+
+#include <block/block.h>
+#include <ton/ton-shard.h>
+
+#include <unordered_map>
+
+#include "account_watcher.hpp"
+#include "dispatcher.hpp"
+#include "smc_pool.hpp"
+#include "tl_utils.hpp"
+
+namespace tjs
+{
+namespace
+{
+auto find_shard(const std::string& address, const tonlib_api::ton_blockIdExt& block,
+                const std::vector<tonlib_api::object_ptr<tonlib_api::ton_blockIdExt>>& shards)
+    -> td::Result<tonlib_api::object_ptr<tonlib_api::ton_blockIdExt>>
+{
+    TRY_RESULT(std_address, block::StdAddress::parse(address))
+    if (std_address.workchain == ton::masterchainId) {
+        return tl_clone(block);
+    }
+    const ton::AccountIdPrefixFull prefix{std_address.workchain, std_address.addr.cbits().get_uint(64)};
+    for (const auto& shard : shards) {
+        if (ton::shard_contains(ton::ShardIdFull{shard->workchain_, static_cast<ton::ShardId>(shard->shard_)}, prefix)) {
+            return tl_clone(*shard);
+        }
+    }
+    return td::Status::Error("Account shard not found");
+}
+
+}  // namespace
+
+RequestBatch::RequestBatch(td::actor::ActorId<RequestDispatcher> dispatcher, std::vector<Client::Request> requests, const BatchOptions& options,
+                           td::Promise<Results> promise)
+    : dispatcher_{std::move(dispatcher)}
+    , requests_{std::move(requests)}
+    , options_{options}
+    , promise_{std::move(promise)}
+    , results_(requests_.size())
+{
+}
+
+void RequestBatch::start_up()
+{
+    fill();
+}
+
+void RequestBatch::fill()
+{
+    if (completed_ == requests_.size()) {
+        promise_.set_value(std::move(results_));
+        stop();
+        return;
+    }
+
+    while (next_ < requests_.size() && in_flight_ < options_.concurrency) {
+        const auto index = next_++;
+        ++in_flight_;
+        td::actor::send_closure(dispatcher_, &RequestDispatcher::request, std::move(requests_[index]), options_.priority,
+                                td::PromiseCreator::lambda([self = actor_id(this), index](td::Result<Client::Response> result) {
+                                    td::actor::send_closure(self, &RequestBatch::on_result, index, std::move(result));
+                                }));
+    }
+}
+
+void RequestBatch::on_result(size_t index, td::Result<Client::Response> result)
+{
+    results_[index] = std::move(result);
+    --in_flight_;
+    ++completed_;
+    fill();
+}
+
+GetMethodBatch::GetMethodBatch(td::actor::ActorId<SmcPool> pool, std::string method, std::vector<std::string> addresses,
+                               std::vector<vm::StackEntry> stack, const BatchOptions& options, td::Promise<Results> promise)
+    : pool_{std::move(pool)}
+    , method_{std::move(method)}
+    , addresses_{std::move(addresses)}
+    , stack_{std::make_shared<const std::vector<vm::StackEntry>>(std::move(stack))}
+    , options_{options}
+    , promise_{std::move(promise)}
+    , results_(addresses_.size())
+{
+}
+
+void GetMethodBatch::start_up()
+{
+    fill();
+}
+
+void GetMethodBatch::fill()
+{
+    if (completed_ == addresses_.size()) {
+        promise_.set_value(std::move(results_));
+        stop();
+        return;
+    }
+
+    while (next_ < addresses_.size() && in_flight_ < options_.concurrency) {
+        const auto index = next_++;
+        ++in_flight_;
+        td::actor::send_closure(pool_, &SmcPool::run_get_method, addresses_[index], method_, stack_, options_.priority,
+                                td::PromiseCreator::lambda([self = actor_id(this), index](td::Result<Result> result) {
+                                    td::actor::send_closure(self, &GetMethodBatch::on_result, index, std::move(result));
+                                }));
+    }
+}
+
+void GetMethodBatch::on_result(size_t index, td::Result<Result> result)
+{
+    results_[index] = std::move(result);
+    --in_flight_;
+    ++completed_;
+    fill();
+}
+
+AccountSnapshot::AccountSnapshot(td::actor::ActorId<RequestDispatcher> dispatcher, std::vector<std::string> addresses,
+                                 tonlib_api::object_ptr<tonlib_api::ton_blockIdExt> block, const BatchOptions& options,
+                                 td::Promise<Result> promise)
+    : dispatcher_{std::move(dispatcher)}
+    , options_{options}
+    , promise_{std::move(promise)}
+    , block_{std::move(block)}
+{
+    // The same account may be given in raw and user-friendly forms. Invalid
+    // addresses are kept apart, so each of them reports its own error
+    std::unordered_map<AccountKey, size_t, AccountKeyHash> unique;
+    targets_.reserve(addresses.size());
+    for (auto& address : addresses) {
+        auto r_key = parse_account_key(address);
+        if (r_key.is_error()) {
+            targets_.emplace_back(addresses_.size());
+            addresses_.emplace_back(std::move(address));
+            continue;
+        }
+        const auto [it, inserted] = unique.emplace(r_key.move_as_ok(), addresses_.size());
+        if (inserted) {
+            addresses_.emplace_back(std::move(address));
+        }
+        targets_.emplace_back(it->second);
+    }
+}
+
+void AccountSnapshot::start_up()
+{
+    if (block_ != nullptr) {
+        request_shards();
+        return;
+    }
+    td::actor::send_closure(dispatcher_, &RequestDispatcher::request, tonlib_api::make_object<tonlib_api::liteServer_getMasterchainInfo>(),
+                            options_.priority, td::PromiseCreator::lambda([self = actor_id(this)](td::Result<Client::Response> result) {
+                                td::actor::send_closure(self, &AccountSnapshot::on_last_block, std::move(result));
+                            }));
+}
+
+void AccountSnapshot::on_last_block(td::Result<Client::Response> result)
+{
+    auto r_info = expect_object<tonlib_api::liteServer_masterchainInfo>(std::move(result));
+    if (r_info.is_error()) {
+        fail(r_info.move_as_error());
+        return;
+    }
+    block_ = std::move(r_info.ok_ref()->last_);
+    if (block_ == nullptr) {
+        fail(td::Status::Error("Last block is empty"));
+        return;
+    }
+    request_shards();
+}
+
+void AccountSnapshot::request_shards()
+{
+    td::actor::send_closure(dispatcher_, &RequestDispatcher::request, tonlib_api::make_object<tonlib_api::blocks_getShards>(tl_clone(*block_)),
+                            options_.priority, td::PromiseCreator::lambda([self = actor_id(this)](td::Result<Client::Response> result) {
+                                td::actor::send_closure(self, &AccountSnapshot::on_shards, std::move(result));
+                            }));
+}
+
+void AccountSnapshot::on_shards(td::Result<Client::Response> result)
+{
+    auto r_shards = expect_object<tonlib_api::blocks_shards>(std::move(result));
+    if (r_shards.is_error()) {
+        fail(r_shards.move_as_error());
+        return;
+    }
+    shards_ = std::move(r_shards.ok_ref()->shards_);
+
+    // Invalid addresses and unknown workchains are rejected without requests
+    accounts_.resize(addresses_.size());
+    for (size_t i = 0; i < addresses_.size(); ++i) {
+        auto r_shard = find_shard(addresses_[i], *block_, shards_);
+        if (r_shard.is_error()) {
+            accounts_[i] = r_shard.move_as_error();
+            ++completed_;
+            continue;
+        }
+        accounts_[i] = Account{r_shard.move_as_ok(), nullptr};
+        pending_.emplace_back(i);
+    }
+    fill();
+}
+
+void AccountSnapshot::fill()
+{
+    if (completed_ == addresses_.size()) {
+        finish();
+        return;
+    }
+
+    while (next_ < pending_.size() && in_flight_ < options_.concurrency) {
+        const auto index = pending_[next_++];
+        ++in_flight_;
+        // Every state is read at the pinned block, so the snapshot is consistent
+        auto request = tonlib_api::make_object<tonlib_api::withBlock>(
+            tl_clone(*block_),
+            tonlib_api::make_object<tonlib_api::raw_getAccountState>(tonlib_api::make_object<tonlib_api::accountAddress>(addresses_[index])));
+        td::actor::send_closure(dispatcher_, &RequestDispatcher::request, std::move(request), options_.priority,
+                                td::PromiseCreator::lambda([self = actor_id(this), index](td::Result<Client::Response> result) {
+                                    td::actor::send_closure(self, &AccountSnapshot::on_state, index, std::move(result));
+                                }));
+    }
+}
+
+void AccountSnapshot::on_state(size_t index, td::Result<Client::Response> result)
+{
+    auto r_state = expect_object<tonlib_api::raw_fullAccountState>(std::move(result));
+    if (r_state.is_error()) {
+        accounts_[index] = r_state.move_as_error();
+    }
+    else {
+        accounts_[index].ok_ref().state = r_state.move_as_ok();
+    }
+    --in_flight_;
+    ++completed_;
+    fill();
+}
+
+void AccountSnapshot::finish()
+{
+    std::vector<size_t> uses(addresses_.size());
+    for (const auto target : targets_) {
+        ++uses[target];
+    }
+
+    Result result{std::move(block_), std::move(shards_), {}};
+    result.accounts.reserve(targets_.size());
+    for (const auto target : targets_) {
+        auto& account = accounts_[target];
+        // The last occurrence of the address takes the state, the previous ones get copies
+        if (--uses[target] == 0) {
+            result.accounts.emplace_back(std::move(account));
+        }
+        else if (account.is_error()) {
+            result.accounts.emplace_back(account.error().clone());
+        }
+        else {
+            result.accounts.emplace_back(Account{tl_clone(*account.ok().shard), tl_clone(*account.ok().state)});
+        }
+    }
+
+    promise_.set_value(std::move(result));
+    stop();
+}
+
+void AccountSnapshot::fail(td::Status status)
+{
+    promise_.set_error(std::move(status));
+    stop();
+}
+
+}  // namespace tjs
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <td/actor/actor.h>
+
+#include <vm/stack.hpp>
+
+#include "client.hpp"
+#include "tl_utils.hpp"
+
+namespace tjs
+{
+class SmcPool;
+
+// Sends requests with bounded concurrency and returns the results in the same order
+class RequestBatch final : public td::actor::Actor {
+public:
+    using Results = std::vector<td::Result<Client::Response>>;
+
+    RequestBatch(td::actor::ActorId<RequestDispatcher> dispatcher, std::vector<Client::Request> requests, const BatchOptions& options,
+                 td::Promise<Results> promise);
+
+private:
+    void start_up() final;
+    void fill();
+    void on_result(size_t index, td::Result<Client::Response> result);
+
+    td::actor::ActorId<RequestDispatcher> dispatcher_;
+    std::vector<Client::Request> requests_;
+    BatchOptions options_;
+    td::Promise<Results> promise_;
+
+    Results results_;
+    size_t next_{0};
+    size_t in_flight_{0};
+    size_t completed_{0};
+};
+
+// Runs the same get-method on many accounts.
+//
+// Calls go through the client's pool of loaded states with bounded
+// concurrency, so unchanged accounts are not loaded again.
+class GetMethodBatch final : public td::actor::Actor {
+public:
+    using Result = tonlib_api::object_ptr<tonlib_api::smc_runResult>;
+    using Results = std::vector<td::Result<Result>>;
+
+    GetMethodBatch(td::actor::ActorId<SmcPool> pool, std::string method, std::vector<std::string> addresses, std::vector<vm::StackEntry> stack,
+                   const BatchOptions& options, td::Promise<Results> promise);
+
+private:
+    void start_up() final;
+    void fill();
+    void on_result(size_t index, td::Result<Result> result);
+
+    td::actor::ActorId<SmcPool> pool_;
+    std::string method_;
+    std::vector<std::string> addresses_;
+    std::shared_ptr<const std::vector<vm::StackEntry>> stack_;
+    BatchOptions options_;
+    td::Promise<Results> promise_;
+
+    Results results_;
+    size_t next_{0};
+    size_t in_flight_{0};
+    size_t completed_{0};
+};
+
+// State of many accounts at a single masterchain block.
+//
+// The block is pinned once, either the given one or the last one, and its
+// shards are resolved once, so each account is reported with the shard block
+// its state belongs to. States are requested for the pinned block with
+// bounded concurrency, and repeated addresses are requested only once.
+class AccountSnapshot final : public td::actor::Actor {
+public:
+    struct Account {
+        tonlib_api::object_ptr<tonlib_api::ton_blockIdExt> shard;
+        tonlib_api::object_ptr<tonlib_api::raw_fullAccountState> state;
+    };
+
+    struct Result {
+        tonlib_api::object_ptr<tonlib_api::ton_blockIdExt> block;
+        std::vector<tonlib_api::object_ptr<tonlib_api::ton_blockIdExt>> shards;
+        // In the same order as addresses
+        std::vector<td::Result<Account>> accounts;
+    };
+
+    // `block` must be a masterchain block, nullptr for the last one
+    AccountSnapshot(td::actor::ActorId<RequestDispatcher> dispatcher, std::vector<std::string> addresses,
+                    tonlib_api::object_ptr<tonlib_api::ton_blockIdExt> block, const BatchOptions& options, td::Promise<Result> promise);
+
+private:
+    void start_up() final;
+    void on_last_block(td::Result<Client::Response> result);
+    void request_shards();
+    void on_shards(td::Result<Client::Response> result);
+    void fill();
+    void on_state(size_t index, td::Result<Client::Response> result);
+    void finish();
+    void fail(td::Status status);
+
+    td::actor::ActorId<RequestDispatcher> dispatcher_;
+    BatchOptions options_;
+    td::Promise<Result> promise_;
+
+    // Addresses of unique accounts, `targets_` maps requested addresses to them
+    std::vector<std::string> addresses_;
+    std::vector<size_t> targets_;
+
+    tonlib_api::object_ptr<tonlib_api::ton_blockIdExt> block_;
+    std::vector<tonlib_api::object_ptr<tonlib_api::ton_blockIdExt>> shards_;
+    std::vector<td::Result<Account>> accounts_;
+    std::vector<size_t> pending_;
+    size_t next_{0};
+    size_t in_flight_{0};
+    size_t completed_{0};
+};
+
+inline auto tl_memory_size_field(const AccountSnapshot::Account& account) -> size_t
+{
+    return tl_memory_size_field(account.shard) + tl_memory_size_field(account.state);
+}
+
+inline auto tl_memory_size_field(const AccountSnapshot::Result& result) -> size_t
+{
+    return tl_memory_size_field(result.block) + tl_memory_size_field(result.shards) + tl_memory_size_field(result.accounts);
+}
+
+}  // namespace tjs
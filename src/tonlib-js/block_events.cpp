@@ -0,0 +1,139 @@
+#include "block_events.hpp"
+
+#include <algorithm>
+
+#include "block_subscription.hpp"
+
+namespace tjs
+{
+BlockEvents::BlockEvents(Client& client, std::shared_ptr<JsExecutor> executor, const NapiOptions& options)
+    : client_{client}
+    , executor_{std::move(executor)}
+    , options_{options}
+{
+}
+
+auto BlockEvents::add_listener(Napi::Env env, Napi::Object owner, Napi::Function callback, bool with_shards) -> Napi::Function
+{
+    if (listeners_.empty()) {
+        owner_ = Napi::Persistent(owner);
+    }
+
+    const auto id = next_listener_id_++;
+    listeners_.emplace(id, Listener{Napi::Persistent(callback), with_shards});
+    update_subscription(env);
+
+    return Napi::Function::New(
+        env,
+        [weak_self = weak_from_this(), id](const Napi::CallbackInfo& info) {
+            if (auto self = weak_self.lock()) {
+                self->remove_listener(info.Env(), id);
+            }
+        },
+        "unsubscribe");
+}
+
+void BlockEvents::remove_listener(Napi::Env env, uint64_t id)
+{
+    if (listeners_.erase(id) != 0) {
+        update_subscription(env);
+    }
+}
+
+void BlockEvents::update_subscription(Napi::Env env)
+{
+    if (listeners_.empty()) {
+        if (subscription_ != 0) {
+            client_.unsubscribe_blocks(subscription_);
+            subscription_ = 0;
+            executor_->unref(env);
+        }
+        // Client is not used after this point, so the owner can be collected
+        owner_.Reset();
+        return;
+    }
+
+    const auto with_shards = std::any_of(listeners_.begin(), listeners_.end(), [](const auto& item) { return item.second.with_shards; });
+    if (subscription_ != 0 && with_shards == subscription_shards_) {
+        return;
+    }
+
+    const auto previous = subscription_;
+    subscription_ = client_.subscribe_blocks(
+        with_shards, [weak_self = weak_from_this(), executor = executor_, with_shards](std::shared_ptr<const NewBlock> block) {
+            executor->post(JsExecutor::Task{[weak_self, with_shards, block = std::move(block)](Napi::Env env) {
+                if (auto self = weak_self.lock()) {
+                    self->dispatch(env, with_shards, *block);
+                }
+            }});
+        });
+    subscription_shards_ = with_shards;
+
+    // The new subscription is created first, so the polling loop keeps its state
+    if (previous != 0) {
+        client_.unsubscribe_blocks(previous);
+    }
+    else {
+        executor_->ref(env);
+    }
+}
+
+auto to_napi(const Napi::Env& env, const SkippedBlocks& skipped) -> Napi::Value
+{
+    auto result = Napi::Object::New(env);
+    result.Set("workchain", to_napi(env, skipped.workchain));
+    result.Set("shard", to_napi(env, NapiInt64{skipped.shard}));
+    result.Set("fromSeqno", to_napi(env, skipped.from_seqno));
+    result.Set("toSeqno", to_napi(env, skipped.to_seqno));
+    return result;
+}
+
+void BlockEvents::dispatch(Napi::Env env, bool with_shards, const NewBlock& block)
+{
+    // While the subscription is replaced, blocks come from both of them. Listeners
+    // without shards take the first copy, listeners with shards the first copy with shards
+    const auto seqno = block.id->seqno_;
+    const auto new_block = seqno > last_seqno_;
+    const auto new_shards = with_shards && seqno > last_shards_seqno_;
+    if (!new_block && !new_shards) {
+        return;
+    }
+    last_seqno_ = std::max(last_seqno_, seqno);
+    if (with_shards) {
+        last_shards_seqno_ = std::max(last_shards_seqno_, seqno);
+    }
+
+    NapiOptionsGuard guard{options_};
+    auto id = to_napi(env, block.id);
+    Napi::Object event;
+    Napi::Object event_with_shards;
+
+    // Listeners may be removed from callbacks
+    std::vector<uint64_t> ids;
+    ids.reserve(listeners_.size());
+    for (const auto& [listener_id, listener] : listeners_) {
+        ids.emplace_back(listener_id);
+    }
+
+    for (const auto listener_id : ids) {
+        auto it = listeners_.find(listener_id);
+        if (it == listeners_.end() || !(it->second.with_shards ? new_shards : new_block)) {
+            continue;
+        }
+
+        auto& target = it->second.with_shards ? event_with_shards : event;
+        if (target.IsEmpty()) {
+            target = Napi::Object::New(env);
+            target.Set("id", id);
+            if (it->second.with_shards) {
+                target.Set("shards", to_napi(env, block.shards));
+            }
+            if (!block.skipped.empty()) {
+                target.Set("skipped", to_napi(env, block.skipped));
+            }
+        }
+        it->second.callback.Call({target});
+    }
+}
+
+}  // namespace tjs
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <napi.h>
+
+#include <map>
+#include <memory>
+
+#include "client.hpp"
+#include "js_executor.hpp"
+#include "tl_napi.hpp"
+
+namespace tjs
+{
+struct SkippedBlocks;
+
+auto to_napi(const Napi::Env& env, const SkippedBlocks& skipped) -> Napi::Value;
+
+// Delivers new blocks to JS listeners.
+//
+// All listeners of a client share one native subscription, so each block is
+// converted once per event, and the number of requests doesn't depend on the
+// number of listeners. While there are listeners, the owner object and the
+// event loop are kept alive.
+class BlockEvents final : public std::enable_shared_from_this<BlockEvents> {
+public:
+    BlockEvents(Client& client, std::shared_ptr<JsExecutor> executor, const NapiOptions& options);
+
+    // Returns a function which removes the listener
+    auto add_listener(Napi::Env env, Napi::Object owner, Napi::Function callback, bool with_shards) -> Napi::Function;
+
+private:
+    struct Listener {
+        Napi::FunctionReference callback;
+        bool with_shards;
+    };
+
+    void remove_listener(Napi::Env env, uint64_t id);
+    void update_subscription(Napi::Env env);
+    void dispatch(Napi::Env env, bool with_shards, const NewBlock& block);
+
+    Client& client_;
+    std::shared_ptr<JsExecutor> executor_;
+    NapiOptions options_;
+
+    Napi::ObjectReference owner_;
+    std::map<uint64_t, Listener> listeners_;
+    uint64_t next_listener_id_{1};
+
+    uint64_t subscription_{0};
+    bool subscription_shards_{false};
+    // Last dispatched seqno, for listeners without and with shards
+    int32_t last_seqno_{0};
+    int32_t last_shards_seqno_{0};
+};
+
+}  // namespace tjs
@@ -0,0 +1,340 @@
+#include "block_scanner.hpp"
+
+#include <algorithm>
+#include <optional>
+
+#include "dispatcher.hpp"
+#include "tl_utils.hpp"
+
+namespace tjs
+{
+namespace
+{
+constexpr int32_t masterchain_id = -1;
+constexpr int64_t shard_id_all = std::numeric_limits<int64_t>::min();
+
+constexpr int32_t lookup_by_seqno = 1;
+// Fill account, lt and hash of the transaction ids
+constexpr int32_t transactions_mode = 1 | 2 | 4;
+constexpr int32_t transactions_after_mode = 128;
+constexpr int32_t transactions_page_size = 256;
+
+// Newest block of the shards which intersect the block's shard, if any
+auto last_seen_seqno(const std::map<std::pair<int32_t, int64_t>, int32_t>& tops, const tonlib_api::ton_blockIdExt& block) -> std::optional<int32_t>
+{
+    std::optional<int32_t> result;
+    const auto begin = tops.lower_bound(std::make_pair(block.workchain_, std::numeric_limits<int64_t>::min()));
+    for (auto it = begin; it != tops.end() && it->first.first == block.workchain_; ++it) {
+        if (shards_intersect(it->first.second, block.shard_)) {
+            result = std::max(result.value_or(it->second), it->second);
+        }
+    }
+    return result;
+}
+
+}  // namespace
+
+BlockScanner::BlockScanner(td::actor::ActorId<RequestDispatcher> dispatcher, const Options& options)
+    : dispatcher_{std::move(dispatcher)}
+    , options_{options}
+    , next_start_{options.from_seqno}
+    , next_delivery_{options.from_seqno}
+{
+}
+
+void BlockScanner::start_up()
+{
+    if (options_.from_seqno > options_.to_seqno) {
+        finish();
+        return;
+    }
+    // Shard blocks of the first block are followed back to the shards of the block before it
+    if (options_.from_seqno > 0) {
+        lookup_previous();
+    }
+    else {
+        shard_tops_.emplace(options_.from_seqno - 1, ShardTops{});
+    }
+    fill();
+}
+
+void BlockScanner::on_consumed()
+{
+    fill();
+}
+
+void BlockScanner::fill()
+{
+    while (!is_done() && next_start_ <= options_.to_seqno && pending_.size() + buffered() < options_.concurrency) {
+        start(next_start_++);
+    }
+}
+
+template <typename F>
+void BlockScanner::send_request(Client::Request&& request, F&& handler)
+{
+    td::actor::send_closure(dispatcher_, &RequestDispatcher::request, std::move(request), options_.priority,
+                            td::PromiseCreator::lambda([self = actor_id(this), handler = std::forward<F>(handler)](td::Result<Client::Response> result) mutable {
+                                handler(self, std::move(result));
+                            }));
+}
+
+auto BlockScanner::block_entry(Pending& pending, size_t index) -> ScannedBlockTransactions&
+{
+    return index == masterchain_index ? pending.block.masterchain : pending.block.shards[index];
+}
+
+void BlockScanner::start(int32_t seqno)
+{
+    pending_[seqno].outstanding = 1;
+    auto block_id = tonlib_api::make_object<tonlib_api::ton_blockId>(masterchain_id, shard_id_all, seqno);
+    send_request(tonlib_api::make_object<tonlib_api::blocks_lookupBlock>(lookup_by_seqno, std::move(block_id), 0, 0),
+                 [seqno](td::actor::ActorId<BlockScanner> self, td::Result<Client::Response> result) {
+                     td::actor::send_closure(self, &BlockScanner::on_lookup, seqno, std::move(result));
+                 });
+}
+
+void BlockScanner::on_lookup(int32_t seqno, td::Result<Client::Response> result)
+{
+    if (is_done()) {
+        return;
+    }
+    auto r_id = expect_object<tonlib_api::ton_blockIdExt>(std::move(result));
+    if (r_id.is_error()) {
+        fail(r_id.move_as_error_prefix(PSLICE() << "Failed to lookup masterchain block " << seqno << ": "));
+        return;
+    }
+
+    auto& pending = pending_[seqno];
+    pending.block.masterchain.id = r_id.move_as_ok();
+
+    pending.outstanding += 1;
+    send_request(tonlib_api::make_object<tonlib_api::blocks_getShards>(tl_clone(*pending.block.masterchain.id)),
+                 [seqno](td::actor::ActorId<BlockScanner> self, td::Result<Client::Response> result) {
+                     td::actor::send_closure(self, &BlockScanner::on_shards, seqno, std::move(result));
+                 });
+    fetch_transactions(seqno, masterchain_index, nullptr);
+
+    complete(seqno);
+}
+
+void BlockScanner::on_shards(int32_t seqno, td::Result<Client::Response> result)
+{
+    if (is_done()) {
+        return;
+    }
+    auto r_shards = expect_object<tonlib_api::blocks_shards>(std::move(result));
+    if (r_shards.is_error()) {
+        fail(r_shards.move_as_error_prefix(PSLICE() << "Failed to get shards of masterchain block " << seqno << ": "));
+        return;
+    }
+
+    auto& pending = pending_[seqno];
+    pending.tops = std::move(r_shards.ok_ref()->shards_);
+    pending.waiting_for_previous = true;
+    if (seqno < options_.to_seqno) {
+        auto& tops = shard_tops_[seqno];
+        for (const auto& shard : pending.tops) {
+            tops[ShardKey{shard->workchain_, shard->shard_}] = shard->seqno_;
+        }
+    }
+
+    walk_shards(seqno);
+    walk_shards(seqno + 1);
+}
+
+void BlockScanner::lookup_previous()
+{
+    auto block_id = tonlib_api::make_object<tonlib_api::ton_blockId>(masterchain_id, shard_id_all, options_.from_seqno - 1);
+    send_request(tonlib_api::make_object<tonlib_api::blocks_lookupBlock>(lookup_by_seqno, std::move(block_id), 0, 0),
+                 [](td::actor::ActorId<BlockScanner> self, td::Result<Client::Response> result) {
+                     td::actor::send_closure(self, &BlockScanner::on_previous_lookup, std::move(result));
+                 });
+}
+
+void BlockScanner::on_previous_lookup(td::Result<Client::Response> result)
+{
+    if (is_done()) {
+        return;
+    }
+    auto r_id = expect_object<tonlib_api::ton_blockIdExt>(std::move(result));
+    if (r_id.is_error()) {
+        fail(r_id.move_as_error_prefix(PSLICE() << "Failed to lookup masterchain block " << options_.from_seqno - 1 << ": "));
+        return;
+    }
+    send_request(tonlib_api::make_object<tonlib_api::blocks_getShards>(r_id.move_as_ok()),
+                 [](td::actor::ActorId<BlockScanner> self, td::Result<Client::Response> result) {
+                     td::actor::send_closure(self, &BlockScanner::on_previous_shards, std::move(result));
+                 });
+}
+
+void BlockScanner::on_previous_shards(td::Result<Client::Response> result)
+{
+    if (is_done()) {
+        return;
+    }
+    const auto seqno = options_.from_seqno - 1;
+    auto r_shards = expect_object<tonlib_api::blocks_shards>(std::move(result));
+    if (r_shards.is_error()) {
+        fail(r_shards.move_as_error_prefix(PSLICE() << "Failed to get shards of masterchain block " << seqno << ": "));
+        return;
+    }
+
+    auto& tops = shard_tops_[seqno];
+    for (const auto& shard : r_shards.ok_ref()->shards_) {
+        tops[ShardKey{shard->workchain_, shard->shard_}] = shard->seqno_;
+    }
+    walk_shards(options_.from_seqno);
+}
+
+void BlockScanner::walk_shards(int32_t seqno)
+{
+    auto it = pending_.find(seqno);
+    if (it == pending_.end() || !it->second.waiting_for_previous) {
+        return;
+    }
+    auto previous = shard_tops_.find(seqno - 1);
+    if (previous == shard_tops_.end()) {
+        return;
+    }
+
+    auto& pending = it->second;
+    pending.waiting_for_previous = false;
+    pending.previous_tops = std::move(previous->second);
+    shard_tops_.erase(previous);
+
+    auto tops = std::move(pending.tops);
+    for (auto& shard : tops) {
+        // Shards which didn't produce new blocks are referenced by several masterchain blocks
+        const auto last_seen = last_seen_seqno(pending.previous_tops, *shard);
+        if (last_seen.has_value() && *last_seen >= shard->seqno_) {
+            continue;
+        }
+        // Predecessors of shards which didn't exist in the previous block are not followed
+        add_shard_block(seqno, std::move(shard), last_seen.has_value());
+    }
+
+    complete(seqno);
+}
+
+void BlockScanner::add_shard_block(int32_t seqno, tonlib_api::object_ptr<tonlib_api::ton_blockIdExt> block, bool follow)
+{
+    auto& pending = pending_[seqno];
+    // The only predecessor is the block of the previous masterchain block, unless the shard was split or merged
+    const auto it = pending.previous_tops.find(ShardKey{block->workchain_, block->shard_});
+    if (follow && !(it != pending.previous_tops.end() && it->second + 1 == block->seqno_)) {
+        pending.outstanding += 1;
+        send_request(tonlib_api::make_object<tonlib_api::blocks_getBlockHeader>(tl_clone(*block)),
+                     [seqno](td::actor::ActorId<BlockScanner> self, td::Result<Client::Response> result) {
+                         td::actor::send_closure(self, &BlockScanner::on_header, seqno, std::move(result));
+                     });
+    }
+
+    pending.block.shards.emplace_back(ScannedBlockTransactions{std::move(block), {}});
+    fetch_transactions(seqno, pending.block.shards.size() - 1, nullptr);
+}
+
+void BlockScanner::on_header(int32_t seqno, td::Result<Client::Response> result)
+{
+    if (is_done()) {
+        return;
+    }
+    auto r_header = expect_object<tonlib_api::blocks_header>(std::move(result));
+    if (r_header.is_error()) {
+        fail(r_header.move_as_error_prefix(PSLICE() << "Failed to get shard block header of masterchain block " << seqno << ": "));
+        return;
+    }
+
+    auto& pending = pending_[seqno];
+    for (auto& prev : r_header.ok_ref()->prev_blocks_) {
+        const auto last_seen = last_seen_seqno(pending.previous_tops, *prev);
+        if (!last_seen.has_value() || prev->seqno_ <= *last_seen) {
+            continue;
+        }
+        // Both halves of a split shard reference the same predecessor
+        if (!pending.seen.emplace(prev->workchain_, prev->shard_, prev->seqno_).second) {
+            continue;
+        }
+        add_shard_block(seqno, std::move(prev), true);
+    }
+
+    complete(seqno);
+}
+
+void BlockScanner::fetch_transactions(int32_t seqno, size_t index, tonlib_api::object_ptr<tonlib_api::blocks_accountTransactionId> after)
+{
+    auto& pending = pending_[seqno];
+    pending.outstanding += 1;
+
+    const auto mode = after == nullptr ? transactions_mode : transactions_mode | transactions_after_mode;
+    if (after == nullptr) {
+        after = tonlib_api::make_object<tonlib_api::blocks_accountTransactionId>();
+    }
+
+    auto block_id = tl_clone(*block_entry(pending, index).id);
+    send_request(tonlib_api::make_object<tonlib_api::blocks_getTransactions>(std::move(block_id), mode, transactions_page_size, std::move(after)),
+                 [seqno, index](td::actor::ActorId<BlockScanner> self, td::Result<Client::Response> result) {
+                     td::actor::send_closure(self, &BlockScanner::on_transactions, seqno, index, std::move(result));
+                 });
+}
+
+void BlockScanner::on_transactions(int32_t seqno, size_t index, td::Result<Client::Response> result)
+{
+    if (is_done()) {
+        return;
+    }
+    auto r_page = expect_object<tonlib_api::blocks_transactions>(std::move(result));
+    if (r_page.is_error()) {
+        fail(r_page.move_as_error_prefix(PSLICE() << "Failed to get block transactions of masterchain block " << seqno << ": "));
+        return;
+    }
+    auto page = r_page.move_as_ok();
+
+    auto& entry = block_entry(pending_[seqno], index);
+    for (auto& transaction : page->transactions_) {
+        entry.transactions.emplace_back(std::move(transaction));
+    }
+
+    if (page->incomplete_ && !entry.transactions.empty()) {
+        const auto& last = entry.transactions.back();
+        fetch_transactions(seqno, index, tonlib_api::make_object<tonlib_api::blocks_accountTransactionId>(last->account_, last->lt_));
+    }
+
+    complete(seqno);
+}
+
+void BlockScanner::complete(int32_t seqno)
+{
+    auto it = pending_.find(seqno);
+    CHECK(it != pending_.end() && it->second.outstanding > 0)
+    if (--it->second.outstanding == 0) {
+        deliver();
+    }
+}
+
+void BlockScanner::deliver()
+{
+    while (!pending_.empty()) {
+        auto it = pending_.begin();
+        if (it->first != next_delivery_ || it->second.outstanding != 0) {
+            break;
+        }
+
+        auto block = std::move(it->second.block);
+        pending_.erase(it);
+        ++next_delivery_;
+
+        std::sort(block.shards.begin(), block.shards.end(), [](const auto& left, const auto& right) {
+            return std::tie(left.id->workchain_, left.id->seqno_, left.id->shard_) < std::tie(right.id->workchain_, right.id->seqno_, right.id->shard_);
+        });
+        push(std::move(block));
+    }
+
+    if (next_delivery_ > options_.to_seqno) {
+        finish();
+        return;
+    }
+    fill();
+}
+
+}  // namespace tjs
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <limits>
+#include <map>
+#include <set>
+#include <tuple>
+
+#include "stream.hpp"
+#include "tl_utils.hpp"
+
+namespace tjs
+{
+struct ScannedBlockTransactions {
+    tonlib_api::object_ptr<tonlib_api::ton_blockIdExt> id;
+    std::vector<tonlib_api::object_ptr<tonlib_api::blocks_shortTxId>> transactions;
+};
+
+struct ScannedBlock {
+    ScannedBlockTransactions masterchain;
+    // Shard blocks which appeared since the previous masterchain block, including intermediate
+    // blocks of shards which produced several blocks. Ordered by seqno within a workchain
+    std::vector<ScannedBlockTransactions> shards;
+};
+
+inline auto tl_memory_size_field(const ScannedBlockTransactions& block) -> size_t
+{
+    return tl_memory_size_field(block.id) + tl_memory_size_field(block.transactions);
+}
+
+inline auto tl_memory_size_field(const ScannedBlock& block) -> size_t
+{
+    return tl_memory_size_field(block.masterchain) + tl_memory_size_field(block.shards);
+}
+
+// Fetches masterchain blocks in the seqno range together with their shard blocks and transactions.
+//
+// Up to `concurrency` masterchain blocks are processed at the same time
+// (including blocks which are finished but not yet consumed), while the
+// results are delivered strictly in the order of seqno. Shard blocks are
+// followed back through their predecessors to the shard blocks of the
+// previous masterchain block, so each shard block in the range is delivered
+// exactly once.
+class BlockScanner final : public StreamProducer<ScannedBlock> {
+public:
+    struct Options {
+        int32_t from_seqno{0};
+        int32_t to_seqno{0};
+        size_t concurrency{8};
+        Priority priority{Priority::Bulk};
+    };
+
+    BlockScanner(td::actor::ActorId<RequestDispatcher> dispatcher, const Options& options);
+
+private:
+    // Index of the masterchain block in `ScannedBlock`, shards use their position
+    static constexpr size_t masterchain_index = std::numeric_limits<size_t>::max();
+
+    using ShardKey = std::pair<int32_t, int64_t>;
+    // Newest block of each shard referenced by a masterchain block
+    using ShardTops = std::map<ShardKey, int32_t>;
+
+    struct Pending {
+        ScannedBlock block;
+        size_t outstanding{0};
+        // Shards of the block, which wait until the shards of the previous block are known
+        std::vector<tonlib_api::object_ptr<tonlib_api::ton_blockIdExt>> tops;
+        bool waiting_for_previous{false};
+        // Shards of the previous block, where the walk through predecessors stops
+        ShardTops previous_tops;
+        std::set<std::tuple<int32_t, int64_t, int32_t>> seen;
+    };
+
+    void start_up() final;
+    void on_consumed() final;
+
+    void fill();
+    void start(int32_t seqno);
+    void on_lookup(int32_t seqno, td::Result<Client::Response> result);
+    void on_shards(int32_t seqno, td::Result<Client::Response> result);
+    void lookup_previous();
+    void on_previous_lookup(td::Result<Client::Response> result);
+    void on_previous_shards(td::Result<Client::Response> result);
+    void walk_shards(int32_t seqno);
+    void add_shard_block(int32_t seqno, tonlib_api::object_ptr<tonlib_api::ton_blockIdExt> block, bool follow);
+    void on_header(int32_t seqno, td::Result<Client::Response> result);
+    void fetch_transactions(int32_t seqno, size_t index, tonlib_api::object_ptr<tonlib_api::blocks_accountTransactionId> after);
+    void on_transactions(int32_t seqno, size_t index, td::Result<Client::Response> result);
+    void complete(int32_t seqno);
+    void deliver();
+
+    template <typename F>
+    void send_request(Client::Request&& request, F&& handler);
+    auto block_entry(Pending& pending, size_t index) -> ScannedBlockTransactions&;
+
+    td::actor::ActorId<RequestDispatcher> dispatcher_;
+    Options options_;
+
+    int32_t next_start_;
+    int32_t next_delivery_;
+    std::map<int32_t, Pending> pending_;
+    // Shards of masterchain blocks until the next block walked back to them
+    std::map<int32_t, ShardTops> shard_tops_;
+};
+
+}  // namespace tjs
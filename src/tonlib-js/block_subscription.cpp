@@ -0,0 +1,318 @@
+#include "block_subscription.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <tuple>
+
+#include "dispatcher.hpp"
+#include "tl_utils.hpp"
+
+namespace tjs
+{
+namespace
+{
+constexpr int32_t masterchain_id = -1;
+constexpr int64_t shard_id_all = std::numeric_limits<int64_t>::min();
+constexpr int32_t lookup_by_seqno = 1;
+
+constexpr double block_interval_ewma_factor = 0.125;
+// Part of the average block interval to wait before polling for the next block
+constexpr double expected_block_margin = 0.9;
+
+}  // namespace
+
+BlockSubscription::BlockSubscription(td::actor::ActorId<RequestDispatcher> dispatcher, const Options& options)
+    : dispatcher_{std::move(dispatcher)}
+    , options_{options}
+{
+}
+
+auto BlockSubscription::make_subscription_id() -> uint64_t
+{
+    static std::atomic<uint64_t> next_id{1};
+    return next_id++;
+}
+
+void BlockSubscription::subscribe(uint64_t id, bool with_shards, BlockListener listener)
+{
+    const auto was_idle = subscribers_.empty();
+    subscribers_[id] = Subscriber{with_shards, std::move(listener)};
+    if (was_idle && !in_flight_) {
+        poll();
+    }
+}
+
+void BlockSubscription::unsubscribe(uint64_t id)
+{
+    subscribers_.erase(id);
+    if (!subscribers_.empty()) {
+        return;
+    }
+
+    // New subscribers start from the current block instead of catching up
+    alarm_timestamp() = td::Timestamp::never();
+    last_seqno_ = 0;
+    target_ = nullptr;
+    skipped_.clear();
+    shard_seqnos_.clear();
+    walk_ = nullptr;
+}
+
+void BlockSubscription::alarm()
+{
+    if (!subscribers_.empty() && !in_flight_) {
+        poll();
+    }
+}
+
+template <typename F>
+void BlockSubscription::send_request(Client::Request&& request, F&& handler)
+{
+    in_flight_ = true;
+    td::actor::send_closure(dispatcher_, &RequestDispatcher::request, std::move(request), Priority::Interactive,
+                            td::PromiseCreator::lambda([self = actor_id(this), handler = std::forward<F>(handler)](td::Result<Client::Response> result) mutable {
+                                handler(self, std::move(result));
+                            }));
+}
+
+void BlockSubscription::poll()
+{
+    send_request(tonlib_api::make_object<tonlib_api::liteServer_getMasterchainInfo>(),
+                 [](td::actor::ActorId<BlockSubscription> self, td::Result<Client::Response> result) {
+                     td::actor::send_closure(self, &BlockSubscription::on_last_block, std::move(result));
+                 });
+}
+
+void BlockSubscription::on_last_block(td::Result<Client::Response> result)
+{
+    in_flight_ = false;
+    if (subscribers_.empty()) {
+        return;
+    }
+    auto r_info = expect_object<tonlib_api::liteServer_masterchainInfo>(std::move(result));
+    if (r_info.is_error()) {
+        retry(r_info.error());
+        return;
+    }
+    auto block = std::move(r_info.ok_ref()->last_);
+    if (block == nullptr) {
+        retry(td::Status::Error("Empty masterchain info"));
+        return;
+    }
+
+    // Read-only requests are spread between lite servers, so the returned block may be older than the last seen one
+    if (block->seqno_ <= last_seqno_) {
+        alarm_timestamp() = td::Timestamp::in(options_.poll_interval_ms / 1000.0);
+        return;
+    }
+
+    const auto now = td::Time::now();
+    if (last_block_at_ > 0.0 && last_seqno_ != 0) {
+        const auto interval = (now - last_block_at_) / static_cast<double>(block->seqno_ - last_seqno_);
+        avg_block_interval_ = avg_block_interval_ == 0.0 ? interval : avg_block_interval_ + (interval - avg_block_interval_) * block_interval_ewma_factor;
+    }
+    last_block_at_ = now;
+
+    const auto max_catch_up = std::max(options_.max_catch_up, 1);
+    if (last_seqno_ == 0) {
+        last_seqno_ = block->seqno_ - 1;
+    }
+    else if (block->seqno_ - last_seqno_ > max_catch_up) {
+        const auto from_seqno = last_seqno_ + 1;
+        last_seqno_ = block->seqno_ - max_catch_up;
+        LOG(WARNING) << "Skipped masterchain blocks " << from_seqno << ".." << last_seqno_;
+        skipped_.emplace_back(SkippedBlocks{masterchain_id, shard_id_all, from_seqno, last_seqno_});
+    }
+    target_ = std::move(block);
+    advance();
+}
+
+void BlockSubscription::advance()
+{
+    if (last_seqno_ + 1 >= target_->seqno_) {
+        deliver(std::move(target_));
+        return;
+    }
+
+    auto block_id = tonlib_api::make_object<tonlib_api::ton_blockId>(masterchain_id, shard_id_all, last_seqno_ + 1);
+    send_request(tonlib_api::make_object<tonlib_api::blocks_lookupBlock>(lookup_by_seqno, std::move(block_id), 0, 0),
+                 [](td::actor::ActorId<BlockSubscription> self, td::Result<Client::Response> result) {
+                     td::actor::send_closure(self, &BlockSubscription::on_lookup, std::move(result));
+                 });
+}
+
+void BlockSubscription::on_lookup(td::Result<Client::Response> result)
+{
+    in_flight_ = false;
+    if (subscribers_.empty()) {
+        return;
+    }
+    auto r_block = expect_object<tonlib_api::ton_blockIdExt>(std::move(result));
+    if (r_block.is_error()) {
+        retry(r_block.error());
+        return;
+    }
+    deliver(r_block.move_as_ok());
+}
+
+void BlockSubscription::deliver(tonlib_api::object_ptr<tonlib_api::ton_blockIdExt> block)
+{
+    if (!wants_shards()) {
+        // Shards are looked up from the masterchain block once requested again
+        shard_seqnos_.clear();
+        publish(NewBlock{std::move(block), {}, std::move(skipped_)});
+        return;
+    }
+
+    auto request = tonlib_api::make_object<tonlib_api::blocks_getShards>(tl_clone(*block));
+    send_request(std::move(request), [block = std::move(block)](td::actor::ActorId<BlockSubscription> self, td::Result<Client::Response> result) mutable {
+        td::actor::send_closure(self, &BlockSubscription::on_shards, std::move(block), std::move(result));
+    });
+}
+
+void BlockSubscription::on_shards(tonlib_api::object_ptr<tonlib_api::ton_blockIdExt> block, td::Result<Client::Response> result)
+{
+    in_flight_ = false;
+    if (subscribers_.empty()) {
+        return;
+    }
+    auto r_shards = expect_object<tonlib_api::blocks_shards>(std::move(result));
+    if (r_shards.is_error()) {
+        retry(r_shards.error());
+        return;
+    }
+
+    walk_ = std::make_unique<ShardWalk>();
+    walk_->block = NewBlock{std::move(block), {}, std::move(skipped_)};
+    for (auto& shard : r_shards.ok_ref()->shards_) {
+        walk_->tops[ShardKey{shard->workchain_, shard->shard_}] = shard->seqno_;
+        // Shards which didn't produce new blocks are referenced by several masterchain blocks
+        const auto last_seen = last_seen_seqno(*shard);
+        if (last_seen.has_value() && *last_seen >= shard->seqno_) {
+            continue;
+        }
+        // Predecessors of shards seen for the first time are not published
+        if (last_seen.has_value()) {
+            add_shard_block(tl_clone(*shard), 0);
+        }
+        walk_->block.shards.emplace_back(std::move(shard));
+    }
+    walk_shards();
+}
+
+void BlockSubscription::add_shard_block(tonlib_api::object_ptr<tonlib_api::ton_blockIdExt> block, int32_t depth)
+{
+    // The only predecessor is the last published block of the same shard, unless the shard was split or merged
+    const auto it = shard_seqnos_.find(ShardKey{block->workchain_, block->shard_});
+    if (it != shard_seqnos_.end() && it->second + 1 == block->seqno_) {
+        return;
+    }
+    walk_->pending.emplace_back(std::move(block), depth);
+}
+
+void BlockSubscription::walk_shards()
+{
+    if (walk_->pending.empty()) {
+        auto& shards = walk_->block.shards;
+        std::sort(shards.begin(), shards.end(), [](const auto& left, const auto& right) {
+            return std::tie(left->workchain_, left->seqno_, left->shard_) < std::tie(right->workchain_, right->seqno_, right->shard_);
+        });
+        shard_seqnos_ = std::move(walk_->tops);
+        auto block = std::move(walk_->block);
+        walk_ = nullptr;
+        publish(std::move(block));
+        return;
+    }
+
+    auto [block, depth] = std::move(walk_->pending.back());
+    walk_->pending.pop_back();
+    send_request(tonlib_api::make_object<tonlib_api::blocks_getBlockHeader>(std::move(block)),
+                 [depth = depth](td::actor::ActorId<BlockSubscription> self, td::Result<Client::Response> result) {
+                     td::actor::send_closure(self, &BlockSubscription::on_header, depth, std::move(result));
+                 });
+}
+
+void BlockSubscription::on_header(int32_t depth, td::Result<Client::Response> result)
+{
+    in_flight_ = false;
+    if (subscribers_.empty() || walk_ == nullptr) {
+        return;
+    }
+    auto r_header = expect_object<tonlib_api::blocks_header>(std::move(result));
+    if (r_header.is_error()) {
+        retry(r_header.error());
+        return;
+    }
+
+    for (auto& prev : r_header.ok_ref()->prev_blocks_) {
+        const auto last_seen = last_seen_seqno(*prev);
+        if (!last_seen.has_value() || prev->seqno_ <= *last_seen) {
+            continue;
+        }
+        // Both halves of a split shard reference the same predecessor
+        if (!walk_->seen.emplace(prev->workchain_, prev->shard_, prev->seqno_).second) {
+            continue;
+        }
+        if (depth + 1 >= options_.max_catch_up) {
+            LOG(WARNING) << "Skipped shard blocks " << prev->workchain_ << ':' << static_cast<uint64_t>(prev->shard_) << ' ' << *last_seen + 1 << ".."
+                         << prev->seqno_;
+            walk_->block.skipped.emplace_back(SkippedBlocks{prev->workchain_, prev->shard_, *last_seen + 1, prev->seqno_});
+            continue;
+        }
+        walk_->block.shards.emplace_back(tl_clone(*prev));
+        add_shard_block(std::move(prev), depth + 1);
+    }
+    walk_shards();
+}
+
+void BlockSubscription::publish(NewBlock&& block)
+{
+    last_seqno_ = block.id->seqno_;
+
+    const auto shared_block = std::make_shared<const NewBlock>(std::move(block));
+    for (const auto& [id, subscriber] : subscribers_) {
+        subscriber.listener(shared_block);
+    }
+
+    if (target_ != nullptr) {
+        advance();
+        return;
+    }
+
+    auto delay = options_.poll_interval_ms / 1000.0;
+    if (avg_block_interval_ > 0.0) {
+        delay = std::max(last_block_at_ + avg_block_interval_ * expected_block_margin - td::Time::now(), delay);
+    }
+    alarm_timestamp() = td::Timestamp::in(delay);
+}
+
+void BlockSubscription::retry(const td::Status& error)
+{
+    LOG(WARNING) << "Failed to poll new blocks: " << error;
+    target_ = nullptr;
+    if (walk_ != nullptr) {
+        // Skipped ranges are reported with the next published block
+        skipped_ = std::move(walk_->block.skipped);
+        walk_ = nullptr;
+    }
+    alarm_timestamp() = td::Timestamp::in(options_.retry_interval_ms / 1000.0);
+}
+
+auto BlockSubscription::wants_shards() const -> bool
+{
+    return std::any_of(subscribers_.begin(), subscribers_.end(), [](const auto& item) { return item.second.with_shards; });
+}
+
+auto BlockSubscription::last_seen_seqno(const tonlib_api::ton_blockIdExt& block) const -> std::optional<int32_t>
+{
+    std::optional<int32_t> result;
+    const auto begin = shard_seqnos_.lower_bound(ShardKey{block.workchain_, std::numeric_limits<int64_t>::min()});
+    for (auto it = begin; it != shard_seqnos_.end() && it->first.first == block.workchain_; ++it) {
+        if (shards_intersect(it->first.second, block.shard_)) {
+            result = std::max(result.value_or(it->second), it->second);
+        }
+    }
+    return result;
+}
+
+}  // namespace tjs
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <td/actor/actor.h>
+#include <td/utils/Time.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <tuple>
+
+#include "client.hpp"
+
+namespace tjs
+{
+// Blocks of one shard which were not published, because they were too far behind
+struct SkippedBlocks {
+    int32_t workchain;
+    int64_t shard;
+    int32_t from_seqno;
+    int32_t to_seqno;
+};
+
+struct NewBlock {
+    tonlib_api::object_ptr<tonlib_api::ton_blockIdExt> id;
+    // Shard blocks which appeared since the previous masterchain block, filled only if some subscriber requested them.
+    // Ordered by seqno within a workchain, so intermediate blocks of a shard precede the newest one
+    std::vector<tonlib_api::object_ptr<tonlib_api::ton_blockIdExt>> shards;
+    // Ranges between the previously published blocks and this one which were skipped
+    std::vector<SkippedBlocks> skipped;
+};
+
+// Single loop per client which detects new masterchain blocks and publishes them to all subscribers.
+//
+// Requests don't depend on the number of subscribers. After a new block is
+// found, the next poll is delayed until the next block is expected (based on
+// the average block interval), then the last block is polled every
+// `poll_interval_ms` until it changes. Skipped blocks are looked up, so
+// subscribers receive each block exactly once and in order. Shard blocks are
+// followed back through their predecessors to the last published ones, so
+// shards which produced several blocks per masterchain block are complete.
+// Blocks beyond `max_catch_up` are not looked up, and are reported as skipped
+// ranges with the next published block instead.
+class BlockSubscription final : public td::actor::Actor {
+public:
+    struct Options {
+        double poll_interval_ms{250.0};
+        // Retry delay after a failed request
+        double retry_interval_ms{1000.0};
+        // Blocks behind the last one which are looked up after a pause, older ones are skipped.
+        // Applies to masterchain blocks and to each chain of shard blocks
+        int32_t max_catch_up{32};
+    };
+
+    BlockSubscription(td::actor::ActorId<RequestDispatcher> dispatcher, const Options& options);
+
+    // Unique across all clients. Can be called from any thread
+    static auto make_subscription_id() -> uint64_t;
+
+    void subscribe(uint64_t id, bool with_shards, BlockListener listener);
+    void unsubscribe(uint64_t id);
+
+private:
+    using ShardKey = std::pair<int32_t, int64_t>;
+
+    struct Subscriber {
+        bool with_shards;
+        BlockListener listener;
+    };
+
+    // Shard blocks of a masterchain block which are being collected
+    struct ShardWalk {
+        NewBlock block;
+        // Blocks whose predecessors are not known yet, with their distance from the newest block of the shard
+        std::vector<std::pair<tonlib_api::object_ptr<tonlib_api::ton_blockIdExt>, int32_t>> pending;
+        std::set<std::tuple<int32_t, int64_t, int32_t>> seen;
+        std::map<ShardKey, int32_t> tops;
+    };
+
+    void alarm() final;
+
+    void poll();
+    void on_last_block(td::Result<Client::Response> result);
+    void advance();
+    void on_lookup(td::Result<Client::Response> result);
+    void deliver(tonlib_api::object_ptr<tonlib_api::ton_blockIdExt> block);
+    void on_shards(tonlib_api::object_ptr<tonlib_api::ton_blockIdExt> block, td::Result<Client::Response> result);
+    void walk_shards();
+    void on_header(int32_t depth, td::Result<Client::Response> result);
+    void add_shard_block(tonlib_api::object_ptr<tonlib_api::ton_blockIdExt> block, int32_t depth);
+    void publish(NewBlock&& block);
+    void retry(const td::Status& error);
+
+    [[nodiscard]] auto wants_shards() const -> bool;
+    // Newest published seqno of the shards which intersect the block's shard, if any
+    [[nodiscard]] auto last_seen_seqno(const tonlib_api::ton_blockIdExt& block) const -> std::optional<int32_t>;
+
+    template <typename F>
+    void send_request(Client::Request&& request, F&& handler);
+
+    td::actor::ActorId<RequestDispatcher> dispatcher_;
+    Options options_;
+
+    std::map<uint64_t, Subscriber> subscribers_;
+    bool in_flight_{false};
+
+    int32_t last_seqno_{0};
+    tonlib_api::object_ptr<tonlib_api::ton_blockIdExt> target_;
+    double last_block_at_{0.0};
+    double avg_block_interval_{0.0};
+    std::vector<SkippedBlocks> skipped_;
+    // Last published block of each shard, empty while shards are not requested
+    std::map<ShardKey, int32_t> shard_seqnos_;
+    std::unique_ptr<ShardWalk> walk_;
+};
+
+}  // namespace tjs
@@ -1,73 +1,261 @@
 #include "client.hpp"
 
-#include "tonlib/TonlibCallback.h"
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+#include "batch.hpp"
+#include "block_subscription.hpp"
+#include "dispatcher.hpp"
+#include "log_sink.hpp"
+#include "memory_tracker.hpp"
+#include "smc_pool.hpp"
+#include "tl_utils.hpp"
+#include "worker_pool.hpp"
 #include "tonlib/TonlibClient.h"
 
 namespace tjs
 {
 class Client::Impl final {
 public:
-    using OutputQueue = td::MpscPollableQueue<Client::Response>;
-    Impl()
+    explicit Impl(const Client::Options& options)
+        : worker_threads_{options.worker_threads != 0 ? options.worker_threads : std::max(std::thread::hardware_concurrency(), 1u)}
+        , counters_{std::make_shared<DispatcherCounters>()}
+        , memory_{std::make_shared<MemoryTracker>()}
+        , smc_pool_counters_{std::make_shared<SmcPoolCounters>()}
+        , log_tag_{LogSink::instance().create_tag()}
     {
-        class Callback final : public tonlib::TonlibCallback {
-        public:
-            explicit Callback() = default;
-            void on_result(std::uint64_t id, tonlib_api::object_ptr<tonlib_api::Object> result) final {}
-            void on_error(std::uint64_t id, tonlib_api::object_ptr<tonlib_api::error> error) final {}
-            Callback(const Callback&) = delete;
-            Callback& operator=(const Callback&) = delete;
-            Callback(Callback&&) = delete;
-            Callback& operator=(Callback&&) = delete;
-        };
+        smc_pool_options_.memory_budget = options.smc_pool_budget;
+        smc_pool_options_.max_age_ms = options.smc_pool_max_age_ms;
+
+        // Cache and sync state IO runs on worker threads, so they are started up front in that case
+        auto dispatcher_workers = options.cache_dir.empty() && options.state_file.empty() ? nullptr : workers();
 
-        scheduler_.run_in_context(
-            [&] { tonlib_ = td::actor::create_actor<tonlib::TonlibClient>(td::actor::ActorOptions().with_name("Tonlib"), td::make_unique<Callback>()); });
-        scheduler_thread_ = td::thread([&] { scheduler_.run(); });
+        LogTagScope log_scope{log_tag_};
+        scheduler_.run_in_context([&] {
+            dispatcher_ = td::actor::create_actor<RequestDispatcher>(td::actor::ActorOptions().with_name("Dispatcher"), options, counters_, log_tag_,
+                                                                     std::move(dispatcher_workers));
+
+            BlockSubscription::Options block_options{};
+            block_options.poll_interval_ms = options.block_poll_interval_ms;
+            blocks_ = td::actor::create_actor<BlockSubscription>("BlockSubscription", dispatcher_.get(), block_options);
+        });
+        scheduler_thread_ = td::thread([&] {
+            LogSink::set_thread_tag(log_tag_);
+            scheduler_.run();
+        });
     }
 
-    void send(Client::Request request, td::Promise<Client::Response>&& promise)
+    void send(Client::Request request, Priority priority, td::Promise<Client::Response>&& promise)
     {
         if (request == nullptr) {
             promise.set_error(td::Status::Error("Invalid request"));
             return;
         }
 
+        // The request is released by tonlib at an unknown moment, so it is accounted until the response
+        auto tracked = td::PromiseCreator::lambda(
+            [reservation = MemoryReservation{memory_, MemoryKind::Requests, tl_memory_size(*request)}, promise = std::move(promise)](
+                td::Result<Client::Response> R) mutable {
+                reservation.reset();
+                promise.set_result(std::move(R));
+            });
+
+        scheduler_.run_in_context_external(
+            [&] { td::actor::send_closure(dispatcher_, &RequestDispatcher::request, std::move(request), priority, std::move(tracked)); });
+    }
+
+    void ready(td::Promise<Client::Response>&& promise)
+    {
+        scheduler_.run_in_context_external([&] { td::actor::send_closure(dispatcher_, &RequestDispatcher::wait_ready, std::move(promise)); });
+    }
+
+    auto subscribe_blocks(bool with_shards, BlockListener&& listener) -> uint64_t
+    {
+        const auto id = BlockSubscription::make_subscription_id();
         scheduler_.run_in_context_external(
-            [&] { td::actor::send_closure(tonlib_, &tonlib::TonlibClient::request_async, std::move(request), std::move(promise)); });
+            [&] { td::actor::send_closure(blocks_, &BlockSubscription::subscribe, id, with_shards, std::move(listener)); });
+        return id;
     }
 
+    void unsubscribe_blocks(uint64_t id)
+    {
+        scheduler_.run_in_context_external([&] { td::actor::send_closure(blocks_, &BlockSubscription::unsubscribe, id); });
+    }
+
+    void run_in_context(const std::function<void()>& f)
+    {
+        // Actors created here may log from their constructors on the caller's thread
+        LogTagScope log_scope{log_tag_};
+        scheduler_.run_in_context_external(f);
+    }
+
+    [[nodiscard]] auto dispatcher() const -> td::actor::ActorId<RequestDispatcher> { return dispatcher_.get(); }
+    [[nodiscard]] auto block_subscription() const -> td::actor::ActorId<BlockSubscription> { return blocks_.get(); }
+
+    [[nodiscard]] auto workers() -> std::shared_ptr<WorkerPool>
+    {
+        std::lock_guard<std::mutex> guard{workers_mutex_};
+        if (workers_ == nullptr) {
+            workers_ = std::make_unique<WorkerThreads>(worker_threads_, scheduler_, log_tag_);
+        }
+        return workers_->pool();
+    }
+
+    // Must be called within the scheduler context, since the pool is created on first use
+    [[nodiscard]] auto smc_pool() -> td::actor::ActorId<SmcPool>
+    {
+        std::lock_guard<std::mutex> guard{smc_pool_mutex_};
+        if (smc_pool_.empty()) {
+            smc_pool_ = td::actor::create_actor<SmcPool>("SmcPool", dispatcher_.get(), blocks_.get(), workers(), smc_pool_options_, smc_pool_counters_);
+        }
+        return smc_pool_.get();
+    }
+
+    [[nodiscard]] auto memory() const -> const std::shared_ptr<MemoryTracker>& { return memory_; }
+
+    [[nodiscard]] auto stats() const -> Client::Stats
+    {
+        Client::Stats stats{};
+        for (size_t lane = 0; lane < priority_count; ++lane) {
+            const auto& counters = counters_->lanes[lane];
+            stats.lanes[lane] = Client::LaneStats{
+                counters.queued.load(),
+                counters.in_flight.load(),
+                counters.started.load(),
+                counters.rejected.load(),
+                counters.avg_wait_us.load(),
+                counters.max_wait_us.load(),
+            };
+        }
+        stats.hedged = counters_->hedged.load();
+        stats.hedge_wins = counters_->hedge_wins.load();
+        stats.hedge_delay_us = counters_->hedge_delay_us.load();
+        stats.cache_hits = counters_->cache_hits.load();
+        stats.cache_misses = counters_->cache_misses.load();
+        {
+            std::lock_guard<std::mutex> guard{counters_->backends_mutex};
+            stats.backends = counters_->backends;
+        }
+        stats.memory = Client::MemoryStats{
+            memory_->get(MemoryKind::Requests),
+            memory_->get(MemoryKind::Responses),
+            memory_->get(MemoryKind::Handles),
+            memory_->total(),
+            memory_->peak(),
+        };
+        stats.smc_pool = Client::SmcPoolStats{
+            smc_pool_counters_->entries.load(),
+            smc_pool_counters_->bytes.load(),
+            smc_pool_counters_->hits.load(),
+            smc_pool_counters_->misses.load(),
+            smc_pool_counters_->evictions.load(),
+            smc_pool_counters_->invalidations.load(),
+        };
+        return stats;
+    }
+
+    [[nodiscard]] auto id() const -> uint32_t { return log_tag_->client_id; }
+
+    void set_log_verbosity(int verbosity) { LogSink::instance().set_verbosity(*log_tag_, verbosity); }
+
     Impl(const Impl&) = delete;
     Impl& operator=(const Impl&) = delete;
     Impl(Impl&&) = delete;
     Impl& operator=(Impl&&) = delete;
     ~Impl()
     {
-        LOG(ERROR) << "~Impl";
-        scheduler_.run_in_context_external([&] { tonlib_.reset(); });
-        LOG(ERROR) << "Stop";
+        LogTagScope log_scope{log_tag_};
+        scheduler_.run_in_context_external([&] {
+            smc_pool_.reset();
+            blocks_.reset();
+            dispatcher_.reset();
+        });
+        {
+            // Producers may still hold the pool, so its threads are joined here while the scheduler is running
+            std::lock_guard<std::mutex> guard{workers_mutex_};
+            workers_.reset();
+        }
         scheduler_.run_in_context_external([] { td::actor::SchedulerContext::get()->stop(); });
-        LOG(ERROR) << "join";
         scheduler_thread_.join();
-        LOG(ERROR) << "join - done";
     }
 
 private:
     bool is_closed_{false};
+    size_t worker_threads_;
+
+    std::shared_ptr<DispatcherCounters> counters_;
+    std::shared_ptr<MemoryTracker> memory_;
+    std::shared_ptr<SmcPoolCounters> smc_pool_counters_;
+    SmcPool::Options smc_pool_options_;
+    std::shared_ptr<LogTag> log_tag_;
 
     td::actor::Scheduler scheduler_{{1}};
     td::thread scheduler_thread_;
-    td::actor::ActorOwn<tonlib::TonlibClient> tonlib_;
+    td::actor::ActorOwn<RequestDispatcher> dispatcher_;
+    td::actor::ActorOwn<BlockSubscription> blocks_;
+    std::mutex smc_pool_mutex_;  // for smc_pool_
+    td::actor::ActorOwn<SmcPool> smc_pool_;
+
+    std::mutex workers_mutex_;  // for workers_
+    std::unique_ptr<WorkerThreads> workers_;
 };
 
 Client::Client()
-    : impl_(std::make_unique<Impl>())
+    : Client(Client::Options{})
+{
+}
+
+Client::Client(const Client::Options& options)
+    : impl_(std::make_unique<Impl>(options))
 {
 }
 
 void Client::send(Client::Request&& request, td::Promise<Response>&& response)
 {
-    impl_->send(std::move(request), std::move(response));
+    impl_->send(std::move(request), Priority::Interactive, std::move(response));
+}
+
+void Client::send(Client::Request&& request, Priority priority, td::Promise<Response>&& response)
+{
+    impl_->send(std::move(request), priority, std::move(response));
+}
+
+auto Client::send(Client::Request&& request, Priority priority) -> std::future<td::Result<Response>>
+{
+    std::promise<td::Result<Response>> result;
+    auto future = result.get_future();
+    impl_->send(std::move(request), priority, td::PromiseCreator::lambda([result = std::move(result)](td::Result<Response> R) mutable {
+        result.set_value(std::move(R));
+    }));
+    return future;
+}
+
+auto Client::send_batch(std::vector<Request>&& requests, const BatchOptions& options) -> std::future<std::vector<td::Result<Response>>>
+{
+    std::promise<RequestBatch::Results> results;
+    auto future = results.get_future();
+
+    size_t request_bytes = 0;
+    for (const auto& request : requests) {
+        request_bytes += request != nullptr ? tl_memory_size(*request) : 0;
+    }
+    auto reservation = MemoryReservation{impl_->memory(), MemoryKind::Requests, request_bytes};
+
+    auto promise = td::PromiseCreator::lambda([results = std::move(results), reservation = std::move(reservation)](td::Result<RequestBatch::Results> R) mutable {
+        reservation.reset();
+        // Batch itself never fails, but the promise is rejected if the client is closed before it completes
+        if (R.is_error()) {
+            results.set_exception(std::make_exception_ptr(std::runtime_error(R.error().to_string())));
+            return;
+        }
+        results.set_value(R.move_as_ok());
+    });
+
+    impl_->run_in_context([&] {
+        td::actor::create_actor<RequestBatch>("RequestBatch", impl_->dispatcher(), std::move(requests), options, std::move(promise)).release();
+    });
+    return future;
 }
 
 Client::Response Client::execute(Client::Request&& request)
@@ -75,6 +263,66 @@ Client::Response Client::execute(Client::Request&& request)
     return tonlib::TonlibClient::static_request(std::move(request));
 }
 
+void Client::ready(td::Promise<Response>&& response)
+{
+    impl_->ready(std::move(response));
+}
+
+auto Client::subscribe_blocks(bool with_shards, BlockListener listener) -> uint64_t
+{
+    return impl_->subscribe_blocks(with_shards, std::move(listener));
+}
+
+void Client::unsubscribe_blocks(uint64_t id)
+{
+    impl_->unsubscribe_blocks(id);
+}
+
+void Client::run_in_context(const std::function<void()>& f)
+{
+    impl_->run_in_context(f);
+}
+
+auto Client::dispatcher() const -> td::actor::ActorId<RequestDispatcher>
+{
+    return impl_->dispatcher();
+}
+
+auto Client::block_subscription() const -> td::actor::ActorId<BlockSubscription>
+{
+    return impl_->block_subscription();
+}
+
+auto Client::workers() -> std::shared_ptr<WorkerPool>
+{
+    return impl_->workers();
+}
+
+auto Client::smc_pool() -> td::actor::ActorId<SmcPool>
+{
+    return impl_->smc_pool();
+}
+
+auto Client::memory() const -> const std::shared_ptr<MemoryTracker>&
+{
+    return impl_->memory();
+}
+
+auto Client::stats() const -> Client::Stats
+{
+    return impl_->stats();
+}
+
+auto Client::id() const -> uint32_t
+{
+    return impl_->id();
+}
+
+void Client::set_log_verbosity(int verbosity)
+{
+    impl_->set_log_verbosity(verbosity);
+}
+
 Client::~Client() = default;
 Client::Client(Client&& other) noexcept = default;
 Client& Client::operator=(Client&& other) noexcept = default;
@@ -3,20 +3,167 @@
 #include <auto/tl/tonlib_api.h>
 #include <td/actor/actor.h>
 
+#include <array>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
 namespace tonlib_api = ton::tonlib_api;
 
 namespace tjs
 {
+class BlockSubscription;
+class MemoryTracker;
+class RequestDispatcher;
+class SmcPool;
+class WorkerPool;
+struct NewBlock;
+
+// Called on the client's scheduler thread
+using BlockListener = std::function<void(std::shared_ptr<const NewBlock>)>;
+
+enum class Priority : size_t {
+    Interactive = 0,
+    Bulk = 1,
+};
+
+constexpr size_t priority_count = 2;
+
+struct BatchOptions {
+    // Max number of items processed at the same time
+    size_t concurrency{16};
+    Priority priority{Priority::Bulk};
+};
+
 class Client final {
 public:
     using Request = tonlib_api::object_ptr<tonlib_api::Function>;
     using Response = tonlib_api::object_ptr<tonlib_api::Object>;
 
+    struct Options {
+        // Max number of requests forwarded to tonlib at the same time
+        size_t max_in_flight{256};
+        // Part of `max_in_flight` which bulk requests can't occupy
+        size_t reserved_interactive{32};
+        // Max number of queued requests per priority, 0 for unlimited
+        size_t max_queue_size{0};
+
+        // Creates a separate tonlib instance for each lite server from the config
+        bool pin_lite_servers{false};
+        // Resends slow read-only requests to another lite server
+        bool hedge{false};
+        // Latency quantile after which the request is hedged
+        double hedge_quantile{0.95};
+        double min_hedge_delay_ms{5.0};
+
+        // Threads for local TVM executions, 0 for the number of CPU cores
+        size_t worker_threads{0};
+
+        // File with the last verified key block, used as a starting point on the next init with the same trusted block.
+        // The file is not signed, so it must be writable only by trusted users
+        std::string state_file{};
+        double state_save_interval_ms{60000.0};
+
+        // Directory for responses which never change, such as transactions of a known block. Can be shared between processes
+        std::string cache_dir{};
+        // Max bytes kept in `cache_dir`, the oldest entries are removed above it. 0 for unlimited
+        size_t cache_max_size{size_t{1} << 30};
+
+        // Interval between polls of the last block while the next one is expected
+        double block_poll_interval_ms{250.0};
+
+        // Estimated bytes of loaded account states kept for get-method calls, 0 disables pooling.
+        // Pooled accounts are watched, which polls every block with its shards
+        size_t smc_pool_budget{0};
+        // Time after which a pooled state is loaded again even without new transactions
+        double smc_pool_max_age_ms{10000.0};
+    };
+
+    struct LaneStats {
+        size_t queued{};
+        size_t in_flight{};
+        uint64_t started{};
+        uint64_t rejected{};
+        uint64_t avg_wait_us{};
+        uint64_t max_wait_us{};
+    };
+
+    struct BackendStats {
+        bool ready{};
+        size_t outstanding{};
+        uint64_t completed{};
+        uint64_t errors{};
+        uint64_t avg_latency_us{};
+    };
+
+    // Estimated native bytes
+    struct MemoryStats {
+        size_t requests{};
+        size_t responses{};
+        size_t handles{};
+        size_t total{};
+        size_t peak{};
+    };
+
+    struct SmcPoolStats {
+        size_t entries{};
+        size_t bytes{};
+        uint64_t hits{};
+        uint64_t misses{};
+        uint64_t evictions{};
+        uint64_t invalidations{};
+    };
+
+    struct Stats {
+        std::array<LaneStats, priority_count> lanes{};
+        std::vector<BackendStats> backends{};
+        uint64_t hedged{};
+        uint64_t hedge_wins{};
+        uint64_t hedge_delay_us{};
+        uint64_t cache_hits{};
+        uint64_t cache_misses{};
+        MemoryStats memory{};
+        SmcPoolStats smc_pool{};
+    };
+
     Client();
+    explicit Client(const Options& options);
 
     void send(Request&& request, td::Promise<Response>&& response);
+    void send(Request&& request, Priority priority, td::Promise<Response>&& response);
+    // Futures must not be waited on the client's scheduler thread, use promises within actors
+    auto send(Request&& request, Priority priority = Priority::Interactive) -> std::future<td::Result<Response>>;
+    // Results are in the same order as requests
+    auto send_batch(std::vector<Request>&& requests, const BatchOptions& options = {}) -> std::future<std::vector<td::Result<Response>>>;
     static Response execute(Request&& request);
 
+    // Resolves with the last masterchain block after the first sync following init
+    void ready(td::Promise<Response>&& response);
+
+    // All subscribers share a single polling loop, which runs only while there is at least one of them
+    auto subscribe_blocks(bool with_shards, BlockListener listener) -> uint64_t;
+    void unsubscribe_blocks(uint64_t id);
+
+    // Runs `f` synchronously within the client's actor context, so it can create actors and send closures
+    void run_in_context(const std::function<void()>& f);
+    // Actor which accepts requests. Use only from the client's actors or within `run_in_context`
+    [[nodiscard]] auto dispatcher() const -> td::actor::ActorId<RequestDispatcher>;
+    // Use only from the client's actors or within `run_in_context`
+    [[nodiscard]] auto block_subscription() const -> td::actor::ActorId<BlockSubscription>;
+    // Worker threads are started on first use. Tasks posted after the client is closed fail right away
+    [[nodiscard]] auto workers() -> std::shared_ptr<WorkerPool>;
+    // Pool of loaded account states for get-method calls, started on first use. Use only from the client's actors or within `run_in_context`
+    [[nodiscard]] auto smc_pool() -> td::actor::ActorId<SmcPool>;
+    // Requests are accounted by the client itself, bindings add responses and handles they keep
+    [[nodiscard]] auto memory() const -> const std::shared_ptr<MemoryTracker>&;
+
+    [[nodiscard]] auto stats() const -> Stats;
+
+    [[nodiscard]] auto id() const -> uint32_t;
+    void set_log_verbosity(int verbosity);
+
     ~Client();
     Client(Client&& other) noexcept;
     Client& operator=(Client&& other) noexcept;
@@ -0,0 +1,885 @@
+#include "dispatcher.hpp"
+
+#include <td/utils/JsonBuilder.h>
+#include <ton/ton-types.h>
+
+#include <algorithm>
+
+#include "sync_state.hpp"
+#include "tl_utils.hpp"
+#include "tonlib/TonlibCallback.h"
+#include "tonlib/TonlibClient.h"
+
+namespace tjs
+{
+namespace
+{
+constexpr uint64_t wait_ewma_factor = 8;
+constexpr double latency_ewma_factor = 0.125;
+constexpr size_t min_latency_samples = 16;
+constexpr size_t primary_backend = 0;
+constexpr int32_t lookup_by_seqno = 1;
+
+auto lane_limit(const Client::Options& options, Priority priority) -> size_t
+{
+    switch (priority) {
+        case Priority::Interactive:
+            return options.max_in_flight;
+        case Priority::Bulk:
+            return options.max_in_flight > options.reserved_interactive ? options.max_in_flight - options.reserved_interactive : 1;
+        default:
+            UNREACHABLE();
+    }
+}
+
+auto is_read_only(const tonlib_api::Function& function) -> bool
+{
+    switch (function.get_id()) {
+        case tonlib_api::withBlock::ID: {
+            const auto& with_block = static_cast<const tonlib_api::withBlock&>(function);
+            return with_block.function_ != nullptr && is_read_only(*with_block.function_);
+        }
+        case tonlib_api::raw_getAccountState::ID:
+        case tonlib_api::raw_getTransactions::ID:
+        case tonlib_api::liteServer_getMasterchainInfo::ID:
+        case tonlib_api::blocks_lookupBlock::ID:
+        case tonlib_api::blocks_getShards::ID:
+        case tonlib_api::blocks_getTransactions::ID:
+        case tonlib_api::ftabi_runLocal::ID:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Masterchain block a request reads from, lite servers which don't have it yet fail the request
+auto get_pinned_seqno(const tonlib_api::Function& function) -> int32_t
+{
+    const tonlib_api::ton_blockIdExt* block = nullptr;
+    switch (function.get_id()) {
+        case tonlib_api::withBlock::ID:
+            block = static_cast<const tonlib_api::withBlock&>(function).id_.get();
+            break;
+        case tonlib_api::blocks_getShards::ID:
+            block = static_cast<const tonlib_api::blocks_getShards&>(function).id_.get();
+            break;
+        case tonlib_api::blocks_getTransactions::ID:
+            block = static_cast<const tonlib_api::blocks_getTransactions&>(function).id_.get();
+            break;
+        default:
+            break;
+    }
+    // Shard blocks can't be matched against masterchain seqnos, errors of their hedges are ignored instead
+    return block != nullptr && block->workchain_ == ton::masterchainId ? block->seqno_ : 0;
+}
+
+auto get_config(tonlib_api::Function& function) -> tonlib_api::config*
+{
+    switch (function.get_id()) {
+        case tonlib_api::init::ID: {
+            auto& init = static_cast<tonlib_api::init&>(function);
+            return init.options_ != nullptr ? init.options_->config_.get() : nullptr;
+        }
+        case tonlib_api::options_setConfig::ID:
+            return static_cast<tonlib_api::options_setConfig&>(function).config_.get();
+        default:
+            return nullptr;
+    }
+}
+
+auto create_tonlib_client(size_t index) -> td::actor::ActorOwn<tonlib::TonlibClient>
+{
+    class Callback final : public tonlib::TonlibCallback {
+    public:
+        explicit Callback() = default;
+        void on_result(std::uint64_t id, tonlib_api::object_ptr<tonlib_api::Object> result) final {}
+        void on_error(std::uint64_t id, tonlib_api::object_ptr<tonlib_api::error> error) final {}
+        Callback(const Callback&) = delete;
+        Callback& operator=(const Callback&) = delete;
+        Callback(Callback&&) = delete;
+        Callback& operator=(Callback&&) = delete;
+    };
+
+    return td::actor::create_actor<tonlib::TonlibClient>(td::actor::ActorOptions().with_name(PSLICE() << "Tonlib" << index),
+                                                         td::make_unique<Callback>());
+}
+
+// Splits global config into configs with a single lite server each
+auto split_lite_servers(const std::string& config) -> td::Result<std::vector<std::string>>
+{
+    auto find_lite_servers = [&](td::JsonValue& json) -> td::Result<std::vector<td::JsonValue>*> {
+        if (json.type() != td::JsonValue::Type::Object) {
+            return td::Status::Error("Expected config object");
+        }
+        for (auto& field : json.get_object()) {
+            if (field.first == td::Slice{"liteservers"} && field.second.type() == td::JsonValue::Type::Array) {
+                return &field.second.get_array();
+            }
+        }
+        return td::Status::Error("Lite servers not found");
+    };
+
+    std::vector<std::string> result;
+    for (size_t i = 0;; ++i) {
+        std::string buffer = config;
+        TRY_RESULT(json, td::json_decode(td::MutableSlice{buffer}))
+        TRY_RESULT(lite_servers, find_lite_servers(json))
+        if (i >= lite_servers->size()) {
+            break;
+        }
+
+        auto lite_server = std::move((*lite_servers)[i]);
+        lite_servers->clear();
+        lite_servers->emplace_back(std::move(lite_server));
+        result.emplace_back(td::json_encode<std::string>(json));
+    }
+    return result;
+}
+
+}  // namespace
+
+void LatencyTracker::add(double latency)
+{
+    if (samples_.size() < capacity) {
+        samples_.emplace_back(latency);
+    }
+    else {
+        samples_[position_] = latency;
+        position_ = (position_ + 1) % capacity;
+    }
+    added_since_update_++;
+}
+
+auto LatencyTracker::quantile(double q) -> double
+{
+    if (samples_.empty()) {
+        return 0.0;
+    }
+    if (q != cached_q_ || added_since_update_ >= min_latency_samples) {
+        auto sorted = samples_;
+        const auto index = std::min(static_cast<size_t>(q * static_cast<double>(sorted.size())), sorted.size() - 1);
+        std::nth_element(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(index), sorted.end());
+        cached_quantile_ = sorted[index];
+        cached_q_ = q;
+        added_since_update_ = 0;
+    }
+    return cached_quantile_;
+}
+
+RequestDispatcher::RequestDispatcher(const Client::Options& options, std::shared_ptr<DispatcherCounters> counters, std::shared_ptr<LogTag> log_tag,
+                                     std::shared_ptr<WorkerPool> workers)
+    : options_{options}
+    , counters_{std::move(counters)}
+    , log_tag_{std::move(log_tag)}
+    , workers_{std::move(workers)}
+{
+    if (!options_.cache_dir.empty() || !options_.state_file.empty()) {
+        CHECK(workers_ != nullptr)
+    }
+    if (!options_.cache_dir.empty()) {
+        cache_ = std::make_shared<ImmutableCache>(options_.cache_dir, options_.cache_max_size);
+    }
+}
+
+void RequestDispatcher::start_up()
+{
+    // Scheduler of each client has a single cpu thread, so all of its actors are covered by this tag
+    LogSink::set_thread_tag(log_tag_);
+
+    create_backend();
+    backends_[primary_backend].ready = true;
+    update_backend_stats();
+
+    if (cache_ != nullptr) {
+        // Entries left by previous runs may already exceed the limit
+        workers_->run<td::Unit>([cache = cache_]() -> td::Result<td::Unit> {
+            TRY_STATUS(cache->trim())
+            return td::Unit{};
+        }, td::PromiseCreator::lambda([](td::Result<td::Unit> R) {
+            if (R.is_error()) {
+                LOG(WARNING) << "Failed to trim cache: " << R.error();
+            }
+        }));
+    }
+
+    if (!options_.state_file.empty()) {
+        workers_->run<SyncState>([path = options_.state_file]() { return load_sync_state(path); },
+                                 td::PromiseCreator::lambda([self = actor_id(this)](td::Result<SyncState> R) {
+                                     td::actor::send_closure(self, &RequestDispatcher::on_sync_state_loaded, std::move(R));
+                                 }));
+    }
+    else {
+        sync_state_loaded_ = true;
+    }
+}
+
+void RequestDispatcher::hangup()
+{
+    for (auto& queue : queues_) {
+        for (auto& entry : queue) {
+            entry.promise.set_error(td::Status::Error("Client closed"));
+        }
+        queue.clear();
+    }
+    for (auto& lane : counters_->lanes) {
+        lane.queued = 0;
+    }
+    for (auto& [id, query] : queries_) {
+        query.promise.set_error(td::Status::Error("Client closed"));
+    }
+    queries_.clear();
+    for (auto& [priority, entry] : waiting_for_state_) {
+        entry.promise.set_error(td::Status::Error("Client closed"));
+    }
+    waiting_for_state_.clear();
+    for (auto& promise : ready_waiters_) {
+        promise.set_error(td::Status::Error("Client closed"));
+    }
+    ready_waiters_.clear();
+    stop();
+}
+
+void RequestDispatcher::alarm()
+{
+    const auto now = td::Time::now();
+    while (!hedge_timers_.empty() && hedge_timers_.begin()->first <= now) {
+        const auto query_id = hedge_timers_.begin()->second;
+        hedge_timers_.erase(hedge_timers_.begin());
+        hedge(query_id);
+    }
+    if (state_save_at_ && state_save_at_.is_in_past()) {
+        state_save_at_ = td::Timestamp::never();
+        sync_backend(primary_backend);
+    }
+    update_alarm();
+}
+
+void RequestDispatcher::request(Client::Request request, Priority priority, td::Promise<Client::Response> promise)
+{
+    if (cache_ != nullptr) {
+        if (auto key = ImmutableCache::make_key(*request); !key.empty()) {
+            // File IO may block on slow disks, so it never runs on the scheduler thread
+            workers_->run<Client::Response>(
+                [cache = cache_, key]() { return cache->lookup(key); },
+                td::PromiseCreator::lambda([self = actor_id(this), key, request = std::move(request), priority,
+                                            promise = std::move(promise)](td::Result<Client::Response> R) mutable {
+                    td::actor::send_closure(self, &RequestDispatcher::on_cache_lookup, std::move(key), std::move(request), priority,
+                                            std::move(promise), std::move(R));
+                }));
+            return;
+        }
+    }
+    enqueue(std::move(request), priority, std::move(promise));
+}
+
+void RequestDispatcher::on_cache_lookup(std::string key, Client::Request request, Priority priority, td::Promise<Client::Response> promise,
+                                        td::Result<Client::Response> result)
+{
+    if (result.is_ok()) {
+        counters_->cache_hits++;
+        promise.set_value(result.move_as_ok());
+        return;
+    }
+    counters_->cache_misses++;
+
+    promise = td::PromiseCreator::lambda([cache = cache_, workers = workers_, key = std::move(key), promise = std::move(promise)](
+                                             td::Result<Client::Response> R) mutable {
+        if (R.is_error() || R.ok() == nullptr || R.ok()->get_id() == tonlib_api::error::ID) {
+            promise.set_result(std::move(R));
+            return;
+        }
+        // The response is handed over after it is stored, so a repeated request right away hits the cache
+        workers->run<Client::Response>(
+            [cache = std::move(cache), key = std::move(key), response = R.move_as_ok()]() mutable -> td::Result<Client::Response> {
+                auto status = cache->store(key, *response);
+                if (status.is_error()) {
+                    LOG(WARNING) << "Failed to store cache entry: " << status;
+                }
+                return std::move(response);
+            },
+            std::move(promise));
+    });
+    enqueue(std::move(request), priority, std::move(promise));
+}
+
+void RequestDispatcher::enqueue(Client::Request request, Priority priority, td::Promise<Client::Response> promise)
+{
+    const auto lane = static_cast<size_t>(priority);
+    auto& queue = queues_[lane];
+
+    if (queue.empty() && can_start(priority)) {
+        start(priority, Entry{std::move(request), std::move(promise), td::Timestamp::now()});
+        return;
+    }
+
+    if (options_.max_queue_size != 0 && queue.size() >= options_.max_queue_size) {
+        counters_->lanes[lane].rejected++;
+        promise.set_error(td::Status::Error("Request queue is full"));
+        return;
+    }
+
+    queue.emplace_back(Entry{std::move(request), std::move(promise), td::Timestamp::now()});
+    counters_->lanes[lane].queued = queue.size();
+}
+
+void RequestDispatcher::wait_ready(td::Promise<Client::Response> promise)
+{
+    if (synced_block_ != nullptr) {
+        promise.set_value(tl_clone(*synced_block_));
+        return;
+    }
+    ready_waiters_.emplace_back(std::move(promise));
+}
+
+void RequestDispatcher::on_response(Priority priority)
+{
+    const auto lane = static_cast<size_t>(priority);
+    CHECK(in_flight_[lane] > 0 && total_in_flight_ > 0)
+    in_flight_[lane]--;
+    total_in_flight_--;
+    counters_->lanes[lane].in_flight = in_flight_[lane];
+
+    flush();
+}
+
+void RequestDispatcher::flush()
+{
+    // Lanes are ordered by priority, so interactive requests are always started first
+    for (size_t lane = 0; lane < priority_count; ++lane) {
+        const auto priority = static_cast<Priority>(lane);
+        auto& queue = queues_[lane];
+        while (!queue.empty() && can_start(priority)) {
+            auto entry = std::move(queue.front());
+            queue.pop_front();
+            start(priority, std::move(entry));
+        }
+        counters_->lanes[lane].queued = queue.size();
+    }
+}
+
+auto RequestDispatcher::can_start(Priority priority) const -> bool
+{
+    return total_in_flight_ < options_.max_in_flight && in_flight_[static_cast<size_t>(priority)] < lane_limit(options_, priority);
+}
+
+void RequestDispatcher::start(Priority priority, Entry&& entry)
+{
+    const auto lane = static_cast<size_t>(priority);
+    auto& counters = counters_->lanes[lane];
+
+    const auto wait_us = static_cast<uint64_t>(std::max(td::Time::now() - entry.enqueued_at.at(), 0.0) * 1e6);
+    const auto avg_wait_us = counters.avg_wait_us.load(std::memory_order_relaxed);
+    counters.avg_wait_us = avg_wait_us + wait_us / wait_ewma_factor - avg_wait_us / wait_ewma_factor;
+    if (wait_us > counters.max_wait_us.load(std::memory_order_relaxed)) {
+        counters.max_wait_us = wait_us;
+    }
+    counters.started++;
+
+    in_flight_[lane]++;
+    total_in_flight_++;
+    counters.in_flight = in_flight_[lane];
+
+    // Requests after a waiting init must reach tonlib after it
+    if (!waiting_for_state_.empty() || (!sync_state_loaded_ && get_config(*entry.request) != nullptr)) {
+        waiting_for_state_.emplace_back(priority, std::move(entry));
+        return;
+    }
+    dispatch(priority, std::move(entry));
+}
+
+void RequestDispatcher::dispatch(Priority priority, Entry&& entry)
+{
+    if (auto* config = get_config(*entry.request); config != nullptr) {
+        restore_sync_state(*config);
+        entry.promise = td::PromiseCreator::lambda(
+            [self = actor_id(this), promise = std::move(entry.promise)](td::Result<Client::Response> R) mutable {
+                td::actor::send_closure(self, &RequestDispatcher::on_primary_init, R.is_ok() ? td::Status::OK() : R.error().clone());
+                promise.set_result(std::move(R));
+            });
+    }
+
+    if (options_.pin_lite_servers && get_config(*entry.request) != nullptr) {
+        init_backends(priority, std::move(entry.request), std::move(entry.promise));
+    }
+    else if (is_read_only(*entry.request) && ready_backends() > 1) {
+        auto backend = select_backend(backends_.size(), get_pinned_seqno(*entry.request));
+        if (backend == backends_.size()) {
+            refresh_backends(get_pinned_seqno(*entry.request));
+            backend = primary_backend;
+        }
+        send_query(priority, backend, std::move(entry.request), std::move(entry.promise), true);
+    }
+    else {
+        send_query(priority, primary_backend, std::move(entry.request), std::move(entry.promise), false);
+    }
+}
+
+void RequestDispatcher::create_backend()
+{
+    Backend backend{};
+    backend.client = create_tonlib_client(backends_.size());
+    backends_.emplace_back(std::move(backend));
+}
+
+void RequestDispatcher::init_backends(Priority priority, Client::Request&& request, td::Promise<Client::Response>&& promise)
+{
+    auto r_configs = split_lite_servers(get_config(*request)->config_);
+    if (r_configs.is_error() || r_configs.ok().size() < 2) {
+        retire_backends(1);
+        send_query(priority, primary_backend, std::move(request), std::move(promise), false);
+        return;
+    }
+    auto configs = r_configs.move_as_ok();
+
+    retire_backends(configs.size());
+    while (backends_.size() < configs.size()) {
+        create_backend();
+    }
+
+    for (size_t i = 1; i < configs.size(); ++i) {
+        auto backend_request = tl_clone(*request);
+        get_config(*backend_request)->config_ = configs[i];
+        if (backend_request->get_id() == tonlib_api::init::ID) {
+            // Additional backends only serve read-only requests, so they must not touch the primary keystore
+            auto& init = static_cast<tonlib_api::init&>(*backend_request);
+            init.options_->keystore_type_ = tonlib_api::make_object<tonlib_api::keyStoreTypeInMemory>();
+        }
+
+        auto& backend = backends_[i];
+        if (backend.client.empty()) {
+            // Retired earlier but still waiting for its outstanding requests
+            backend.client = create_tonlib_client(i);
+        }
+        backend.ready = false;
+        backend.init_epoch = next_init_epoch_++;
+        auto P = td::PromiseCreator::lambda([self = actor_id(this), i, epoch = backend.init_epoch](td::Result<Client::Response> R) {
+            td::actor::send_closure(self, &RequestDispatcher::on_backend_init, i, epoch, std::move(R));
+        });
+        td::actor::send_closure(backends_[i].client, &tonlib::TonlibClient::request_async, std::move(backend_request), std::move(P));
+    }
+
+    get_config(*request)->config_ = std::move(configs[primary_backend]);
+    send_query(priority, primary_backend, std::move(request), std::move(promise), false);
+    update_backend_stats();
+}
+
+void RequestDispatcher::on_backend_init(size_t backend, uint64_t epoch, td::Result<Client::Response> result)
+{
+    if (backend >= backends_.size() || backends_[backend].init_epoch != epoch || backends_[backend].client.empty()) {
+        return;
+    }
+    if (result.is_error()) {
+        LOG(WARNING) << "Failed to init backend " << backend << ": " << result.error();
+    }
+    backends_[backend].ready = result.is_ok();
+    update_backend_stats();
+
+    if (result.is_ok()) {
+        // Opens the connection and loads the last block now instead of on the first routed request
+        sync_backend(backend);
+    }
+}
+
+void RequestDispatcher::on_primary_init(td::Status status)
+{
+    if (status.is_error()) {
+        for (auto& promise : ready_waiters_) {
+            promise.set_error(status.clone());
+        }
+        ready_waiters_.clear();
+        return;
+    }
+    sync_backend(primary_backend);
+}
+
+void RequestDispatcher::retire_backends(size_t count)
+{
+    // Backends beyond the new server list would keep serving the previous config
+    for (size_t i = std::max<size_t>(count, 1); i < backends_.size(); ++i) {
+        auto& backend = backends_[i];
+        backend.ready = false;
+        backend.client.reset();
+    }
+    trim_backends();
+    update_backend_stats();
+}
+
+void RequestDispatcher::trim_backends()
+{
+    // Attempts refer to backends by index, so retired slots are removed from the end once they are idle
+    while (backends_.size() > 1 && backends_.back().client.empty() && backends_.back().outstanding == 0) {
+        backends_.pop_back();
+    }
+    if (next_backend_ >= backends_.size()) {
+        next_backend_ = 0;
+    }
+}
+
+auto RequestDispatcher::ready_backends() const -> size_t
+{
+    return static_cast<size_t>(std::count_if(backends_.begin(), backends_.end(), [](const Backend& backend) { return backend.ready; }));
+}
+
+auto RequestDispatcher::select_backend(size_t except, int32_t pinned_seqno) const -> size_t
+{
+    // Least outstanding requests, ties are broken in round-robin order
+    auto selected = backends_.size();
+    for (size_t offset = 0; offset < backends_.size(); ++offset) {
+        const auto i = (next_backend_ + offset) % backends_.size();
+        if (i == except || !backends_[i].ready || backends_[i].last_seqno < pinned_seqno) {
+            continue;
+        }
+        if (selected == backends_.size() || backends_[i].outstanding < backends_[selected].outstanding) {
+            selected = i;
+        }
+    }
+    return selected;
+}
+
+void RequestDispatcher::refresh_backends(int32_t pinned_seqno)
+{
+    // Backends only learn about new blocks from the responses they give, so lagging ones are synced again
+    for (size_t i = 0; i < backends_.size(); ++i) {
+        auto& backend = backends_[i];
+        if (i != primary_backend && backend.ready && !backend.syncing && backend.last_seqno < pinned_seqno) {
+            sync_backend(i);
+        }
+    }
+}
+
+void RequestDispatcher::send_query(Priority priority, size_t backend, Client::Request&& request, td::Promise<Client::Response>&& promise, bool read_only)
+{
+    const auto query_id = next_query_id_++;
+    next_backend_ = (backend + 1) % backends_.size();
+
+    Query query{priority, std::move(promise), {}, td::Time::now(), backend, read_only};
+    if (read_only && options_.hedge && latency_.size() >= min_latency_samples) {
+        // Most requests are answered before the hedge delay, so the copy is kept flat until it is needed
+        query.hedge_request = tl_serialize(*request);
+        query.pinned_seqno = get_pinned_seqno(*request);
+
+        const auto delay = std::max(latency_.quantile(options_.hedge_quantile), options_.min_hedge_delay_ms / 1000.0);
+        counters_->hedge_delay_us = static_cast<uint64_t>(delay * 1e6);
+        hedge_timers_.emplace(query.started_at + delay, query_id);
+        update_alarm();
+    }
+    queries_.emplace(query_id, std::move(query));
+
+    send_attempt(query_id, backend, std::move(request), false);
+}
+
+void RequestDispatcher::send_attempt(uint64_t query_id, size_t backend, Client::Request&& request, bool hedged)
+{
+    backends_[backend].outstanding++;
+    if (hedged) {
+        hedges_in_flight_++;
+    }
+
+    auto P = td::PromiseCreator::lambda([self = actor_id(this), query_id, backend, hedged, started_at = td::Time::now()](td::Result<Client::Response> R) {
+        td::actor::send_closure(self, &RequestDispatcher::on_attempt_result, query_id, backend, hedged, started_at, std::move(R));
+    });
+    td::actor::send_closure(backends_[backend].client, &tonlib::TonlibClient::request_async, std::move(request), std::move(P));
+}
+
+void RequestDispatcher::on_attempt_result(uint64_t query_id, size_t backend, bool hedged, double started_at, td::Result<Client::Response> result)
+{
+    const auto now = td::Time::now();
+
+    auto& stats = backends_[backend];
+    stats.outstanding--;
+    stats.completed++;
+    if (result.is_error()) {
+        stats.errors++;
+    }
+    stats.avg_latency += (now - started_at - stats.avg_latency) * latency_ewma_factor;
+    if (stats.client.empty()) {
+        trim_backends();
+    }
+
+    // Counted until the hedged request itself completes, even if the query was answered by the first attempt
+    if (hedged) {
+        hedges_in_flight_--;
+    }
+
+    auto it = queries_.find(query_id);
+    if (it == queries_.end()) {
+        // Response for the already answered hedged request
+        update_backend_stats();
+        return;
+    }
+
+    if (result.is_ok() && result.ok() != nullptr && result.ok()->get_id() == tonlib_api::liteServer_masterchainInfo::ID) {
+        const auto& info = static_cast<const tonlib_api::liteServer_masterchainInfo&>(*result.ok());
+        if (info.last_ != nullptr) {
+            stats.last_seqno = std::max(stats.last_seqno, info.last_->seqno_);
+        }
+    }
+
+    auto& query = it->second;
+    query.finished++;
+    if (result.is_error()) {
+        // A hedge may fail just because its lite server is behind, so it never replaces the error of the first attempt
+        if (!hedged) {
+            query.first_error = result.error().clone();
+        }
+        else if (query.first_error.is_error()) {
+            result = query.first_error.clone();
+        }
+        if (query.finished < query.attempts) {
+            // Wait for the other attempt
+            update_backend_stats();
+            return;
+        }
+    }
+
+    if (result.is_ok() && query.read_only) {
+        latency_.add(now - query.started_at);
+    }
+    if (hedged && result.is_ok()) {
+        counters_->hedge_wins++;
+    }
+
+    const auto priority = query.priority;
+    query.promise.set_result(std::move(result));
+    queries_.erase(it);
+
+    update_backend_stats();
+    on_response(priority);
+}
+
+void RequestDispatcher::hedge(uint64_t query_id)
+{
+    auto it = queries_.find(query_id);
+    if (it == queries_.end() || it->second.hedge_request.empty()) {
+        return;
+    }
+    auto& query = it->second;
+
+    // Hedged requests are limited to a small part of the capacity so they don't amplify overload
+    const auto max_hedges_in_flight = std::max<size_t>(options_.max_in_flight / 10, 1);
+    if (hedges_in_flight_ >= max_hedges_in_flight) {
+        return;
+    }
+
+    // Hedges to lite servers which don't have the pinned block yet would only fail
+    const auto backend = select_backend(query.first_backend, query.pinned_seqno);
+    if (backend == backends_.size()) {
+        refresh_backends(query.pinned_seqno);
+        return;
+    }
+
+    auto r_request = tl_deserialize<tonlib_api::Function>(query.hedge_request);
+    query.hedge_request.clear();
+    if (r_request.is_error()) {
+        LOG(ERROR) << "Failed to restore hedged request: " << r_request.error();
+        return;
+    }
+
+    query.attempts++;
+    counters_->hedged++;
+    send_attempt(query_id, backend, r_request.move_as_ok(), true);
+}
+
+void RequestDispatcher::on_sync_state_loaded(td::Result<SyncState> result)
+{
+    if (result.is_ok()) {
+        sync_state_ = result.move_as_ok();
+    }
+    else {
+        // Missing on the first start
+        LOG(INFO) << "Sync state not restored: " << result.error();
+    }
+    sync_state_loaded_ = true;
+
+    auto waiting = std::move(waiting_for_state_);
+    for (auto& [priority, entry] : waiting) {
+        dispatch(priority, std::move(entry));
+    }
+}
+
+void RequestDispatcher::restore_sync_state(tonlib_api::config& config)
+{
+    if (options_.state_file.empty()) {
+        return;
+    }
+
+    auto r_root = get_trust_root(config.config_);
+    if (r_root.is_error()) {
+        LOG(WARNING) << "Sync state is not saved: " << r_root.error();
+        trust_root_ = nullptr;
+        return;
+    }
+    trust_root_ = r_root.move_as_ok();
+
+    if (sync_state_.block == nullptr) {
+        return;
+    }
+    auto r_config = apply_sync_state(config.config_, sync_state_);
+    if (r_config.is_error()) {
+        LOG(WARNING) << "Failed to apply sync state: " << r_config.error();
+        sync_state_ = SyncState{};
+        return;
+    }
+    config.config_ = r_config.move_as_ok();
+}
+
+void RequestDispatcher::sync_backend(size_t backend)
+{
+    backends_[backend].syncing = true;
+    auto P = td::PromiseCreator::lambda([self = actor_id(this), backend](td::Result<Client::Response> R) {
+        td::actor::send_closure(self, &RequestDispatcher::on_backend_sync, backend, std::move(R));
+    });
+    td::actor::send_closure(backends_[backend].client, &tonlib::TonlibClient::request_async, tonlib_api::make_object<tonlib_api::sync>(),
+                            std::move(P));
+}
+
+void RequestDispatcher::on_backend_sync(size_t backend, td::Result<Client::Response> result)
+{
+    auto r_block = expect_object<tonlib_api::ton_blockIdExt>(std::move(result));
+    if (r_block.is_error()) {
+        LOG(WARNING) << "Failed to sync backend " << backend << ": " << r_block.error();
+    }
+    if (backend >= backends_.size()) {
+        // Retired and trimmed while syncing
+        return;
+    }
+    backends_[backend].syncing = false;
+    if (r_block.is_ok()) {
+        backends_[backend].last_seqno = std::max(backends_[backend].last_seqno, r_block.ok()->seqno_);
+    }
+    if (backend != primary_backend) {
+        return;
+    }
+
+    if (!options_.state_file.empty()) {
+        state_save_at_ = td::Timestamp::in(options_.state_save_interval_ms / 1000.0);
+        update_alarm();
+    }
+
+    if (r_block.is_error()) {
+        for (auto& promise : ready_waiters_) {
+            promise.set_error(r_block.error().clone());
+        }
+        ready_waiters_.clear();
+        return;
+    }
+    synced_block_ = r_block.move_as_ok();
+
+    for (auto& promise : ready_waiters_) {
+        promise.set_value(tl_clone(*synced_block_));
+    }
+    ready_waiters_.clear();
+
+    // Only key blocks are saved, since tonlib can only start syncing from them
+    if (trust_root_ != nullptr) {
+        send_primary(tonlib_api::make_object<tonlib_api::blocks_getBlockHeader>(tl_clone(*synced_block_)),
+                     [](td::actor::ActorId<RequestDispatcher> self, td::Result<Client::Response> result) {
+                         td::actor::send_closure(self, &RequestDispatcher::on_synced_header, std::move(result));
+                     });
+    }
+}
+
+template <typename F>
+void RequestDispatcher::send_primary(Client::Request&& request, F&& handler)
+{
+    td::actor::send_closure(backends_[primary_backend].client, &tonlib::TonlibClient::request_async, std::move(request),
+                            td::PromiseCreator::lambda([self = actor_id(this), handler = std::forward<F>(handler)](td::Result<Client::Response> result) mutable {
+                                handler(self, std::move(result));
+                            }));
+}
+
+void RequestDispatcher::on_synced_header(td::Result<Client::Response> result)
+{
+    auto r_header = expect_object<tonlib_api::blocks_header>(std::move(result));
+    if (r_header.is_error()) {
+        LOG(WARNING) << "Failed to find the last key block: " << r_header.error();
+        return;
+    }
+    auto header = r_header.move_as_ok();
+
+    const auto key_seqno = header->is_key_block_ ? header->id_->seqno_ : header->prev_key_block_seqno_;
+    const auto saved_seqno = sync_state_.block != nullptr ? sync_state_.block->seqno_ : 0;
+    if (trust_root_ == nullptr || key_seqno <= std::max(trust_root_->seqno_, saved_seqno)) {
+        return;
+    }
+    if (header->is_key_block_) {
+        on_key_block_header(Client::Response{std::move(header)});
+        return;
+    }
+
+    auto block_id = tonlib_api::make_object<tonlib_api::ton_blockId>(header->id_->workchain_, header->id_->shard_, key_seqno);
+    send_primary(tonlib_api::make_object<tonlib_api::blocks_lookupBlock>(lookup_by_seqno, std::move(block_id), 0, 0),
+                 [](td::actor::ActorId<RequestDispatcher> self, td::Result<Client::Response> result) {
+                     td::actor::send_closure(self, &RequestDispatcher::on_key_block_lookup, std::move(result));
+                 });
+}
+
+void RequestDispatcher::on_key_block_lookup(td::Result<Client::Response> result)
+{
+    auto r_block = expect_object<tonlib_api::ton_blockIdExt>(std::move(result));
+    if (r_block.is_error()) {
+        LOG(WARNING) << "Failed to find the last key block: " << r_block.error();
+        return;
+    }
+    // The header is checked against the block hash, so it confirms that the block is a key block
+    send_primary(tonlib_api::make_object<tonlib_api::blocks_getBlockHeader>(r_block.move_as_ok()),
+                 [](td::actor::ActorId<RequestDispatcher> self, td::Result<Client::Response> result) {
+                     td::actor::send_closure(self, &RequestDispatcher::on_key_block_header, std::move(result));
+                 });
+}
+
+void RequestDispatcher::on_key_block_header(td::Result<Client::Response> result)
+{
+    auto r_header = expect_object<tonlib_api::blocks_header>(std::move(result));
+    if (r_header.is_error()) {
+        LOG(WARNING) << "Failed to find the last key block: " << r_header.error();
+        return;
+    }
+    auto header = r_header.move_as_ok();
+    if (!header->is_key_block_ || trust_root_ == nullptr) {
+        LOG(WARNING) << "Block " << header->id_->seqno_ << " is not a key block";
+        return;
+    }
+
+    sync_state_ = SyncState{std::move(header->id_), tl_clone(*trust_root_)};
+    SyncState state{tl_clone(*sync_state_.block), tl_clone(*sync_state_.root)};
+    // File IO may block on slow disks, so it never runs on the scheduler thread
+    workers_->run<td::Unit>(
+        [path = options_.state_file, state = std::move(state)]() -> td::Result<td::Unit> {
+            TRY_STATUS(save_sync_state(path, state))
+            return td::Unit{};
+        },
+        td::PromiseCreator::lambda([](td::Result<td::Unit> R) {
+            if (R.is_error()) {
+                LOG(WARNING) << "Failed to save sync state: " << R.error();
+            }
+        }));
+}
+
+void RequestDispatcher::update_alarm()
+{
+    auto timestamp = state_save_at_;
+    if (!hedge_timers_.empty()) {
+        timestamp.relax(td::Timestamp::at(hedge_timers_.begin()->first));
+    }
+    alarm_timestamp() = timestamp;
+}
+
+void RequestDispatcher::update_backend_stats()
+{
+    std::lock_guard<std::mutex> guard{counters_->backends_mutex};
+    auto& stats = counters_->backends;
+    stats.resize(backends_.size());
+    for (size_t i = 0; i < backends_.size(); ++i) {
+        const auto& backend = backends_[i];
+        stats[i] = Client::BackendStats{
+            backend.ready,
+            backend.outstanding,
+            backend.completed,
+            backend.errors,
+            static_cast<uint64_t>(backend.avg_latency * 1e6),
+        };
+    }
+}
+
+}  // namespace tjs
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <td/actor/actor.h>
+#include <td/utils/Time.h>
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+
+#include "client.hpp"
+#include "immutable_cache.hpp"
+#include "log_sink.hpp"
+#include "sync_state.hpp"
+#include "worker_pool.hpp"
+
+namespace tonlib
+{
+class TonlibClient;
+}  // namespace tonlib
+
+namespace tjs
+{
+struct LaneCounters {
+    std::atomic<size_t> queued{0};
+    std::atomic<size_t> in_flight{0};
+    std::atomic<uint64_t> started{0};
+    std::atomic<uint64_t> rejected{0};
+    std::atomic<uint64_t> avg_wait_us{0};
+    std::atomic<uint64_t> max_wait_us{0};
+};
+
+struct DispatcherCounters {
+    std::array<LaneCounters, priority_count> lanes;
+
+    std::atomic<uint64_t> hedged{0};
+    std::atomic<uint64_t> hedge_wins{0};
+    std::atomic<uint64_t> hedge_delay_us{0};
+
+    std::atomic<uint64_t> cache_hits{0};
+    std::atomic<uint64_t> cache_misses{0};
+
+    std::mutex backends_mutex;  // for backends
+    std::vector<Client::BackendStats> backends;
+};
+
+class LatencyTracker final {
+public:
+    void add(double latency);
+    [[nodiscard]] auto quantile(double q) -> double;
+    [[nodiscard]] auto size() const -> size_t { return samples_.size(); }
+
+private:
+    static constexpr size_t capacity = 256;
+
+    std::vector<double> samples_;
+    size_t position_{0};
+    size_t added_since_update_{0};
+    double cached_quantile_{0.0};
+    double cached_q_{-1.0};
+};
+
+class RequestDispatcher final : public td::actor::Actor {
+public:
+    // `workers` runs cache and sync state IO, and may be null when both `cache_dir` and `state_file` are empty
+    RequestDispatcher(const Client::Options& options, std::shared_ptr<DispatcherCounters> counters, std::shared_ptr<LogTag> log_tag,
+                      std::shared_ptr<WorkerPool> workers);
+
+    void request(Client::Request request, Priority priority, td::Promise<Client::Response> promise);
+    void wait_ready(td::Promise<Client::Response> promise);
+
+private:
+    struct Entry {
+        Client::Request request;
+        td::Promise<Client::Response> promise;
+        td::Timestamp enqueued_at;
+    };
+
+    struct Backend {
+        td::actor::ActorOwn<tonlib::TonlibClient> client;
+        bool ready{false};
+        size_t outstanding{0};
+        uint64_t completed{0};
+        uint64_t errors{0};
+        double avg_latency{0.0};
+        // Identifies the latest init, so results of inits sent to a retired client are ignored
+        uint64_t init_epoch{0};
+        // Latest masterchain block the lite server is known to have
+        int32_t last_seqno{0};
+        bool syncing{false};
+    };
+
+    struct Query {
+        Priority priority;
+        td::Promise<Client::Response> promise;
+        // Serialized read-only request, which is parsed and sent to another backend only when the first one is too slow
+        std::string hedge_request;
+        double started_at;
+        size_t first_backend;
+        bool read_only;
+        // Masterchain block which the other backend must have for a hedge
+        int32_t pinned_seqno{0};
+        size_t attempts{1};
+        size_t finished{0};
+        // Error of the first attempt, which is reported instead of the error of a hedge
+        td::Status first_error;
+    };
+
+    void start_up() final;
+    void hangup() final;
+    void alarm() final;
+
+    void on_cache_lookup(std::string key, Client::Request request, Priority priority, td::Promise<Client::Response> promise,
+                         td::Result<Client::Response> result);
+    void enqueue(Client::Request request, Priority priority, td::Promise<Client::Response> promise);
+    void on_response(Priority priority);
+    void flush();
+    [[nodiscard]] auto can_start(Priority priority) const -> bool;
+    void start(Priority priority, Entry&& entry);
+    void dispatch(Priority priority, Entry&& entry);
+
+    void create_backend();
+    void init_backends(Priority priority, Client::Request&& request, td::Promise<Client::Response>&& promise);
+    void on_backend_init(size_t backend, uint64_t epoch, td::Result<Client::Response> result);
+    void retire_backends(size_t count);
+    void trim_backends();
+    void on_primary_init(td::Status status);
+    [[nodiscard]] auto ready_backends() const -> size_t;
+    // Returns `backends_.size()` if no ready backend has the pinned masterchain block
+    [[nodiscard]] auto select_backend(size_t except, int32_t pinned_seqno) const -> size_t;
+    void refresh_backends(int32_t pinned_seqno);
+
+    void send_query(Priority priority, size_t backend, Client::Request&& request, td::Promise<Client::Response>&& promise, bool read_only);
+    void send_attempt(uint64_t query_id, size_t backend, Client::Request&& request, bool hedged);
+    void on_attempt_result(uint64_t query_id, size_t backend, bool hedged, double started_at, td::Result<Client::Response> result);
+    void hedge(uint64_t query_id);
+
+    void on_sync_state_loaded(td::Result<SyncState> result);
+    void restore_sync_state(tonlib_api::config& config);
+    void sync_backend(size_t backend);
+    void on_backend_sync(size_t backend, td::Result<Client::Response> result);
+    void on_synced_header(td::Result<Client::Response> result);
+    void on_key_block_lookup(td::Result<Client::Response> result);
+    void on_key_block_header(td::Result<Client::Response> result);
+    template <typename F>
+    void send_primary(Client::Request&& request, F&& handler);
+
+    void update_alarm();
+    void update_backend_stats();
+
+    Client::Options options_;
+    std::shared_ptr<DispatcherCounters> counters_;
+    std::shared_ptr<LogTag> log_tag_;
+    std::shared_ptr<const ImmutableCache> cache_;
+    std::shared_ptr<WorkerPool> workers_;
+
+    std::array<std::deque<Entry>, priority_count> queues_;
+    std::array<size_t, priority_count> in_flight_{};
+    size_t total_in_flight_{0};
+
+    std::vector<Backend> backends_;
+    size_t next_backend_{0};
+    uint64_t next_init_epoch_{1};
+
+    std::unordered_map<uint64_t, Query> queries_;
+    uint64_t next_query_id_{1};
+    std::set<std::pair<double, uint64_t>> hedge_timers_;
+    size_t hedges_in_flight_{0};
+    LatencyTracker latency_;
+
+    tonlib_api::object_ptr<tonlib_api::ton_blockIdExt> synced_block_;
+    std::vector<td::Promise<Client::Response>> ready_waiters_;
+    td::Timestamp state_save_at_;
+    // Inits wait until the saved state is read, together with the requests started after them
+    bool sync_state_loaded_{false};
+    std::vector<std::pair<Priority, Entry>> waiting_for_state_;
+    SyncState sync_state_;
+    // Trusted block of the config before the saved state was applied
+    tonlib_api::object_ptr<tonlib_api::ton_blockIdExt> trust_root_;
+};
+
+}  // namespace tjs
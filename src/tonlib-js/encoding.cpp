@@ -0,0 +1,264 @@
+#include "encoding.hpp"
+
+#include <array>
+#include <cstring>
+
+namespace tjs
+{
+namespace
+{
+constexpr char base64_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+constexpr char base64url_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+constexpr char hex_alphabet[] = "0123456789abcdef";
+constexpr uint8_t invalid = 0xff;
+
+using CharPairs = std::array<std::array<char, 2>, 4096>;
+
+// Two base64 characters for each 12-bit group, so the main loop does two lookups per three bytes
+constexpr auto make_base64_pairs(const char* alphabet) -> CharPairs
+{
+    CharPairs result{};
+    for (size_t i = 0; i < result.size(); ++i) {
+        result[i][0] = alphabet[i >> 6u];
+        result[i][1] = alphabet[i & 0x3fu];
+    }
+    return result;
+}
+
+constexpr auto make_hex_pairs() -> std::array<std::array<char, 2>, 256>
+{
+    std::array<std::array<char, 2>, 256> result{};
+    for (size_t i = 0; i < result.size(); ++i) {
+        result[i][0] = hex_alphabet[i >> 4u];
+        result[i][1] = hex_alphabet[i & 0xfu];
+    }
+    return result;
+}
+
+constexpr auto make_base64_values() -> std::array<uint8_t, 256>
+{
+    std::array<uint8_t, 256> result{};
+    for (auto& value : result) {
+        value = invalid;
+    }
+    for (uint8_t i = 0; i < 64; ++i) {
+        result[static_cast<uint8_t>(base64_alphabet[i])] = i;
+        result[static_cast<uint8_t>(base64url_alphabet[i])] = i;
+    }
+    return result;
+}
+
+constexpr auto make_hex_values() -> std::array<uint8_t, 256>
+{
+    std::array<uint8_t, 256> result{};
+    for (auto& value : result) {
+        value = invalid;
+    }
+    for (uint8_t i = 0; i < 10; ++i) {
+        result['0' + i] = i;
+    }
+    for (uint8_t i = 0; i < 6; ++i) {
+        result['a' + i] = static_cast<uint8_t>(10 + i);
+        result['A' + i] = static_cast<uint8_t>(10 + i);
+    }
+    return result;
+}
+
+constexpr CharPairs base64_pairs = make_base64_pairs(base64_alphabet);
+constexpr CharPairs base64url_pairs = make_base64_pairs(base64url_alphabet);
+constexpr auto hex_pairs = make_hex_pairs();
+constexpr auto base64_values = make_base64_values();
+constexpr auto hex_values = make_hex_values();
+
+void encode_base64_impl(td::Slice data, char* dest, const CharPairs& pairs, const char* alphabet, bool padding)
+{
+    const auto* src = data.ubegin();
+    const auto size = data.size();
+
+    size_t i = 0;
+    for (; i + 3 <= size; i += 3) {
+        const uint32_t value = (static_cast<uint32_t>(src[i]) << 16u) | (static_cast<uint32_t>(src[i + 1]) << 8u) | src[i + 2];
+        std::memcpy(dest, pairs[value >> 12u].data(), 2);
+        std::memcpy(dest + 2, pairs[value & 0xfffu].data(), 2);
+        dest += 4;
+    }
+
+    const auto rest = size - i;
+    if (rest == 0) {
+        return;
+    }
+
+    uint32_t value = static_cast<uint32_t>(src[i]) << 16u;
+    if (rest == 2) {
+        value |= static_cast<uint32_t>(src[i + 1]) << 8u;
+    }
+    *dest++ = alphabet[(value >> 18u) & 0x3fu];
+    *dest++ = alphabet[(value >> 12u) & 0x3fu];
+    if (rest == 2) {
+        *dest++ = alphabet[(value >> 6u) & 0x3fu];
+    }
+    if (padding) {
+        *dest++ = '=';
+        if (rest == 1) {
+            *dest = '=';
+        }
+    }
+}
+
+void encode_hex_impl(td::Slice data, char* dest)
+{
+    const auto* src = data.ubegin();
+    for (size_t i = 0; i < data.size(); ++i) {
+        std::memcpy(dest + 2 * i, hex_pairs[src[i]].data(), 2);
+    }
+}
+
+}  // namespace
+
+auto parse_bytes_encoding(td::Slice name) -> td::Result<BytesEncoding>
+{
+    if (name == td::Slice{"arraybuffer"}) {
+        return BytesEncoding::ArrayBuffer;
+    }
+    if (name == td::Slice{"base64"}) {
+        return BytesEncoding::Base64;
+    }
+    if (name == td::Slice{"base64url"}) {
+        return BytesEncoding::Base64Url;
+    }
+    if (name == td::Slice{"hex"}) {
+        return BytesEncoding::Hex;
+    }
+    return td::Status::Error(PSLICE() << "Unknown bytes encoding " << name);
+}
+
+auto encoded_size(BytesEncoding encoding, size_t size) -> size_t
+{
+    switch (encoding) {
+        case BytesEncoding::ArrayBuffer:
+            return size;
+        case BytesEncoding::Base64:
+            return (size + 2) / 3 * 4;
+        case BytesEncoding::Base64Url:
+            return (size * 4 + 2) / 3;
+        case BytesEncoding::Hex:
+            return size * 2;
+        default:
+            UNREACHABLE();
+    }
+}
+
+void encode_bytes(BytesEncoding encoding, td::Slice data, char* dest)
+{
+    switch (encoding) {
+        case BytesEncoding::ArrayBuffer:
+            std::memcpy(dest, data.data(), data.size());
+            break;
+        case BytesEncoding::Base64:
+            encode_base64_impl(data, dest, base64_pairs, base64_alphabet, true);
+            break;
+        case BytesEncoding::Base64Url:
+            encode_base64_impl(data, dest, base64url_pairs, base64url_alphabet, false);
+            break;
+        case BytesEncoding::Hex:
+            encode_hex_impl(data, dest);
+            break;
+        default:
+            UNREACHABLE();
+    }
+}
+
+auto decode_base64(td::Slice data, std::string& to) -> td::Status
+{
+    // Padding is optional, but when present it must complete the last group
+    size_t padding = 0;
+    while (!data.empty() && data.back() == '=') {
+        data.remove_suffix(1);
+        ++padding;
+    }
+    if (padding > 2 || (padding != 0 && (data.size() + padding) % 4 != 0)) {
+        return td::Status::Error("Invalid base64 padding");
+    }
+    if (data.size() % 4 == 1) {
+        return td::Status::Error("Invalid base64 length");
+    }
+
+    const auto* src = data.ubegin();
+    const auto size = data.size();
+    to.resize(size / 4 * 3 + (size % 4 == 0 ? 0 : size % 4 - 1));
+    auto* dest = reinterpret_cast<uint8_t*>(&to[0]);
+
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        const uint8_t a = base64_values[src[i]];
+        const uint8_t b = base64_values[src[i + 1]];
+        const uint8_t c = base64_values[src[i + 2]];
+        const uint8_t d = base64_values[src[i + 3]];
+        if (((a | b | c | d) & 0x80u) != 0) {
+            return td::Status::Error("Invalid base64 character");
+        }
+        const uint32_t value = (static_cast<uint32_t>(a) << 18u) | (static_cast<uint32_t>(b) << 12u) | (static_cast<uint32_t>(c) << 6u) | d;
+        dest[0] = static_cast<uint8_t>(value >> 16u);
+        dest[1] = static_cast<uint8_t>(value >> 8u);
+        dest[2] = static_cast<uint8_t>(value);
+        dest += 3;
+    }
+
+    const auto rest = size - i;
+    if (rest == 0) {
+        return td::Status::OK();
+    }
+
+    uint32_t value = 0;
+    for (size_t j = 0; j < rest; ++j) {
+        const uint8_t x = base64_values[src[i + j]];
+        if (x == invalid) {
+            return td::Status::Error("Invalid base64 character");
+        }
+        value |= static_cast<uint32_t>(x) << (18u - 6u * j);
+    }
+    // Bits after the last byte must be zero, like td's decoder requires, so each byte string has a single encoding
+    if ((value & (rest == 2 ? 0xffffu : 0xffu)) != 0) {
+        return td::Status::Error("Invalid base64 trailing bits");
+    }
+    *dest++ = static_cast<uint8_t>(value >> 16u);
+    if (rest == 3) {
+        *dest = static_cast<uint8_t>(value >> 8u);
+    }
+    return td::Status::OK();
+}
+
+auto decode_hex(td::Slice data, std::string& to) -> td::Status
+{
+    if (data.size() % 2 != 0) {
+        return td::Status::Error("Invalid hex length");
+    }
+
+    const auto* src = data.ubegin();
+    to.resize(data.size() / 2);
+    for (size_t i = 0; i < to.size(); ++i) {
+        const uint8_t hi = hex_values[src[2 * i]];
+        const uint8_t lo = hex_values[src[2 * i + 1]];
+        if (((hi | lo) & 0x80u) != 0) {
+            return td::Status::Error("Invalid hex character");
+        }
+        to[i] = static_cast<char>((hi << 4u) | lo);
+    }
+    return td::Status::OK();
+}
+
+auto decode_bytes(BytesEncoding encoding, td::Slice data, std::string& to) -> td::Status
+{
+    switch (encoding) {
+        case BytesEncoding::Hex:
+            return decode_hex(data, to);
+        case BytesEncoding::ArrayBuffer:
+        case BytesEncoding::Base64:
+        case BytesEncoding::Base64Url:
+            return decode_base64(data, to);
+        default:
+            UNREACHABLE();
+    }
+}
+
+}  // namespace tjs
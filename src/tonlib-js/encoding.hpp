@@ -0,0 +1,30 @@
+#pragma once
+
+#include <td/utils/Slice.h>
+#include <td/utils/Status.h>
+
+#include <string>
+
+namespace tjs
+{
+enum class BytesEncoding {
+    ArrayBuffer,
+    Base64,
+    Base64Url,
+    Hex,
+};
+
+auto parse_bytes_encoding(td::Slice name) -> td::Result<BytesEncoding>;
+
+auto encoded_size(BytesEncoding encoding, size_t size) -> size_t;
+
+// Writes exactly `encoded_size(encoding, data.size())` bytes to `dest`
+void encode_bytes(BytesEncoding encoding, td::Slice data, char* dest);
+
+// Accepts both base64 alphabets, padding is optional
+auto decode_base64(td::Slice data, std::string& to) -> td::Status;
+auto decode_hex(td::Slice data, std::string& to) -> td::Status;
+
+auto decode_bytes(BytesEncoding encoding, td::Slice data, std::string& to) -> td::Status;
+
+}  // namespace tjs
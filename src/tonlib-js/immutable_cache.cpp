@@ -0,0 +1,202 @@
+#include "immutable_cache.hpp"
+
+#include <td/utils/Random.h>
+#include <td/utils/crypto.h>
+#include <td/utils/filesystem.h>
+#include <td/utils/misc.h>
+#include <td/utils/port/FileFd.h>
+#include <td/utils/port/MemoryMapping.h>
+#include <td/utils/port/Stat.h>
+#include <td/utils/port/path.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "tl_utils.hpp"
+
+namespace tjs
+{
+namespace
+{
+constexpr uint32_t entry_magic = 0x434a5354;
+// Bumped whenever the layout of entries or the set of cached requests changes
+constexpr uint32_t entry_version = 2;
+constexpr size_t entry_header_size = 16;
+
+// Part of the size limit written between trims
+constexpr size_t trim_interval_divisor = 16;
+// Part of the size limit which is kept after a trim, in percent
+constexpr size_t trim_target_percent = 90;
+
+struct EntryHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t size;
+};
+static_assert(sizeof(EntryHeader) == entry_header_size, "Unexpected entry header layout");
+
+auto is_full_block_id(const tonlib_api::object_ptr<tonlib_api::ton_blockIdExt>& block) -> bool
+{
+    return block != nullptr && block->root_hash_.size() == 32 && block->file_hash_.size() == 32;
+}
+
+auto is_transaction_id(const tonlib_api::object_ptr<tonlib_api::internal_transactionId>& id) -> bool
+{
+    return id != nullptr && id->lt_ != 0 && id->hash_.size() == 32;
+}
+
+}  // namespace
+
+ImmutableCache::ImmutableCache(std::string directory, size_t max_size)
+    : directory_{std::move(directory)}
+    , max_size_{max_size}
+{
+}
+
+auto ImmutableCache::make_key(const tonlib_api::Function& request) -> std::string
+{
+    switch (request.get_id()) {
+        case tonlib_api::blocks_getBlockHeader::ID:
+            if (!is_full_block_id(static_cast<const tonlib_api::blocks_getBlockHeader&>(request).id_)) {
+                return {};
+            }
+            break;
+        case tonlib_api::blocks_getShards::ID:
+            if (!is_full_block_id(static_cast<const tonlib_api::blocks_getShards&>(request).id_)) {
+                return {};
+            }
+            break;
+        case tonlib_api::blocks_getTransactions::ID:
+            if (!is_full_block_id(static_cast<const tonlib_api::blocks_getTransactions&>(request).id_)) {
+                return {};
+            }
+            break;
+        case tonlib_api::raw_getTransactions::ID: {
+            const auto& get_transactions = static_cast<const tonlib_api::raw_getTransactions&>(request);
+            // Messages decrypted with a private key must not end up on disk
+            if (get_transactions.private_key_ != nullptr || !is_transaction_id(get_transactions.from_transaction_id_)) {
+                return {};
+            }
+            break;
+        }
+        case tonlib_api::withBlock::ID: {
+            // Account states at a known masterchain block, as used by snapshots
+            const auto& with_block = static_cast<const tonlib_api::withBlock&>(request);
+            if (!is_full_block_id(with_block.id_) || with_block.function_ == nullptr ||
+                with_block.function_->get_id() != tonlib_api::raw_getAccountState::ID) {
+                return {};
+            }
+            break;
+        }
+        default:
+            return {};
+    }
+
+    std::string hash(32, '\0');
+    td::sha256(tl_serialize(request), hash);
+    return td::buffer_to_hex(hash);
+}
+
+auto ImmutableCache::lookup(const std::string& key) const -> td::Result<tonlib_api::object_ptr<tonlib_api::Object>>
+{
+    TRY_RESULT(fd, td::FileFd::open(entry_path(key), td::FileFd::Read))
+    TRY_RESULT(mapping, td::MemoryMapping::create_from_file(fd))
+    fd.close();
+
+    const auto data = mapping.as_slice();
+    if (data.size() < entry_header_size) {
+        return td::Status::Error("Cache entry is truncated");
+    }
+    EntryHeader header{};
+    std::memcpy(&header, data.data(), entry_header_size);
+    if (header.magic != entry_magic || header.version != entry_version || header.size != data.size() - entry_header_size) {
+        return td::Status::Error("Cache entry is invalid");
+    }
+    return tl_deserialize<tonlib_api::Object>(data.substr(entry_header_size));
+}
+
+auto ImmutableCache::store(const std::string& key, const tonlib_api::Object& response) const -> td::Status
+{
+    const auto path = entry_path(key);
+    TRY_STATUS(td::mkpath(path, 0750))
+
+    const auto payload = tl_serialize(response);
+    const EntryHeader header{entry_magic, entry_version, payload.size()};
+    std::string data(entry_header_size + payload.size(), '\0');
+    std::memcpy(&data[0], &header, entry_header_size);
+    std::memcpy(&data[entry_header_size], payload.data(), payload.size());
+
+    // Concurrent writers of the same entry produce identical files, so the last rename wins harmlessly
+    const auto temp_path = PSTRING() << path << ".tmp." << td::Random::secure_uint64();
+    TRY_STATUS(td::write_file(temp_path, data))
+    auto status = td::rename(temp_path, path);
+    if (status.is_error()) {
+        td::unlink(temp_path).ignore();
+        return status;
+    }
+
+    if (max_size_ != 0 && written_since_trim_.fetch_add(data.size(), std::memory_order_relaxed) + data.size() >= max_size_ / trim_interval_divisor) {
+        written_since_trim_.store(0, std::memory_order_relaxed);
+        return trim();
+    }
+    return td::Status::OK();
+}
+
+auto ImmutableCache::trim() const -> td::Status
+{
+    if (max_size_ == 0 || trimming_.exchange(true, std::memory_order_acquire)) {
+        return td::Status::OK();
+    }
+    if (td::stat(directory_).is_error()) {
+        // Nothing was stored yet
+        trimming_.store(false, std::memory_order_release);
+        return td::Status::OK();
+    }
+
+    struct File {
+        std::string path;
+        uint64_t mtime;
+        uint64_t size;
+    };
+    std::vector<File> files;
+    uint64_t total_size = 0;
+    auto status = td::walk_path(directory_, [&](td::CSlice path, td::WalkPath::Type type) {
+        if (type != td::WalkPath::Type::NotDir) {
+            return;
+        }
+        auto r_stat = td::stat(path);
+        if (r_stat.is_error()) {
+            // Removed by another process
+            return;
+        }
+        const auto& stat = r_stat.ok();
+        files.emplace_back(File{path.str(), stat.mtime_nsec_, static_cast<uint64_t>(stat.size_)});
+        total_size += static_cast<uint64_t>(stat.size_);
+    });
+
+    const auto target_size = static_cast<uint64_t>(max_size_) / 100 * trim_target_percent;
+    if (status.is_ok() && total_size > max_size_) {
+        // Entries never change, so the oldest written ones go first
+        std::sort(files.begin(), files.end(), [](const File& left, const File& right) { return left.mtime < right.mtime; });
+        for (const auto& file : files) {
+            if (total_size <= target_size) {
+                break;
+            }
+            // Files which are already gone are not counted anymore either
+            td::unlink(file.path).ignore();
+            total_size -= file.size;
+        }
+    }
+
+    trimming_.store(false, std::memory_order_release);
+    return status;
+}
+
+auto ImmutableCache::entry_path(const std::string& key) const -> std::string
+{
+    // Two levels of fan-out keep directories small
+    return PSTRING() << directory_ << TD_DIR_SLASH << key.substr(0, 2) << TD_DIR_SLASH << key.substr(2, 2) << TD_DIR_SLASH << key;
+}
+
+}  // namespace tjs
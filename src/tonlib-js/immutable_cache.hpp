@@ -0,0 +1,52 @@
+#pragma once
+
+#include <auto/tl/tonlib_api.h>
+#include <td/utils/Status.h>
+
+#include <atomic>
+#include <string>
+
+namespace tjs
+{
+namespace tonlib_api = ton::tonlib_api;
+
+// On-disk store of responses which never change once they exist: shards and
+// transactions of a block addressed by its full id, account states at such a
+// block and transactions addressed by (lt, hash).
+//
+// Each entry is a separate file named by the hash of the serialized request.
+// Files are written to a unique temporary path and renamed into place, so
+// processes on the same host can share a directory without locks and readers
+// never see partial entries. Lookups parse the response directly from a
+// memory mapping of the file. Can be used from any thread, but all methods
+// do blocking disk IO, so they are called on worker threads.
+//
+// The directory is kept under `max_size` bytes: after every `max_size / 16`
+// bytes written by this process, the oldest entries are removed until the
+// directory is below 90% of the limit. Other processes sharing the directory
+// trim it the same way.
+class ImmutableCache final {
+public:
+    // `max_size` is 0 for unlimited
+    ImmutableCache(std::string directory, size_t max_size);
+
+    // Returns an empty key for requests whose responses may change
+    static auto make_key(const tonlib_api::Function& request) -> std::string;
+
+    auto lookup(const std::string& key) const -> td::Result<tonlib_api::object_ptr<tonlib_api::Object>>;
+    auto store(const std::string& key, const tonlib_api::Object& response) const -> td::Status;
+    // Removes the oldest entries if the directory is over the limit
+    auto trim() const -> td::Status;
+
+    [[nodiscard]] auto max_size() const -> size_t { return max_size_; }
+
+private:
+    auto entry_path(const std::string& key) const -> std::string;
+
+    std::string directory_;
+    size_t max_size_;
+    mutable std::atomic<size_t> written_since_trim_{0};
+    mutable std::atomic<bool> trimming_{false};
+};
+
+}  // namespace tjs
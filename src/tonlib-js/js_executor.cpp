@@ -0,0 +1,99 @@
+#include "js_executor.hpp"
+
+#include <cstdlib>
+
+namespace tjs
+{
+namespace
+{
+// Smaller changes are accumulated to avoid poking the GC heuristics on every request
+constexpr int64_t memory_report_threshold = 64 << 10;
+
+// Same as an exception thrown from an event listener, emits `uncaughtException` on the process
+void report_uncaught(Napi::Env env, Napi::Value error)
+{
+    napi_fatal_exception(env, error);
+}
+
+}  // namespace
+
+auto JsExecutor::create(Napi::Env env, std::shared_ptr<MemoryTracker> memory) -> std::shared_ptr<JsExecutor>
+{
+    auto noop = Napi::Function::New(env, [](const Napi::CallbackInfo&) {});
+    auto tsfn = Napi::ThreadSafeFunction::New(env, noop, "TonlibExecutor", 0, 1);
+    tsfn.Unref(env);
+    return std::shared_ptr<JsExecutor>(new JsExecutor{std::move(tsfn), std::move(memory)});
+}
+
+JsExecutor::JsExecutor(Napi::ThreadSafeFunction tsfn, std::shared_ptr<MemoryTracker> memory)
+    : tsfn_{std::move(tsfn)}
+    , memory_{std::move(memory)}
+{
+}
+
+JsExecutor::~JsExecutor()
+{
+    tsfn_.Release();
+}
+
+void JsExecutor::post(Task&& task)
+{
+    auto* data = new Task{std::move(task)};
+    const auto status = tsfn_.NonBlockingCall(data, [self = shared_from_this()](Napi::Env env, Napi::Function, Task* task) {
+        std::unique_ptr<Task> guard{task};
+        try {
+            (*task)(env);
+        }
+        catch (const Napi::Error& e) {
+            report_uncaught(env, e.Value());
+        }
+        catch (const std::exception& e) {
+            report_uncaught(env, Napi::Error::New(env, e.what()).Value());
+        }
+        self->report_memory(env);
+    });
+    if (status != napi_ok) {
+        // Environment is shutting down
+        delete data;
+    }
+}
+
+void JsExecutor::report_memory(Napi::Env env)
+{
+    if (memory_ == nullptr) {
+        return;
+    }
+    // Handles report their own bytes when they are created and collected
+    const auto tracked = static_cast<int64_t>(memory_->get(MemoryKind::Requests) + memory_->get(MemoryKind::Responses));
+    const auto delta = tracked - reported_memory_;
+    if (delta == 0 || (tracked != 0 && std::abs(delta) < memory_report_threshold)) {
+        return;
+    }
+    Napi::MemoryManagement::AdjustExternalMemory(env, delta);
+    reported_memory_ = tracked;
+}
+
+void JsExecutor::release_memory(Napi::Env env)
+{
+    if (reported_memory_ != 0) {
+        Napi::MemoryManagement::AdjustExternalMemory(env, -reported_memory_);
+        reported_memory_ = 0;
+    }
+    memory_.reset();
+}
+
+void JsExecutor::ref(Napi::Env env)
+{
+    if (refs_++ == 0) {
+        tsfn_.Ref(env);
+    }
+}
+
+void JsExecutor::unref(Napi::Env env)
+{
+    if (refs_ > 0 && --refs_ == 0) {
+        tsfn_.Unref(env);
+    }
+}
+
+}  // namespace tjs
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <napi.h>
+#include <td/actor/PromiseFuture.h>
+#include <td/utils/Status.h>
+
+#include <memory>
+
+#include "memory_tracker.hpp"
+#include "unique_function.hpp"
+
+namespace tjs
+{
+// Runs tasks posted from native threads on the JS thread.
+//
+// Unlike `Napi::AsyncWorker`, no libuv pool thread is blocked while waiting
+// for a response, so completions are delivered in the order they arrive.
+class JsExecutor final : public std::enable_shared_from_this<JsExecutor> {
+public:
+    using Task = UniqueFunction<void(Napi::Env)>;
+
+    // Requests and responses accounted in `memory` are reported to V8 after each task
+    static auto create(Napi::Env env, std::shared_ptr<MemoryTracker> memory = nullptr) -> std::shared_ptr<JsExecutor>;
+
+    // Can be called from any thread. Exceptions escaping the task are reported as uncaught JS exceptions
+    void post(Task&& task);
+
+    // Adjusts external memory of the isolate to the current number of tracked bytes. JS thread only
+    void report_memory(Napi::Env env);
+    // Returns all reported bytes back and stops reporting. JS thread only
+    void release_memory(Napi::Env env);
+
+    // Keeps the event loop alive while there are pending tasks. JS thread only
+    void ref(Napi::Env env);
+    void unref(Napi::Env env);
+
+    // `on_ok(env, deferred, value)` is called on the JS thread and must settle the deferred.
+    // If it throws before settling, the deferred is rejected with the exception
+    template <typename T, typename F>
+    auto make_deferred(Napi::Env env, F&& on_ok) -> std::pair<Napi::Promise, td::Promise<T>>
+    {
+        auto deferred = Napi::Promise::Deferred::New(env);
+        auto js_promise = deferred.Promise();
+        ref(env);
+
+        auto promise = td::PromiseCreator::lambda(
+            [self = shared_from_this(), deferred = std::move(deferred), on_ok = std::forward<F>(on_ok)](td::Result<T> R) mutable {
+                self->post(Task{[self, deferred = std::move(deferred), on_ok = std::move(on_ok), R = std::move(R)](Napi::Env env) mutable {
+                    self->unref(env);
+                    if (R.is_error()) {
+                        deferred.Reject(Napi::Error::New(env, R.move_as_error().to_string()).Value());
+                    }
+                    else {
+                        try {
+                            on_ok(env, Napi::Promise::Deferred{deferred}, R.move_as_ok());
+                        }
+                        catch (const Napi::Error& e) {
+                            deferred.Reject(e.Value());
+                        }
+                        catch (const std::exception& e) {
+                            deferred.Reject(Napi::Error::New(env, e.what()).Value());
+                        }
+                    }
+                }});
+            });
+
+        return std::make_pair(js_promise, std::move(promise));
+    }
+
+    template <typename T, typename F>
+    auto make_promise(Napi::Env env, F&& on_ok) -> std::pair<Napi::Promise, td::Promise<T>>
+    {
+        return make_deferred<T>(env, [on_ok = std::forward<F>(on_ok)](Napi::Env env, Napi::Promise::Deferred&& deferred, T&& value) mutable {
+            deferred.Resolve(on_ok(env, std::move(value)));
+        });
+    }
+
+    ~JsExecutor();
+    JsExecutor(const JsExecutor&) = delete;
+    JsExecutor& operator=(const JsExecutor&) = delete;
+    JsExecutor(JsExecutor&&) = delete;
+    JsExecutor& operator=(JsExecutor&&) = delete;
+
+private:
+    JsExecutor(Napi::ThreadSafeFunction tsfn, std::shared_ptr<MemoryTracker> memory);
+
+    Napi::ThreadSafeFunction tsfn_;
+    size_t refs_{0};
+    std::shared_ptr<MemoryTracker> memory_;
+    int64_t reported_memory_{0};
+};
+
+}  // namespace tjs
@@ -0,0 +1,74 @@
+#include "key_batch.hpp"
+
+#include <block/block.h>
+#include <crypto/Ed25519.h>
+
+#include <memory>
+
+#include "worker_pool.hpp"
+
+namespace tjs
+{
+namespace
+{
+// Key generation and signing take tens of microseconds, so the items are grouped to amortize scheduling
+constexpr size_t key_chunk_size = 256;
+constexpr size_t execute_chunk_size = 16;
+
+}  // namespace
+
+auto generate_key() -> td::Result<GeneratedKey>
+{
+    TRY_RESULT(private_key, td::Ed25519::generate_private_key())
+    TRY_RESULT(public_key, private_key.get_public_key())
+    TRY_RESULT(block_public_key, block::PublicKey::from_bytes(public_key.as_octet_string()))
+    return GeneratedKey{block_public_key.serialize(true), private_key.as_octet_string()};
+}
+
+auto sign(const SignRequest& request) -> td::Result<td::SecureString>
+{
+    if (request.private_key.size() != 32) {
+        return td::Status::Error("Invalid private key length");
+    }
+    td::Ed25519::PrivateKey private_key{request.private_key.copy()};
+    return private_key.sign(request.data);
+}
+
+void generate_keys(WorkerPool& workers, size_t count, td::Promise<GeneratedKeys>&& promise)
+{
+    workers.map<GeneratedKey>(
+        count, key_chunk_size, [](size_t) { return generate_key(); }, std::move(promise));
+}
+
+void sign_batch(WorkerPool& workers, std::vector<SignRequest>&& requests, td::Promise<Signatures>&& promise)
+{
+    auto items = std::make_shared<const std::vector<SignRequest>>(std::move(requests));
+    workers.map<td::SecureString>(
+        items->size(), key_chunk_size, [items](size_t i) { return sign((*items)[i]); }, std::move(promise));
+}
+
+void execute_batch(WorkerPool& workers, std::vector<Client::Request>&& requests, td::Promise<ExecuteResults>&& promise)
+{
+    // Each request is moved out by exactly one worker
+    auto items = std::make_shared<std::vector<Client::Request>>(std::move(requests));
+    workers.map<Client::Response>(
+        items->size(), execute_chunk_size,
+        [items](size_t i) -> td::Result<Client::Response> {
+            auto& request = (*items)[i];
+            if (request == nullptr) {
+                return td::Status::Error("Invalid request");
+            }
+            auto response = Client::execute(std::move(request));
+            if (response == nullptr) {
+                return td::Status::Error("Empty response");
+            }
+            if (response->get_id() == tonlib_api::error::ID) {
+                const auto& error = static_cast<const tonlib_api::error&>(*response);
+                return td::Status::Error(error.code_, error.message_);
+            }
+            return std::move(response);
+        },
+        std::move(promise));
+}
+
+}  // namespace tjs
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <td/utils/SharedSlice.h>
+#include <td/utils/Status.h>
+
+#include <string>
+#include <vector>
+
+#include "client.hpp"
+#include "tl_utils.hpp"
+
+namespace tjs
+{
+// Raw Ed25519 key pair, not stored in the tonlib keystore
+struct GeneratedKey {
+    // In the same format as `key.public_key` of tonlib
+    std::string public_key;
+    td::SecureString private_key;
+};
+
+struct SignRequest {
+    td::SecureString private_key;
+    std::string data;
+};
+
+inline auto tl_memory_size_field(const GeneratedKey& key) -> size_t
+{
+    return tl_memory_size_field(key.public_key) + tl_memory_size_field(key.private_key);
+}
+
+inline auto tl_memory_size_field(const SignRequest& request) -> size_t
+{
+    return tl_memory_size_field(request.private_key) + tl_memory_size_field(request.data);
+}
+
+using GeneratedKeys = std::vector<td::Result<GeneratedKey>>;
+using Signatures = std::vector<td::Result<td::SecureString>>;
+using ExecuteResults = std::vector<td::Result<Client::Response>>;
+
+auto generate_key() -> td::Result<GeneratedKey>;
+auto sign(const SignRequest& request) -> td::Result<td::SecureString>;
+
+// Results are in the same order as requests. Work is split between the worker threads
+void generate_keys(WorkerPool& workers, size_t count, td::Promise<GeneratedKeys>&& promise);
+void sign_batch(WorkerPool& workers, std::vector<SignRequest>&& requests, td::Promise<Signatures>&& promise);
+// Runs requests which don't need a tonlib instance, like `getAccountAddress` or `kdf`
+void execute_batch(WorkerPool& workers, std::vector<Client::Request>&& requests, td::Promise<ExecuteResults>&& promise);
+
+}  // namespace tjs
@@ -0,0 +1,95 @@
+#include "log_handler.hpp"
+
+#include <td/utils/format.h>
+
+#include "log_sink.hpp"
+
+namespace tjs
+{
+namespace
+{
+constexpr size_t max_batch_size = 1024;
+
+void drain(Napi::Env env, Napi::Function callback)
+{
+    auto& sink = LogSink::instance();
+    sink.on_drain();
+
+    LogRecord record;
+    while (true) {
+        auto batch = Napi::Array::New(env);
+        uint32_t size = 0;
+        while (size < max_batch_size && sink.pop(record)) {
+            auto item = Napi::Object::New(env);
+            item.Set("clientId", Napi::Number::New(env, record.client_id));
+            item.Set("level", Napi::Number::New(env, record.level));
+            item.Set("time", Napi::Number::New(env, record.timestamp));
+            item.Set("message", Napi::String::New(env, record.message));
+            batch.Set(size++, item);
+        }
+        if (size == 0) {
+            break;
+        }
+        callback.Call({batch});
+    }
+}
+
+auto set_log_handler(const Napi::CallbackInfo& info) -> Napi::Value
+{
+    auto env = info.Env();
+
+    if (info.Length() < 1 || info[0].IsNull() || info[0].IsUndefined()) {
+        LogSink::instance().disable(nullptr);
+        return env.Undefined();
+    }
+    if (!info[0].IsFunction()) {
+        Napi::TypeError::New(env, "Log handler function expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    // The handler is process-wide, but belongs to the environment which installed it
+    auto tsfn = Napi::ThreadSafeFunction::New(env, info[0].As<Napi::Function>(), "TonlibLog", 0, 1);
+    tsfn.Unref(env);
+    LogSink::instance().enable(
+        static_cast<napi_env>(env), [tsfn]() mutable { return tsfn.NonBlockingCall(drain) == napi_ok; }, [tsfn]() mutable { tsfn.Release(); });
+    return env.Undefined();
+}
+
+auto set_log_verbosity(const Napi::CallbackInfo& info) -> Napi::Value
+{
+    auto env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        Napi::TypeError::New(env, "Verbosity level expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    LogSink::instance().set_default_verbosity(info[0].As<Napi::Number>().Int32Value());
+    return env.Undefined();
+}
+
+auto get_log_stats(const Napi::CallbackInfo& info) -> Napi::Value
+{
+    auto env = info.Env();
+    const auto& sink = LogSink::instance();
+
+    auto result = Napi::Object::New(env);
+    result.Set("delivered", Napi::Number::New(env, static_cast<double>(sink.delivered())));
+    result.Set("dropped", Napi::Number::New(env, static_cast<double>(sink.dropped())));
+    return result;
+}
+
+}  // namespace
+
+void init_log_handler(Napi::Env env, Napi::Object exports)
+{
+    LogSink::install();
+
+    exports.Set("setLogHandler", Napi::Function::New(env, set_log_handler, "setLogHandler"));
+    exports.Set("setLogVerbosity", Napi::Function::New(env, set_log_verbosity, "setLogVerbosity"));
+    exports.Set("getLogStats", Napi::Function::New(env, get_log_stats, "getLogStats"));
+
+    // Other environments keep their handler when this one is torn down
+    napi_add_env_cleanup_hook(
+        env, [](void* owner) { LogSink::instance().disable(owner); }, static_cast<napi_env>(env));
+}
+
+}  // namespace tjs
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <napi.h>
+
+namespace tjs
+{
+void init_log_handler(Napi::Env env, Napi::Object exports);
+
+}  // namespace tjs
@@ -0,0 +1,226 @@
+#include "log_sink.hpp"
+
+#include <td/utils/port/Clocks.h>
+
+#include <algorithm>
+#include <mutex>
+
+namespace tjs
+{
+namespace
+{
+thread_local std::shared_ptr<LogTag> current_tag;
+
+auto round_up_to_power_of_two(size_t value) -> size_t
+{
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1u;
+    }
+    return result;
+}
+
+}  // namespace
+
+LogRing::LogRing(size_t capacity)
+    : slots_{new Slot[round_up_to_power_of_two(capacity)]}
+    , mask_{round_up_to_power_of_two(capacity) - 1}
+{
+    for (size_t i = 0; i <= mask_; ++i) {
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+auto LogRing::try_push(LogRecord&& record) -> bool
+{
+    auto position = enqueue_position_.load(std::memory_order_relaxed);
+    while (true) {
+        auto& slot = slots_[position & mask_];
+        const auto sequence = slot.sequence.load(std::memory_order_acquire);
+        const auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+        if (diff == 0) {
+            if (enqueue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                slot.record = std::move(record);
+                slot.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0) {
+            return false;
+        }
+        else {
+            position = enqueue_position_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+auto LogRing::try_pop(LogRecord& record) -> bool
+{
+    auto position = dequeue_position_.load(std::memory_order_relaxed);
+    while (true) {
+        auto& slot = slots_[position & mask_];
+        const auto sequence = slot.sequence.load(std::memory_order_acquire);
+        const auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position + 1);
+        if (diff == 0) {
+            if (dequeue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                record = std::move(slot.record);
+                slot.sequence.store(position + mask_ + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0) {
+            return false;
+        }
+        else {
+            position = dequeue_position_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+auto LogSink::instance() -> LogSink&
+{
+    static LogSink sink;
+    return sink;
+}
+
+LogSink::LogSink() = default;
+
+void LogSink::install()
+{
+    static std::once_flag flag;
+    std::call_once(flag, [] {
+        auto& sink = instance();
+        sink.previous_ = td::log_interface;
+        td::log_interface = &sink;
+    });
+}
+
+void LogSink::set_thread_tag(std::shared_ptr<LogTag> tag)
+{
+    current_tag = std::move(tag);
+}
+
+auto LogSink::thread_tag() -> const std::shared_ptr<LogTag>&
+{
+    return current_tag;
+}
+
+auto LogSink::create_tag() -> std::shared_ptr<LogTag>
+{
+    std::lock_guard<std::mutex> guard{mutex_};
+    auto tag = std::make_shared<LogTag>(next_client_id_++);
+    tag->verbosity = default_verbosity_.load();
+
+    tags_.erase(std::remove_if(tags_.begin(), tags_.end(), [](const auto& item) { return item.expired(); }), tags_.end());
+    tags_.emplace_back(tag);
+    return tag;
+}
+
+void LogSink::set_verbosity(LogTag& tag, int verbosity)
+{
+    std::lock_guard<std::mutex> guard{mutex_};
+    tag.verbosity = verbosity;
+    update_global_verbosity();
+}
+
+void LogSink::set_default_verbosity(int verbosity)
+{
+    std::lock_guard<std::mutex> guard{mutex_};
+    default_verbosity_ = verbosity;
+    update_global_verbosity();
+}
+
+void LogSink::update_global_verbosity()
+{
+    // td filters records before they reach the sink, so the global level must allow the most verbose client
+    auto verbosity = default_verbosity_.load();
+    for (const auto& item : tags_) {
+        if (auto tag = item.lock()) {
+            verbosity = std::max(verbosity, tag->verbosity.load());
+        }
+    }
+    SET_VERBOSITY_LEVEL(verbosity);
+}
+
+void LogSink::enable(const void* owner, std::function<bool()>&& notify, std::function<void()>&& release)
+{
+    std::lock_guard<std::mutex> guard{mutex_};
+    if (release_) {
+        release_();
+    }
+    owner_ = owner;
+    notify_ = std::move(notify);
+    release_ = std::move(release);
+    notify_scheduled_ = false;
+    enabled_.store(true, std::memory_order_release);
+}
+
+void LogSink::disable(const void* owner)
+{
+    std::lock_guard<std::mutex> guard{mutex_};
+    if (owner != nullptr && owner != owner_) {
+        return;
+    }
+    enabled_.store(false, std::memory_order_release);
+    notify_ = nullptr;
+    if (release_) {
+        release_();
+        release_ = nullptr;
+    }
+    owner_ = nullptr;
+}
+
+auto LogSink::pop(LogRecord& record) -> bool
+{
+    if (ring_.try_pop(record)) {
+        delivered_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void LogSink::on_drain()
+{
+    notify_scheduled_.store(false, std::memory_order_release);
+}
+
+void LogSink::append(td::CSlice slice, int log_level)
+{
+    if (log_level == VERBOSITY_NAME(FATAL)) {
+        // Process is going to abort, so the record must be written immediately
+        td::default_log_interface->append(slice, log_level);
+        return;
+    }
+
+    const auto& tag = current_tag;
+    const auto verbosity = tag != nullptr ? tag->verbosity.load(std::memory_order_relaxed) : default_verbosity_.load(std::memory_order_relaxed);
+    if (log_level > verbosity) {
+        return;
+    }
+
+    if (!enabled_.load(std::memory_order_acquire)) {
+        (previous_ != nullptr ? previous_ : td::default_log_interface)->append(slice, log_level);
+        return;
+    }
+
+    td::Slice message = slice;
+    while (!message.empty() && message.back() == '\n') {
+        message.remove_suffix(1);
+    }
+
+    LogRecord record{tag != nullptr ? tag->client_id : 0, log_level, td::Clocks::system(), message.str()};
+    if (!ring_.try_push(std::move(record))) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    if (!notify_scheduled_.exchange(true, std::memory_order_acq_rel)) {
+        std::lock_guard<std::mutex> guard{mutex_};
+        // Records of a failed call are never drained, so the next record tries again
+        if (notify_ && !notify_()) {
+            notify_scheduled_.store(false, std::memory_order_release);
+        }
+    }
+}
+
+}  // namespace tjs
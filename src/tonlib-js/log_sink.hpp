@@ -0,0 +1,133 @@
+#pragma once
+
+#include <td/utils/Slice.h>
+#include <td/utils/logging.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace tjs
+{
+struct LogRecord {
+    uint32_t client_id{0};
+    int level{0};
+    double timestamp{0.0};
+    std::string message;
+};
+
+// Per-client logging state, attached to all threads owned by the client
+struct LogTag {
+    explicit LogTag(uint32_t client_id)
+        : client_id{client_id}
+    {
+    }
+
+    const uint32_t client_id;
+    std::atomic<int> verbosity{VERBOSITY_NAME(ERROR)};
+};
+
+// Bounded multi-producer queue, based on the Vyukov's array queue
+class LogRing final {
+public:
+    explicit LogRing(size_t capacity);
+
+    auto try_push(LogRecord&& record) -> bool;
+    auto try_pop(LogRecord& record) -> bool;
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence{0};
+        LogRecord record;
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> enqueue_position_{0};
+    alignas(64) std::atomic<size_t> dequeue_position_{0};
+};
+
+// Replaces synchronous td logging with a ring buffer which is drained on the JS thread.
+// Records are dropped when the ring is full.
+//
+// The sink stays installed as `td::log_interface` from module init, since the
+// pointer is read by all threads without synchronization. While no handler is
+// enabled, records are passed to the previous interface after filtering.
+class LogSink final : public td::LogInterface {
+public:
+    static constexpr size_t default_capacity = 8192;
+
+    static auto instance() -> LogSink&;
+
+    // Must be called before any client threads are started
+    static void install();
+
+    // Tags all records produced by the current thread
+    static void set_thread_tag(std::shared_ptr<LogTag> tag);
+    [[nodiscard]] static auto thread_tag() -> const std::shared_ptr<LogTag>&;
+
+    auto create_tag() -> std::shared_ptr<LogTag>;
+    void set_verbosity(LogTag& tag, int verbosity);
+    void set_default_verbosity(int verbosity);
+
+    // `notify` is called from an arbitrary thread when the ring becomes non-empty and returns false
+    // if the drain was not scheduled. `release` is called once the handler is replaced or disabled.
+    // `owner` is the environment which installed the handler
+    void enable(const void* owner, std::function<bool()>&& notify, std::function<void()>&& release);
+    // Disables the handler of `owner`, or any handler for null
+    void disable(const void* owner);
+
+    auto pop(LogRecord& record) -> bool;
+    // Must be called by the consumer before draining the ring
+    void on_drain();
+
+    [[nodiscard]] auto dropped() const -> uint64_t { return dropped_.load(std::memory_order_relaxed); }
+    [[nodiscard]] auto delivered() const -> uint64_t { return delivered_.load(std::memory_order_relaxed); }
+
+    void append(td::CSlice slice, int log_level) final;
+
+private:
+    LogSink();
+
+    void update_global_verbosity();
+
+    LogRing ring_{default_capacity};
+    std::atomic<bool> enabled_{false};
+    std::atomic<bool> notify_scheduled_{false};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> delivered_{0};
+
+    std::mutex mutex_;  // for owner_, notify_, release_ and tags_
+    const void* owner_{nullptr};
+    std::function<bool()> notify_;
+    std::function<void()> release_;
+    std::vector<std::weak_ptr<LogTag>> tags_;
+    uint32_t next_client_id_{1};
+    // Verbosity of records from threads which don't belong to any client
+    std::atomic<int> default_verbosity_{VERBOSITY_NAME(ERROR)};
+    // Set once on install
+    td::LogInterface* previous_{nullptr};
+};
+
+// Tags the current thread while client code runs on a thread which is not owned by the client
+class LogTagScope final {
+public:
+    explicit LogTagScope(std::shared_ptr<LogTag> tag)
+        : previous_{LogSink::thread_tag()}
+    {
+        LogSink::set_thread_tag(std::move(tag));
+    }
+    ~LogTagScope() { LogSink::set_thread_tag(std::move(previous_)); }
+
+    LogTagScope(const LogTagScope&) = delete;
+    LogTagScope& operator=(const LogTagScope&) = delete;
+    LogTagScope(LogTagScope&&) = delete;
+    LogTagScope& operator=(LogTagScope&&) = delete;
+
+private:
+    std::shared_ptr<LogTag> previous_;
+};
+
+}  // namespace tjs
@@ -0,0 +1,60 @@
+#include "memory_tracker.hpp"
+
+#include <utility>
+
+namespace tjs
+{
+void MemoryTracker::add(MemoryKind kind, size_t bytes)
+{
+    bytes_[static_cast<size_t>(kind)].fetch_add(bytes, std::memory_order_relaxed);
+    const auto total = total_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+
+    auto peak = peak_.load(std::memory_order_relaxed);
+    while (total > peak && !peak_.compare_exchange_weak(peak, total, std::memory_order_relaxed)) {
+    }
+}
+
+void MemoryTracker::sub(MemoryKind kind, size_t bytes)
+{
+    bytes_[static_cast<size_t>(kind)].fetch_sub(bytes, std::memory_order_relaxed);
+    total_.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+MemoryReservation::MemoryReservation(std::shared_ptr<MemoryTracker> tracker, MemoryKind kind, size_t bytes)
+    : tracker_{std::move(tracker)}
+    , kind_{kind}
+    , bytes_{bytes}
+{
+    if (tracker_ != nullptr) {
+        tracker_->add(kind_, bytes_);
+    }
+}
+
+void MemoryReservation::reset()
+{
+    if (tracker_ != nullptr) {
+        tracker_->sub(kind_, bytes_);
+        tracker_.reset();
+    }
+    bytes_ = 0;
+}
+
+MemoryReservation::MemoryReservation(MemoryReservation&& other) noexcept
+    : tracker_{std::move(other.tracker_)}
+    , kind_{other.kind_}
+    , bytes_{std::exchange(other.bytes_, 0)}
+{
+}
+
+MemoryReservation& MemoryReservation::operator=(MemoryReservation&& other) noexcept
+{
+    if (this != &other) {
+        reset();
+        tracker_ = std::move(other.tracker_);
+        kind_ = other.kind_;
+        bytes_ = std::exchange(other.bytes_, 0);
+    }
+    return *this;
+}
+
+}  // namespace tjs
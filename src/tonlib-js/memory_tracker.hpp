@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+
+namespace tjs
+{
+enum class MemoryKind : size_t {
+    // Requests which were sent but not yet answered
+    Requests = 0,
+    // Responses which were received but not yet converted to JS values
+    Responses = 1,
+    // Objects kept alive by JS wrappers
+    Handles = 2,
+};
+
+constexpr size_t memory_kind_count = 3;
+
+// Native bytes held on behalf of a single client. Can be used from any thread
+class MemoryTracker final {
+public:
+    void add(MemoryKind kind, size_t bytes);
+    void sub(MemoryKind kind, size_t bytes);
+
+    [[nodiscard]] auto get(MemoryKind kind) const -> size_t { return bytes_[static_cast<size_t>(kind)].load(std::memory_order_relaxed); }
+    [[nodiscard]] auto total() const -> size_t { return total_.load(std::memory_order_relaxed); }
+    [[nodiscard]] auto peak() const -> size_t { return peak_.load(std::memory_order_relaxed); }
+
+private:
+    std::array<std::atomic<size_t>, memory_kind_count> bytes_{};
+    std::atomic<size_t> total_{0};
+    std::atomic<size_t> peak_{0};
+};
+
+// Keeps bytes accounted until destroyed
+class MemoryReservation final {
+public:
+    MemoryReservation() = default;
+    MemoryReservation(std::shared_ptr<MemoryTracker> tracker, MemoryKind kind, size_t bytes);
+
+    [[nodiscard]] auto bytes() const -> size_t { return bytes_; }
+    void reset();
+
+    ~MemoryReservation() { reset(); }
+    MemoryReservation(MemoryReservation&& other) noexcept;
+    MemoryReservation& operator=(MemoryReservation&& other) noexcept;
+    MemoryReservation(const MemoryReservation&) = delete;
+    MemoryReservation& operator=(const MemoryReservation&) = delete;
+
+private:
+    std::shared_ptr<MemoryTracker> tracker_;
+    MemoryKind kind_{MemoryKind::Requests};
+    size_t bytes_{0};
+};
+
+// Value which stays accounted while it is alive
+template <typename T>
+struct Tracked {
+    T value;
+    MemoryReservation reservation;
+};
+
+}  // namespace tjs
@@ -0,0 +1,145 @@
+#include "message_submitter.hpp"
+
+#include <block/block-auto.h>
+#include <vm/boc.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "dispatcher.hpp"
+#include "worker_pool.hpp"
+
+namespace tjs
+{
+namespace
+{
+// Messages parsed by a single worker task
+constexpr size_t prepare_chunk_size = 64;
+
+auto prepare_message(td::Slice boc) -> td::Result<td::Bits256>
+{
+    TRY_RESULT(cell, vm::std_boc_deserialize(boc))
+    auto cs = vm::load_cell_slice(cell);
+    if (block::gen::t_CommonMsgInfo.get_tag(cs) != block::gen::CommonMsgInfo::ext_in_msg_info) {
+        return td::Status::Error("Expected external inbound message");
+    }
+    return td::Bits256{cell->get_hash().bits()};
+}
+
+}  // namespace
+
+auto MessageSubmitter::Bits256Hash::operator()(const td::Bits256& hash) const -> size_t
+{
+    size_t result;
+    std::memcpy(&result, hash.data(), sizeof(result));
+    return result;
+}
+
+MessageSubmitter::MessageSubmitter(td::actor::ActorId<RequestDispatcher> dispatcher, std::shared_ptr<WorkerPool> workers,
+                                   std::vector<std::string> messages, const Options& options)
+    : dispatcher_{std::move(dispatcher)}
+    , workers_{std::move(workers)}
+    , messages_{std::make_shared<const std::vector<std::string>>(std::move(messages))}
+    , options_{options}
+    , hashes_(messages_->size())
+{
+}
+
+void MessageSubmitter::start_up()
+{
+    if (messages_->empty()) {
+        finish();
+        return;
+    }
+
+    for (size_t begin = 0; begin < messages_->size(); begin += prepare_chunk_size) {
+        const auto end = std::min(begin + prepare_chunk_size, messages_->size());
+        workers_->run(
+            [messages = messages_, begin, end]() -> td::Result<Prepared> {
+                Prepared prepared;
+                prepared.reserve(end - begin);
+                for (size_t i = begin; i < end; ++i) {
+                    prepared.emplace_back(prepare_message((*messages)[i]));
+                }
+                return std::move(prepared);
+            },
+            td::PromiseCreator::lambda([self = actor_id(this), begin](td::Result<Prepared> result) {
+                td::actor::send_closure(self, &MessageSubmitter::on_prepared, begin, std::move(result));
+            }));
+    }
+}
+
+void MessageSubmitter::on_prepared(size_t begin, td::Result<Prepared> result)
+{
+    if (result.is_error()) {
+        fail(result.move_as_error());
+        return;
+    }
+
+    auto prepared = result.move_as_ok();
+    for (size_t i = 0; i < prepared.size(); ++i) {
+        const auto index = begin + i;
+        if (prepared[i].is_error()) {
+            complete(SubmitResult{index, std::nullopt, std::nullopt, prepared[i].move_as_error()});
+            continue;
+        }
+
+        const auto& hash = hashes_[index] = prepared[i].move_as_ok();
+        auto [it, inserted] = sent_.emplace(hash, SentMessage{index, std::nullopt, {}});
+        if (!inserted) {
+            auto& original = it->second;
+            if (original.status.has_value()) {
+                complete(SubmitResult{index, hash, original.index, original.status->clone()});
+            }
+            else {
+                original.duplicates.emplace_back(index);
+            }
+            continue;
+        }
+        queue_.emplace_back(index);
+    }
+    fill();
+}
+
+void MessageSubmitter::fill()
+{
+    while (!queue_.empty() && in_flight_ < options_.concurrency && !is_done()) {
+        const auto index = queue_.front();
+        queue_.pop_front();
+        ++in_flight_;
+
+        auto request = tonlib_api::make_object<tonlib_api::raw_sendMessage>((*messages_)[index]);
+        td::actor::send_closure(dispatcher_, &RequestDispatcher::request, std::move(request), options_.priority,
+                                td::PromiseCreator::lambda([self = actor_id(this), index](td::Result<Client::Response> result) {
+                                    td::actor::send_closure(self, &MessageSubmitter::on_sent, index, std::move(result));
+                                }));
+    }
+}
+
+void MessageSubmitter::on_sent(size_t index, td::Result<Client::Response> result)
+{
+    --in_flight_;
+    const auto& hash = hashes_[index];
+    auto& sent = sent_.at(hash);
+    sent.status = result.is_ok() ? td::Status::OK() : result.move_as_error();
+    const auto duplicates = std::move(sent.duplicates);
+
+    complete(SubmitResult{index, hash, std::nullopt, sent.status->clone()});
+    for (const auto duplicate : duplicates) {
+        complete(SubmitResult{duplicate, hash, index, sent.status->clone()});
+    }
+    fill();
+}
+
+void MessageSubmitter::complete(SubmitResult&& result)
+{
+    if (is_done()) {
+        return;
+    }
+    push(std::move(result));
+    if (++completed_ == messages_->size()) {
+        finish();
+    }
+}
+
+}  // namespace tjs
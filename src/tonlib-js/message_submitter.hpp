@@ -0,0 +1,75 @@
+#pragma once
+
+#include <crypto/common/bitstring.h>
+
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "stream.hpp"
+
+namespace tjs
+{
+class WorkerPool;
+
+struct SubmitResult {
+    // Position of the message in the submitted list
+    size_t index{0};
+    // Hash of the message cell, empty if the message is invalid
+    std::optional<td::Bits256> hash;
+    // Identical message which was sent instead of this one, the status is copied from its result
+    std::optional<size_t> duplicate_of;
+    td::Status status;
+};
+
+// Sends a burst of serialized external messages.
+//
+// Messages are parsed and hashed on worker threads, identical messages are
+// sent once, and `raw.sendMessage` requests run with bounded concurrency.
+// Results are produced in the order of completion, duplicates right after
+// the message which was sent instead of them.
+class MessageSubmitter final : public StreamProducer<SubmitResult> {
+public:
+    struct Options {
+        size_t concurrency{16};
+        Priority priority{Priority::Bulk};
+    };
+
+    MessageSubmitter(td::actor::ActorId<RequestDispatcher> dispatcher, std::shared_ptr<WorkerPool> workers, std::vector<std::string> messages,
+                     const Options& options);
+
+private:
+    using Prepared = std::vector<td::Result<td::Bits256>>;
+
+    struct Bits256Hash {
+        auto operator()(const td::Bits256& hash) const -> size_t;
+    };
+
+    struct SentMessage {
+        size_t index;
+        // Set once the message is sent
+        std::optional<td::Status> status;
+        // Identical messages waiting for the result
+        std::vector<size_t> duplicates;
+    };
+
+    void start_up() final;
+
+    void on_prepared(size_t begin, td::Result<Prepared> result);
+    void fill();
+    void on_sent(size_t index, td::Result<Client::Response> result);
+    void complete(SubmitResult&& result);
+
+    td::actor::ActorId<RequestDispatcher> dispatcher_;
+    std::shared_ptr<WorkerPool> workers_;
+    std::shared_ptr<const std::vector<std::string>> messages_;
+    Options options_;
+
+    std::vector<td::Bits256> hashes_;
+    std::unordered_map<td::Bits256, SentMessage, Bits256Hash> sent_;
+    std::deque<size_t> queue_;
+    size_t in_flight_{0};
+    size_t completed_{0};
+};
+
+}  // namespace tjs
@@ -0,0 +1,158 @@
+#include "native_account_watcher.hpp"
+
+#include "block_events.hpp"
+
+namespace tjs
+{
+Napi::FunctionReference* NativeAccountWatcher::constructor = nullptr;
+
+void NativeAccountWatcher::init(Napi::Env env)
+{
+    Napi::Function function = DefineClass(env, "AccountWatcher",
+                                          {
+                                              InstanceMethod("add", &NativeAccountWatcher::add),
+                                              InstanceMethod("remove", &NativeAccountWatcher::remove),
+                                              InstanceMethod("close", &NativeAccountWatcher::close),
+                                          });
+
+    constructor = new Napi::FunctionReference();
+    *constructor = Napi::Persistent(function);
+}
+
+auto NativeAccountWatcher::create(Napi::Env env, Napi::Object owner, const std::shared_ptr<Client>& client, std::shared_ptr<JsExecutor> executor, Napi::Function callback,
+                                  const NapiOptions& napi_options, const AccountWatcher::Options& options) -> Napi::Object
+{
+    auto object = constructor->New({});
+    auto* watcher = NativeAccountWatcher::Unwrap(object);
+    watcher->owner_ = Napi::Persistent(owner);
+    watcher->client_ = client;
+    watcher->executor_ = std::move(executor);
+    watcher->listener_ = std::make_shared<Listener>(Listener{Napi::Persistent(callback), napi_options});
+
+    // Changes stay accounted until they are converted
+    auto listener = [weak_listener = std::weak_ptr<Listener>{watcher->listener_}, executor = watcher->executor_, memory = client->memory()](AccountChanges&& changes) {
+        auto reservation = MemoryReservation{memory, MemoryKind::Responses, memory_size(changes)};
+        executor->post(JsExecutor::Task{[weak_listener, changes = std::move(changes), reservation = std::move(reservation)](Napi::Env env) {
+            if (auto listener = weak_listener.lock()) {
+                dispatch(env, *listener, changes);
+            }
+        }});
+    };
+    client->run_in_context([&] {
+        watcher->watcher_ = td::actor::create_actor<AccountWatcher>("AccountWatcher", client->dispatcher(), client->block_subscription(), options,
+                                                                   std::move(listener));
+    });
+
+    watcher->executor_->ref(env);
+    watcher->Ref();
+    return object;
+}
+
+NativeAccountWatcher::NativeAccountWatcher(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<NativeAccountWatcher>{info}
+{
+}
+
+NativeAccountWatcher::~NativeAccountWatcher()
+{
+    stop();
+}
+
+auto NativeAccountWatcher::add(const Napi::CallbackInfo& info) -> Napi::Value
+{
+    std::vector<AccountKey> accounts;
+    if (parse_accounts(info, accounts)) {
+        if (auto client = client_.lock()) {
+            client->run_in_context([&] { td::actor::send_closure(watcher_, &AccountWatcher::add, std::move(accounts)); });
+        }
+    }
+    return info.Env().Undefined();
+}
+
+auto NativeAccountWatcher::remove(const Napi::CallbackInfo& info) -> Napi::Value
+{
+    std::vector<AccountKey> accounts;
+    if (parse_accounts(info, accounts)) {
+        if (auto client = client_.lock()) {
+            client->run_in_context([&] { td::actor::send_closure(watcher_, &AccountWatcher::remove, std::move(accounts)); });
+        }
+    }
+    return info.Env().Undefined();
+}
+
+auto NativeAccountWatcher::close(const Napi::CallbackInfo& info) -> Napi::Value
+{
+    if (!watcher_.empty()) {
+        stop();
+        executor_->unref(info.Env());
+        Unref();
+    }
+    return info.Env().Undefined();
+}
+
+auto NativeAccountWatcher::parse_accounts(const Napi::CallbackInfo& info, std::vector<AccountKey>& accounts) -> bool
+{
+    auto env = info.Env();
+    if (watcher_.empty()) {
+        Napi::Error::New(env, "Account watcher is closed").ThrowAsJavaScriptException();
+        return false;
+    }
+
+    std::vector<std::string> addresses;
+    auto status = from_napi(info[0], addresses);
+    if (status.is_error()) {
+        const auto message = PSLICE() << "Invalid addresses: " << status;
+        Napi::TypeError::New(env, message.c_str()).ThrowAsJavaScriptException();
+        return false;
+    }
+
+    accounts.reserve(addresses.size());
+    for (const auto& address : addresses) {
+        auto r_account = parse_account_key(address);
+        if (r_account.is_error()) {
+            const auto message = PSLICE() << "Invalid address " << address << ": " << r_account.error();
+            Napi::TypeError::New(env, message.c_str()).ThrowAsJavaScriptException();
+            return false;
+        }
+        accounts.emplace_back(r_account.move_as_ok());
+    }
+    return true;
+}
+
+void NativeAccountWatcher::stop()
+{
+    if (auto client = client_.lock()) {
+        client->run_in_context([&] { watcher_.reset(); });
+    }
+    else {
+        // Already stopped with the scheduler of the closed client
+        watcher_.release();
+    }
+    listener_.reset();
+    owner_.Reset();
+}
+
+void NativeAccountWatcher::dispatch(Napi::Env env, Listener& listener, const AccountChanges& changes)
+{
+    NapiOptionsGuard guard{listener.napi_options};
+
+    auto accounts = Napi::Array::New(env, changes.accounts.size());
+    for (size_t i = 0; i < changes.accounts.size(); ++i) {
+        const auto& change = changes.accounts[i];
+        auto account = Napi::Object::New(env);
+        account.Set("address", Napi::String::New(env, to_raw_address(change.account)));
+        account.Set("lt", to_napi(env, NapiInt64{change.lt}));
+        account.Set("hash", to_napi(env, change.hash));
+        accounts.Set(i, account);
+    }
+
+    auto event = Napi::Object::New(env);
+    event.Set("block", to_napi(env, changes.block));
+    event.Set("accounts", accounts);
+    if (!changes.skipped.empty()) {
+        event.Set("skipped", to_napi(env, changes.skipped));
+    }
+    listener.callback.Call({event});
+}
+
+}  // namespace tjs
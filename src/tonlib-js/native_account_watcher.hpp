@@ -0,0 +1,58 @@
+#pragma once
+
+#include <napi.h>
+
+#include <memory>
+
+#include "account_watcher.hpp"
+#include "js_executor.hpp"
+#include "tl_napi.hpp"
+
+namespace tjs
+{
+// JS handle of an account watcher.
+//
+// The watcher keeps itself, its client and the event loop alive until it is
+// closed, like other event sources in Node.
+class NativeAccountWatcher final : public Napi::ObjectWrap<NativeAccountWatcher> {
+public:
+    static void init(Napi::Env env);
+
+    // `owner` is kept alive while the watcher is open
+    static auto create(Napi::Env env, Napi::Object owner, const std::shared_ptr<Client>& client, std::shared_ptr<JsExecutor> executor, Napi::Function callback,
+                       const NapiOptions& napi_options, const AccountWatcher::Options& options) -> Napi::Object;
+
+    explicit NativeAccountWatcher(const Napi::CallbackInfo& info);
+    ~NativeAccountWatcher() override;
+
+    NativeAccountWatcher(const NativeAccountWatcher&) = delete;
+    NativeAccountWatcher& operator=(const NativeAccountWatcher&) = delete;
+    NativeAccountWatcher(NativeAccountWatcher&&) = delete;
+    NativeAccountWatcher& operator=(NativeAccountWatcher&&) = delete;
+
+private:
+    struct Listener {
+        Napi::FunctionReference callback;
+        NapiOptions napi_options;
+    };
+
+    static Napi::FunctionReference* constructor;
+
+    auto add(const Napi::CallbackInfo& info) -> Napi::Value;
+    auto remove(const Napi::CallbackInfo& info) -> Napi::Value;
+    auto close(const Napi::CallbackInfo& info) -> Napi::Value;
+
+    static void dispatch(Napi::Env env, Listener& listener, const AccountChanges& changes);
+    auto parse_accounts(const Napi::CallbackInfo& info, std::vector<AccountKey>& accounts) -> bool;
+    void stop();
+
+    Napi::ObjectReference owner_;
+    // Wrappers are finalized in no particular order at environment teardown, so the client may be gone
+    std::weak_ptr<Client> client_;
+    std::shared_ptr<JsExecutor> executor_;
+    // Events can arrive after the watcher is closed, so the listener is checked by a weak pointer
+    std::shared_ptr<Listener> listener_;
+    td::actor::ActorOwn<AccountWatcher> watcher_;
+};
+
+}  // namespace tjs
@@ -0,0 +1,111 @@
+#include "native_handle.hpp"
+
+#include "tl_napi.hpp"
+#include "tl_utils.hpp"
+
+namespace tjs
+{
+Napi::FunctionReference* NativeHandle::constructor = nullptr;
+
+void NativeHandle::init(Napi::Env env, Napi::Object exports)
+{
+    constexpr auto class_name = "NativeHandle";
+
+    Napi::Function function = DefineClass(env, class_name,
+                                          {
+                                              InstanceMethod("get", &NativeHandle::get),
+                                              InstanceMethod("toObject", &NativeHandle::to_object),
+                                          });
+
+    constructor = new Napi::FunctionReference();
+    *constructor = Napi::Persistent(function);
+
+    exports.Set(class_name, function);
+}
+
+auto NativeHandle::create(Napi::Env env, ObjectPtr object, std::shared_ptr<MemoryTracker> memory) -> Napi::Object
+{
+    auto result = constructor->New({});
+    auto* handle = NativeHandle::Unwrap(result);
+    handle->object_ = std::move(object);
+    if (memory != nullptr) {
+        handle->account_memory(env, std::move(memory));
+    }
+    return result;
+}
+
+auto NativeHandle::unwrap(const Napi::Object& object) -> NativeHandle*
+{
+    if (constructor == nullptr || !object.InstanceOf(constructor->Value())) {
+        return nullptr;
+    }
+    return NativeHandle::Unwrap(object);
+}
+
+NativeHandle::NativeHandle(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<NativeHandle>{info}
+{
+    if (info.Length() < 1 || info[0].IsUndefined()) {
+        return;
+    }
+
+    // Explicitly created handles convert the JS object once
+    ton::tonlib_api::object_ptr<ton::tonlib_api::Object> object;
+    auto status = from_napi(info[0], object);
+    if (status.is_error()) {
+        const auto message = PSLICE() << "Failed to create handle: " << status;
+        Napi::TypeError::New(info.Env(), message.c_str()).ThrowAsJavaScriptException();
+        return;
+    }
+    object_ = std::move(object);
+    account_memory(info.Env(), nullptr);
+}
+
+NativeHandle::~NativeHandle()
+{
+    if (external_memory_ != 0) {
+        Napi::MemoryManagement::AdjustExternalMemory(Env(), -external_memory_);
+    }
+}
+
+void NativeHandle::account_memory(Napi::Env env, std::shared_ptr<MemoryTracker> memory)
+{
+    if (object_ == nullptr) {
+        return;
+    }
+    const auto size = tl_memory_size(*object_);
+    external_memory_ = static_cast<int64_t>(size);
+    Napi::MemoryManagement::AdjustExternalMemory(env, external_memory_);
+    memory_ = MemoryReservation{std::move(memory), MemoryKind::Handles, size};
+}
+
+auto NativeHandle::get(const Napi::CallbackInfo& info) -> Napi::Value
+{
+    auto env = info.Env();
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "Field name expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    if (object_ == nullptr) {
+        return env.Null();
+    }
+
+    const auto name = info[0].As<Napi::String>().Utf8Value();
+    const auto* field = tl_get_field(*object_, name);
+    if (field == nullptr) {
+        return env.Null();
+    }
+    // Shares ownership with the parent object
+    return create(env, ObjectPtr{object_, field});
+}
+
+auto NativeHandle::to_object(const Napi::CallbackInfo& info) -> Napi::Value
+{
+    auto env = info.Env();
+    if (object_ == nullptr) {
+        return env.Null();
+    }
+    return to_napi(env, *object_);
+}
+
+}  // namespace tjs
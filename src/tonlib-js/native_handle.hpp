@@ -0,0 +1,49 @@
+#pragma once
+
+#include <napi.h>
+#include <tl/generate/auto/tl/tonlib_api.h>
+
+#include <memory>
+
+#include "memory_tracker.hpp"
+
+namespace tjs
+{
+// Immutable tonlib object kept on the native side.
+//
+// Handles can be passed instead of JS objects of the compatible type, in
+// which case the object is copied natively instead of being converted.
+class NativeHandle final : public Napi::ObjectWrap<NativeHandle> {
+public:
+    using ObjectPtr = std::shared_ptr<const ton::tonlib_api::Object>;
+
+    static void init(Napi::Env env, Napi::Object exports);
+    // The object size is reported to V8 and to `memory` while the handle is alive
+    static auto create(Napi::Env env, ObjectPtr object, std::shared_ptr<MemoryTracker> memory = nullptr) -> Napi::Object;
+    // Returns nullptr if the object is not a handle
+    static auto unwrap(const Napi::Object& object) -> NativeHandle*;
+
+    explicit NativeHandle(const Napi::CallbackInfo& info);
+    ~NativeHandle() override;
+    NativeHandle(const NativeHandle&) = delete;
+    NativeHandle& operator=(const NativeHandle&) = delete;
+    NativeHandle(NativeHandle&&) = delete;
+    NativeHandle& operator=(NativeHandle&&) = delete;
+
+    [[nodiscard]] auto object() const -> const ObjectPtr& { return object_; }
+
+private:
+    static Napi::FunctionReference* constructor;
+
+    auto get(const Napi::CallbackInfo& info) -> Napi::Value;
+    auto to_object(const Napi::CallbackInfo& info) -> Napi::Value;
+
+    void account_memory(Napi::Env env, std::shared_ptr<MemoryTracker> memory);
+
+    ObjectPtr object_;
+    // Only handles which own the root object account it, field handles share it
+    int64_t external_memory_{0};
+    MemoryReservation memory_;
+};
+
+}  // namespace tjs
@@ -0,0 +1,61 @@
+#include "native_iterator.hpp"
+
+namespace tjs
+{
+Napi::FunctionReference* NativeIterator::constructor = nullptr;
+
+void NativeIterator::init(Napi::Env env)
+{
+    Napi::Function function = DefineClass(env, "NativeIterator",
+                                          {
+                                              InstanceMethod("next", &NativeIterator::next),
+                                              InstanceMethod("return", &NativeIterator::close),
+                                              InstanceMethod(Napi::Symbol::WellKnown(env, "asyncIterator"), &NativeIterator::self),
+                                          });
+
+    constructor = new Napi::FunctionReference();
+    *constructor = Napi::Persistent(function);
+}
+
+auto NativeIterator::create(Napi::Env env, Napi::Object owner, std::unique_ptr<IteratorSource> source) -> Napi::Object
+{
+    auto object = constructor->New({});
+    auto* iterator = NativeIterator::Unwrap(object);
+    iterator->owner_ = Napi::Persistent(owner);
+    iterator->source_ = std::move(source);
+    return object;
+}
+
+NativeIterator::NativeIterator(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<NativeIterator>{info}
+{
+}
+
+auto NativeIterator::next(const Napi::CallbackInfo& info) -> Napi::Value
+{
+    auto env = info.Env();
+    if (source_ == nullptr) {
+        auto deferred = Napi::Promise::Deferred::New(env);
+        auto result = Napi::Object::New(env);
+        result.Set("done", Napi::Boolean::New(env, true));
+        result.Set("value", env.Undefined());
+        deferred.Resolve(result);
+        return deferred.Promise();
+    }
+    return source_->next(env);
+}
+
+auto NativeIterator::close(const Napi::CallbackInfo& info) -> Napi::Value
+{
+    // Stops the producer, pending `next` calls are resolved as done
+    source_.reset();
+    owner_.Reset();
+    return next(info);
+}
+
+auto NativeIterator::self(const Napi::CallbackInfo& info) -> Napi::Value
+{
+    return info.This();
+}
+
+}  // namespace tjs
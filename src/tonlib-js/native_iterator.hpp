@@ -0,0 +1,74 @@
+#pragma once
+
+#include <napi.h>
+
+#include <memory>
+
+#include "js_executor.hpp"
+#include "stream.hpp"
+#include "tl_napi.hpp"
+
+namespace tjs
+{
+class IteratorSource {
+public:
+    virtual ~IteratorSource() = default;
+    // Returns a promise for the next iterator result
+    virtual auto next(Napi::Env env) -> Napi::Value = 0;
+};
+
+template <typename T>
+class StreamIteratorSource final : public IteratorSource {
+public:
+    // `input` keeps data copied from JS accounted while the stream is alive
+    StreamIteratorSource(std::unique_ptr<StreamHandle<T>> stream, std::shared_ptr<JsExecutor> executor, const NapiOptions& options,
+                         MemoryReservation input = {})
+        : stream_{std::move(stream)}
+        , executor_{std::move(executor)}
+        , options_{options}
+        , input_{std::move(input)}
+    {
+    }
+
+    auto next(Napi::Env env) -> Napi::Value final
+    {
+        auto [js_promise, promise] = executor_->make_promise<std::optional<Tracked<T>>>(env, [options = options_](Napi::Env env, std::optional<Tracked<T>>&& item) {
+            NapiOptionsGuard guard{options};
+            auto result = Napi::Object::New(env);
+            result.Set("done", Napi::Boolean::New(env, !item.has_value()));
+            result.Set("value", item.has_value() ? to_napi(env, item->value) : env.Undefined());
+            return result;
+        });
+        stream_->next(std::move(promise));
+        return js_promise;
+    }
+
+private:
+    std::unique_ptr<StreamHandle<T>> stream_;
+    std::shared_ptr<JsExecutor> executor_;
+    NapiOptions options_;
+    MemoryReservation input_;
+};
+
+// JS async iterator over items produced on the client's scheduler
+class NativeIterator final : public Napi::ObjectWrap<NativeIterator> {
+public:
+    static void init(Napi::Env env);
+
+    // `owner` is kept alive while the iterator is in use
+    static auto create(Napi::Env env, Napi::Object owner, std::unique_ptr<IteratorSource> source) -> Napi::Object;
+
+    explicit NativeIterator(const Napi::CallbackInfo& info);
+
+private:
+    static Napi::FunctionReference* constructor;
+
+    auto next(const Napi::CallbackInfo& info) -> Napi::Value;
+    auto close(const Napi::CallbackInfo& info) -> Napi::Value;
+    auto self(const Napi::CallbackInfo& info) -> Napi::Value;
+
+    Napi::ObjectReference owner_;
+    std::unique_ptr<IteratorSource> source_;
+};
+
+}  // namespace tjs
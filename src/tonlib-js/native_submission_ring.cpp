@@ -0,0 +1,116 @@
+#include "native_submission_ring.hpp"
+
+#include <limits>
+
+namespace tjs
+{
+Napi::FunctionReference* NativeSubmissionRing::constructor = nullptr;
+
+void NativeSubmissionRing::init(Napi::Env env)
+{
+    Napi::Function function = DefineClass(env, "SubmissionRing",
+                                          {
+                                              InstanceMethod("wake", &NativeSubmissionRing::wake),
+                                              InstanceMethod("close", &NativeSubmissionRing::close),
+                                          });
+
+    constructor = new Napi::FunctionReference();
+    *constructor = Napi::Persistent(function);
+}
+
+auto NativeSubmissionRing::create(Napi::Env env, Napi::Object owner, const std::shared_ptr<Client>& client, std::shared_ptr<JsExecutor> executor, Napi::Int32Array array,
+                                  const SubmissionRing::Options& options) -> Napi::Value
+{
+    // Producers on other threads see the memory only through a SharedArrayBuffer
+    const auto shared_array_buffer = env.Global().Get("SharedArrayBuffer");
+    if (!shared_array_buffer.IsFunction() || !array.Get("buffer").As<Napi::Object>().InstanceOf(shared_array_buffer.As<Napi::Function>())) {
+        Napi::TypeError::New(env, "Int32Array over a SharedArrayBuffer expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    // Typed array info works for shared buffers, while `ArrayBuffer::Data` may fail for them
+    auto memory_slice = td::MutableSlice{reinterpret_cast<char*>(array.Data()), array.ByteLength()};
+    auto status = SubmissionRing::init_memory(memory_slice, options);
+    if (status.is_error()) {
+        Napi::TypeError::New(env, status.message().c_str()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    // The array must be released on the JS thread, even if the actor is the last owner
+    auto* raw_memory = new Memory{};
+    raw_memory->array = Napi::Persistent(array);
+    auto memory = std::shared_ptr<Memory>(raw_memory, [executor](Memory* memory) {
+        executor->post(JsExecutor::Task{[memory](Napi::Env) { delete memory; }});
+    });
+
+    auto listener = [memory, executor]() {
+        if (!memory->notify_pending.exchange(true, std::memory_order_acq_rel)) {
+            executor->post(JsExecutor::Task{[memory](Napi::Env env) { notify(env, *memory); }});
+        }
+    };
+
+    auto object = constructor->New({});
+    auto* ring = NativeSubmissionRing::Unwrap(object);
+    ring->owner_ = Napi::Persistent(owner);
+    ring->client_ = client;
+    ring->executor_ = std::move(executor);
+    client->run_in_context([&] {
+        ring->ring_ = td::actor::create_actor<SubmissionRing>("SubmissionRing", client->dispatcher(), memory_slice, options, std::move(listener));
+    });
+
+    ring->executor_->ref(env);
+    ring->Ref();
+    return object;
+}
+
+NativeSubmissionRing::NativeSubmissionRing(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<NativeSubmissionRing>{info}
+{
+}
+
+NativeSubmissionRing::~NativeSubmissionRing()
+{
+    stop();
+}
+
+auto NativeSubmissionRing::wake(const Napi::CallbackInfo& info) -> Napi::Value
+{
+    auto client = client_.lock();
+    if (!ring_.empty() && client != nullptr) {
+        client->run_in_context([&] { td::actor::send_closure(ring_, &SubmissionRing::wake); });
+    }
+    return info.Env().Undefined();
+}
+
+auto NativeSubmissionRing::close(const Napi::CallbackInfo& info) -> Napi::Value
+{
+    if (!ring_.empty()) {
+        stop();
+        executor_->unref(info.Env());
+        Unref();
+    }
+    return info.Env().Undefined();
+}
+
+void NativeSubmissionRing::notify(Napi::Env env, Memory& memory)
+{
+    memory.notify_pending.store(false, std::memory_order_release);
+
+    auto atomics_notify = env.Global().Get("Atomics").As<Napi::Object>().Get("notify").As<Napi::Function>();
+    const auto index = Napi::Number::New(env, static_cast<double>(RingWord::Completions));
+    atomics_notify.Call({memory.array.Value(), index, Napi::Number::New(env, std::numeric_limits<double>::infinity())});
+}
+
+void NativeSubmissionRing::stop()
+{
+    if (auto client = client_.lock()) {
+        client->run_in_context([&] { ring_.reset(); });
+    }
+    else {
+        // Already stopped with the scheduler of the closed client
+        ring_.release();
+    }
+    owner_.Reset();
+}
+
+}  // namespace tjs
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <napi.h>
+
+#include <atomic>
+#include <memory>
+
+#include "js_executor.hpp"
+#include "submission_ring.hpp"
+
+namespace tjs
+{
+// JS handle of a submission ring attached to an `Int32Array` over a `SharedArrayBuffer`.
+//
+// The ring keeps its client and the event loop alive until it is closed.
+// Completions are announced with `Atomics.notify` on the JS thread, one call
+// for all responses written since the previous one. `wake` makes the ring
+// scan its slots, it is called when producers notify `Submissions`.
+class NativeSubmissionRing final : public Napi::ObjectWrap<NativeSubmissionRing> {
+public:
+    static void init(Napi::Env env);
+
+    // Throws a JS exception and returns an empty value on error
+    static auto create(Napi::Env env, Napi::Object owner, const std::shared_ptr<Client>& client, std::shared_ptr<JsExecutor> executor, Napi::Int32Array array,
+                       const SubmissionRing::Options& options) -> Napi::Value;
+
+    explicit NativeSubmissionRing(const Napi::CallbackInfo& info);
+    ~NativeSubmissionRing() override;
+
+    NativeSubmissionRing(const NativeSubmissionRing&) = delete;
+    NativeSubmissionRing& operator=(const NativeSubmissionRing&) = delete;
+    NativeSubmissionRing(NativeSubmissionRing&&) = delete;
+    NativeSubmissionRing& operator=(NativeSubmissionRing&&) = delete;
+
+private:
+    // Shared with the ring actor, released on the JS thread
+    struct Memory {
+        Napi::Reference<Napi::Int32Array> array;
+        std::atomic<bool> notify_pending{false};
+    };
+
+    static Napi::FunctionReference* constructor;
+
+    auto wake(const Napi::CallbackInfo& info) -> Napi::Value;
+    auto close(const Napi::CallbackInfo& info) -> Napi::Value;
+
+    static void notify(Napi::Env env, Memory& memory);
+    void stop();
+
+    Napi::ObjectReference owner_;
+    // Wrappers are finalized in no particular order at environment teardown, so the client may be gone
+    std::weak_ptr<Client> client_;
+    std::shared_ptr<JsExecutor> executor_;
+    td::actor::ActorOwn<SubmissionRing> ring_;
+};
+
+}  // namespace tjs
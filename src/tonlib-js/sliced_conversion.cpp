@@ -0,0 +1,102 @@
+#include "sliced_conversion.hpp"
+
+#include <td/utils/Time.h>
+
+namespace tjs
+{
+namespace
+{
+// Time is checked only once per this number of items
+constexpr uint32_t deadline_check_interval = 16;
+
+class DeferredArraysGuard final {
+public:
+    explicit DeferredArraysGuard(NapiDeferredArrays& arrays)
+        : previous_{current_napi_deferred_arrays}
+    {
+        current_napi_deferred_arrays = &arrays;
+    }
+    ~DeferredArraysGuard() { current_napi_deferred_arrays = previous_; }
+
+    DeferredArraysGuard(const DeferredArraysGuard&) = delete;
+    DeferredArraysGuard& operator=(const DeferredArraysGuard&) = delete;
+    DeferredArraysGuard(DeferredArraysGuard&&) = delete;
+    DeferredArraysGuard& operator=(DeferredArraysGuard&&) = delete;
+
+private:
+    NapiDeferredArrays* previous_;
+};
+
+}  // namespace
+
+SlicedConversion::SlicedConversion(const NapiOptions& options, std::shared_ptr<const void> data, Napi::Promise::Deferred&& deferred)
+    : options_{options}
+    , data_{std::move(data)}
+    , deferred_{std::move(deferred)}
+    , arrays_{options.min_sliced_length}
+{
+}
+
+void SlicedConversion::run_root(Napi::Env env, const std::function<Napi::Value(const Napi::Env&)>& convert)
+{
+    try {
+        NapiOptionsGuard options_guard{options_};
+        DeferredArraysGuard arrays_guard{arrays_};
+        result_ = Napi::Persistent(convert(env));
+    }
+    catch (const Napi::Error& e) {
+        deferred_.Reject(e.Value());
+        return;
+    }
+
+    if (arrays_.empty()) {
+        deferred_.Resolve(result_.Value());
+        result_.Reset();
+    }
+    else {
+        schedule(env);
+    }
+}
+
+void SlicedConversion::run_step(Napi::Env env)
+{
+    const auto deadline = td::Time::now() + options_.time_slice_ms / 1000.0;
+    uint32_t converted = 0;
+
+    try {
+        NapiOptionsGuard options_guard{options_};
+        DeferredArraysGuard arrays_guard{arrays_};
+
+        while (!arrays_.empty()) {
+            // Items may add new jobs to the back, which doesn't invalidate this reference
+            auto& job = arrays_.front();
+            auto array = job.array.Value();
+            while (job.next < job.size) {
+                job.set_item(env, array, job.next++);
+                if (++converted % deadline_check_interval == 0 && td::Time::now() >= deadline) {
+                    schedule(env);
+                    return;
+                }
+            }
+            arrays_.pop_front();
+        }
+    }
+    catch (const Napi::Error& e) {
+        deferred_.Reject(e.Value());
+        result_.Reset();
+        return;
+    }
+
+    deferred_.Resolve(result_.Value());
+    result_.Reset();
+    data_.reset();
+}
+
+void SlicedConversion::schedule(Napi::Env env)
+{
+    auto step = Napi::Function::New(
+        env, [self = shared_from_this()](const Napi::CallbackInfo& info) { self->run_step(info.Env()); }, "tonlibConversionStep");
+    env.Global().Get("setImmediate").As<Napi::Function>().Call({step});
+}
+
+}  // namespace tjs
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <napi.h>
+
+#include <memory>
+
+#include "tl_napi.hpp"
+
+namespace tjs
+{
+// Converts a response to JS values without blocking the event loop for too long.
+//
+// The top-level object is converted immediately, but arrays with at least
+// `min_sliced_length` items are left empty and filled in the following steps,
+// each of them limited by `time_slice_ms` and scheduled with `setImmediate`.
+// The promise is resolved after the last item is converted.
+class SlicedConversion final : public std::enable_shared_from_this<SlicedConversion> {
+public:
+    template <typename T>
+    static void start(Napi::Env env, const NapiOptions& options, T&& data, Napi::Promise::Deferred&& deferred)
+    {
+        auto holder = std::make_shared<std::decay_t<T>>(std::forward<T>(data));
+        auto conversion = std::shared_ptr<SlicedConversion>(new SlicedConversion{options, holder, std::move(deferred)});
+        conversion->run_root(env, [holder](const Napi::Env& env) { return to_napi(env, *holder); });
+    }
+
+    SlicedConversion(const SlicedConversion&) = delete;
+    SlicedConversion& operator=(const SlicedConversion&) = delete;
+    SlicedConversion(SlicedConversion&&) = delete;
+    SlicedConversion& operator=(SlicedConversion&&) = delete;
+    ~SlicedConversion() = default;
+
+private:
+    SlicedConversion(const NapiOptions& options, std::shared_ptr<const void> data, Napi::Promise::Deferred&& deferred);
+
+    void run_root(Napi::Env env, const std::function<Napi::Value(const Napi::Env&)>& convert);
+    void run_step(Napi::Env env);
+    void schedule(Napi::Env env);
+
+    NapiOptions options_;
+    std::shared_ptr<const void> data_;  // keeps converted object alive between steps
+    Napi::Promise::Deferred deferred_;
+    NapiDeferredArrays arrays_;
+    Napi::Reference<Napi::Value> result_;
+};
+
+}  // namespace tjs
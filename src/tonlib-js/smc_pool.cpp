@@ -0,0 +1,317 @@
+#include "smc_pool.hpp"
+
+#include <td/utils/Time.h>
+#include <vm/boc.h>
+
+#include <algorithm>
+#include <set>
+
+#include "dispatcher.hpp"
+#include "tl_utils.hpp"
+#include "tvm_stack.hpp"
+#include "worker_pool.hpp"
+
+namespace tjs
+{
+namespace
+{
+auto has_library_cells(const td::Ref<vm::Cell>& root) -> bool
+{
+    std::set<vm::CellHash> visited;
+    std::vector<td::Ref<vm::Cell>> stack{root};
+    while (!stack.empty()) {
+        auto cell = std::move(stack.back());
+        stack.pop_back();
+        if (!visited.insert(cell->get_hash()).second) {
+            continue;
+        }
+
+        bool is_special = false;
+        auto cs = vm::load_cell_slice_special(cell, is_special);
+        if (is_special && cs.special_type() == vm::Cell::SpecialType::Library) {
+            return true;
+        }
+        for (unsigned i = 0; i < cs.size_refs(); ++i) {
+            stack.emplace_back(cs.prefetch_ref(i));
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
+auto load_smc(const std::string& address, const tonlib_api::raw_fullAccountState& state) -> td::Result<std::shared_ptr<const LoadedSmc>>
+{
+    if (state.code_.empty()) {
+        return td::Status::Error("Account is not initialized");
+    }
+    auto smc = std::make_shared<LoadedSmc>();
+    TRY_RESULT_ASSIGN(smc->address, block::StdAddress::parse(address))
+    TRY_RESULT_ASSIGN(smc->state.code, vm::std_boc_deserialize(state.code_))
+    // Libraries are resolved by tonlib from the masterchain, which is not available to native runs
+    smc->uses_libraries = has_library_cells(smc->state.code);
+    if (state.data_.empty()) {
+        smc->state.data = vm::CellBuilder{}.finalize();
+    }
+    else {
+        TRY_RESULT_ASSIGN(smc->state.data, vm::std_boc_deserialize(state.data_))
+    }
+    smc->balance = state.balance_;
+    smc->sync_utime = state.sync_utime_;
+    smc->last_lt = state.last_transaction_id_ != nullptr ? state.last_transaction_id_->lt_ : 0;
+    // Serialized size is a lower bound of the loaded cells, but it is proportional to them
+    smc->memory = sizeof(LoadedSmc) + state.code_.size() + state.data_.size();
+    return std::shared_ptr<const LoadedSmc>{std::move(smc)};
+}
+
+auto run_get_method(const LoadedSmc& smc, td::Slice method, std::vector<vm::StackEntry> stack, bool pooled)
+    -> td::Result<tonlib_api::object_ptr<tonlib_api::smc_runResult>>
+{
+    const auto now = pooled ? std::max(smc.sync_utime, static_cast<int64_t>(td::Clocks::system())) : smc.sync_utime;
+
+    ton::SmartContract contract{smc.state};
+    auto answer = contract.run_get_method(ton::SmartContract::Args{}
+                                              .set_method_id(method)
+                                              .set_stack(std::move(stack))
+                                              .set_now(static_cast<int>(now))
+                                              .set_balance(smc.balance)
+                                              .set_address(smc.address));
+    if (answer.stack.is_null()) {
+        return td::Status::Error(PSLICE() << "Get-method failed with exit code " << answer.exit_code);
+    }
+
+    TRY_RESULT(result_stack, from_vm_stack(*answer.stack))
+    return tonlib_api::make_object<tonlib_api::smc_runResult>(answer.gas_used, std::move(result_stack), answer.exit_code);
+}
+
+SmcPool::SmcPool(td::actor::ActorId<RequestDispatcher> dispatcher, td::actor::ActorId<BlockSubscription> blocks, std::shared_ptr<WorkerPool> workers,
+                 const Options& options, std::shared_ptr<SmcPoolCounters> counters)
+    : dispatcher_{std::move(dispatcher)}
+    , blocks_{std::move(blocks)}
+    , workers_{std::move(workers)}
+    , options_{options}
+    , counters_{std::move(counters)}
+{
+}
+
+void SmcPool::run_get_method(std::string address, std::string method, Stack stack, Priority priority, td::Promise<Result> promise)
+{
+    auto r_key = parse_account_key(address);
+    if (r_key.is_error()) {
+        promise.set_error(r_key.move_as_error());
+        return;
+    }
+    const auto key = r_key.move_as_ok();
+
+    auto [it, inserted] = entries_.try_emplace(key);
+    auto& entry = it->second;
+    if (entry.smc != nullptr && entry.expires_at.is_in_past()) {
+        // Reloaded in place, so the account stays watched
+        lru_.erase(entry.lru);
+        bytes_ -= entry.smc->memory;
+        entry.smc = nullptr;
+        update_counters();
+    }
+    if (entry.smc != nullptr) {
+        counters_->hits++;
+        lru_.splice(lru_.begin(), lru_, entry.lru);
+        run(entry.smc, Call{std::move(method), std::move(stack), priority, std::move(promise)}, true);
+        return;
+    }
+
+    if (inserted) {
+        entry.address = std::move(address);
+    }
+    entry.waiters.emplace_back(Call{std::move(method), std::move(stack), priority, std::move(promise)});
+    if (entry.waiters.size() == 1) {
+        counters_->misses++;
+        load(key, priority);
+    }
+}
+
+void SmcPool::load(const AccountKey& key, Priority priority)
+{
+    if (options_.memory_budget != 0) {
+        if (watcher_.empty()) {
+            watcher_ = td::actor::create_actor<AccountWatcher>(
+                "SmcPoolWatcher", dispatcher_, blocks_, AccountWatcher::Options{},
+                [self = actor_id(this)](AccountChanges&& changes) { td::actor::send_closure(self, &SmcPool::on_changes, std::move(changes)); });
+        }
+        // Watched before the state is requested, so transactions after it can't be missed
+        td::actor::send_closure(watcher_, &AccountWatcher::add, std::vector<AccountKey>{key});
+    }
+
+    auto request = tonlib_api::make_object<tonlib_api::raw_getAccountState>(tonlib_api::make_object<tonlib_api::accountAddress>(entries_[key].address));
+    td::actor::send_closure(dispatcher_, &RequestDispatcher::request, std::move(request), priority,
+                            td::PromiseCreator::lambda([self = actor_id(this), key](td::Result<Client::Response> result) {
+                                td::actor::send_closure(self, &SmcPool::on_state, key, std::move(result));
+                            }));
+}
+
+void SmcPool::on_state(AccountKey key, td::Result<Client::Response> result)
+{
+    // Entries are not removed while they are loading
+    auto it = entries_.find(key);
+    CHECK(it != entries_.end())
+
+    auto r_state = expect_object<tonlib_api::raw_fullAccountState>(std::move(result));
+    if (r_state.is_error()) {
+        fail(it, r_state.error());
+        return;
+    }
+
+    workers_->run([address = it->second.address, state = r_state.move_as_ok()]() { return load_smc(address, *state); },
+                  td::PromiseCreator::lambda([self = actor_id(this), key](td::Result<std::shared_ptr<const LoadedSmc>> result) {
+                      td::actor::send_closure(self, &SmcPool::on_loaded, key, std::move(result));
+                  }));
+}
+
+void SmcPool::on_loaded(AccountKey key, td::Result<std::shared_ptr<const LoadedSmc>> result)
+{
+    auto it = entries_.find(key);
+    CHECK(it != entries_.end())
+    if (result.is_error()) {
+        fail(it, result.error());
+        return;
+    }
+
+    auto smc = result.move_as_ok();
+    auto& entry = it->second;
+    auto waiters = std::move(entry.waiters);
+    entry.waiters.clear();
+
+    if (smc->uses_libraries) {
+        // Each call is run by tonlib, which loads the state itself, so there is nothing to pool
+        const auto address = entry.address;
+        drop(it);
+        update_counters();
+        for (auto& call : waiters) {
+            run_in_tonlib(address, std::move(call));
+        }
+        return;
+    }
+
+    const bool pooled = options_.memory_budget != 0 && smc->last_lt >= entry.observed_lt;
+    if (pooled) {
+        entry.smc = smc;
+        entry.expires_at = td::Timestamp::in(options_.max_age_ms / 1000.0);
+        lru_.push_front(key);
+        entry.lru = lru_.begin();
+        bytes_ += smc->memory;
+        evict();
+    }
+    else {
+        // A newer transaction was seen while loading, so the state only serves the calls which were waiting for it
+        drop(it);
+    }
+    update_counters();
+
+    for (auto& call : waiters) {
+        run(smc, std::move(call), pooled);
+    }
+}
+
+void SmcPool::on_changes(AccountChanges&& changes)
+{
+    for (const auto& change : changes.accounts) {
+        auto it = entries_.find(change.account);
+        if (it == entries_.end()) {
+            continue;
+        }
+        auto& entry = it->second;
+        entry.observed_lt = std::max(entry.observed_lt, change.lt);
+        if (entry.smc != nullptr && entry.smc->last_lt < change.lt) {
+            counters_->invalidations++;
+            drop(it);
+        }
+    }
+    update_counters();
+}
+
+void SmcPool::run(const std::shared_ptr<const LoadedSmc>& smc, Call&& call, bool pooled)
+{
+    workers_->run(
+        [smc, method = std::move(call.method), stack = std::move(call.stack), pooled]() { return tjs::run_get_method(*smc, method, *stack, pooled); },
+        std::move(call.promise));
+}
+
+void SmcPool::run_in_tonlib(const std::string& address, Call&& call)
+{
+    std::vector<tonlib_api::object_ptr<tonlib_api::tvm_StackEntry>> stack;
+    stack.reserve(call.stack->size());
+    for (const auto& entry : *call.stack) {
+        auto r_entry = from_vm_stack_entry(entry);
+        if (r_entry.is_error()) {
+            call.promise.set_error(r_entry.move_as_error());
+            return;
+        }
+        stack.emplace_back(r_entry.move_as_ok());
+    }
+
+    auto request = tonlib_api::make_object<tonlib_api::smc_load>(tonlib_api::make_object<tonlib_api::accountAddress>(address));
+    td::actor::send_closure(
+        dispatcher_, &RequestDispatcher::request, std::move(request), call.priority,
+        td::PromiseCreator::lambda([dispatcher = dispatcher_, method = std::move(call.method), stack = std::move(stack), priority = call.priority,
+                                    promise = std::move(call.promise)](td::Result<Client::Response> result) mutable {
+            auto r_info = expect_object<tonlib_api::smc_info>(std::move(result));
+            if (r_info.is_error()) {
+                promise.set_error(r_info.move_as_error());
+                return;
+            }
+            const auto id = r_info.ok()->id_;
+
+            auto request = tonlib_api::make_object<tonlib_api::smc_runGetMethod>(id, tonlib_api::make_object<tonlib_api::smc_methodIdName>(method),
+                                                                                 std::move(stack));
+            td::actor::send_closure(dispatcher, &RequestDispatcher::request, std::move(request), priority,
+                                    td::PromiseCreator::lambda([dispatcher, id, priority, promise = std::move(promise)](td::Result<Client::Response> result) mutable {
+                                        // tonlib keeps loaded contracts until they are forgotten
+                                        td::actor::send_closure(dispatcher, &RequestDispatcher::request, tonlib_api::make_object<tonlib_api::smc_forget>(id),
+                                                                priority, td::PromiseCreator::lambda([](td::Result<Client::Response>) {}));
+                                        promise.set_result(expect_object<tonlib_api::smc_runResult>(std::move(result)));
+                                    }));
+        }));
+}
+
+void SmcPool::fail(EntryTable::iterator it, const td::Status& status)
+{
+    for (auto& call : it->second.waiters) {
+        call.promise.set_error(status.clone());
+    }
+    drop(it);
+    update_counters();
+}
+
+void SmcPool::drop(EntryTable::iterator it)
+{
+    auto& entry = it->second;
+    if (entry.smc != nullptr) {
+        lru_.erase(entry.lru);
+        bytes_ -= entry.smc->memory;
+    }
+    if (!watcher_.empty()) {
+        td::actor::send_closure(watcher_, &AccountWatcher::remove, std::vector<AccountKey>{it->first});
+    }
+    entries_.erase(it);
+    if (entries_.empty()) {
+        // Stops polling of blocks until an account is pooled again
+        watcher_.reset();
+    }
+}
+
+void SmcPool::evict()
+{
+    while (bytes_ > options_.memory_budget && !lru_.empty()) {
+        auto it = entries_.find(lru_.back());
+        CHECK(it != entries_.end())
+        counters_->evictions++;
+        drop(it);
+    }
+}
+
+void SmcPool::update_counters()
+{
+    counters_->entries = lru_.size();
+    counters_->bytes = bytes_;
+}
+
+}  // namespace tjs
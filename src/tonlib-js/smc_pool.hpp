@@ -0,0 +1,124 @@
+#pragma once
+
+#include <block/block.h>
+#include <smc-envelope/SmartContract.h>
+#include <td/actor/actor.h>
+#include <td/utils/Time.h>
+#include <vm/stack.hpp>
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+#include "account_watcher.hpp"
+#include "client.hpp"
+
+namespace tjs
+{
+// Account state prepared for get-method runs
+struct LoadedSmc {
+    block::StdAddress address;
+    ton::SmartContract::State state;
+    int64_t balance{0};
+    int64_t sync_utime{0};
+    int64_t last_lt{0};
+    // Code references library cells, which only tonlib can resolve
+    bool uses_libraries{false};
+    // Estimated native bytes
+    size_t memory{0};
+};
+
+// Get-methods run with the time, balance and address in c7, but without the
+// global config (`CONFIGPARAM` returns null) and without libraries. Contracts
+// whose code references library cells are run by tonlib with `smc.runGetMethod`.
+//
+// A pooled state stays valid until the next transaction, so it is run at the
+// current time. Other states are run at their `sync_utime`, as tonlib does.
+auto load_smc(const std::string& address, const tonlib_api::raw_fullAccountState& state) -> td::Result<std::shared_ptr<const LoadedSmc>>;
+auto run_get_method(const LoadedSmc& smc, td::Slice method, std::vector<vm::StackEntry> stack, bool pooled)
+    -> td::Result<tonlib_api::object_ptr<tonlib_api::smc_runResult>>;
+
+struct SmcPoolCounters {
+    std::atomic<size_t> entries{0};
+    std::atomic<size_t> bytes{0};
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> evictions{0};
+    std::atomic<uint64_t> invalidations{0};
+};
+
+// Loaded account states reused by get-method calls.
+//
+// States are kept by address in LRU order while their estimated size fits
+// into `memory_budget`. Pooled accounts are watched for new transactions, and
+// a state is dropped as soon as a transaction newer than its last one is
+// seen. States are also reloaded after `max_age_ms`, since the watcher can
+// lag behind or miss blocks while lite servers are unavailable. Concurrent calls for an account which is being loaded wait for the
+// same state. TVM executions run on the client's worker threads, except for
+// contracts with library cells, which are neither pooled nor run natively.
+class SmcPool final : public td::actor::Actor {
+public:
+    using Result = tonlib_api::object_ptr<tonlib_api::smc_runResult>;
+    using Stack = std::shared_ptr<const std::vector<vm::StackEntry>>;
+
+    struct Options {
+        // Zero disables pooling, each call loads the state
+        size_t memory_budget{0};
+        // Time after which a pooled state is loaded again even without new transactions
+        double max_age_ms{10000.0};
+    };
+
+    SmcPool(td::actor::ActorId<RequestDispatcher> dispatcher, td::actor::ActorId<BlockSubscription> blocks, std::shared_ptr<WorkerPool> workers,
+            const Options& options, std::shared_ptr<SmcPoolCounters> counters);
+
+    void run_get_method(std::string address, std::string method, Stack stack, Priority priority, td::Promise<Result> promise);
+
+private:
+    struct Call {
+        std::string method;
+        Stack stack;
+        Priority priority;
+        td::Promise<Result> promise;
+    };
+
+    struct Entry {
+        std::string address;
+        // Null while the state is being loaded
+        std::shared_ptr<const LoadedSmc> smc;
+        td::Timestamp expires_at;
+        std::vector<Call> waiters;
+        // Newest transaction reported by the watcher
+        int64_t observed_lt{0};
+        std::list<AccountKey>::iterator lru;
+    };
+    using EntryTable = std::unordered_map<AccountKey, Entry, AccountKeyHash>;
+
+    void load(const AccountKey& key, Priority priority);
+    void on_state(AccountKey key, td::Result<Client::Response> result);
+    void on_loaded(AccountKey key, td::Result<std::shared_ptr<const LoadedSmc>> result);
+    void on_changes(AccountChanges&& changes);
+
+    void run(const std::shared_ptr<const LoadedSmc>& smc, Call&& call, bool pooled);
+    void run_in_tonlib(const std::string& address, Call&& call);
+    void fail(EntryTable::iterator it, const td::Status& status);
+    void drop(EntryTable::iterator it);
+    void evict();
+    void update_counters();
+
+    td::actor::ActorId<RequestDispatcher> dispatcher_;
+    td::actor::ActorId<BlockSubscription> blocks_;
+    std::shared_ptr<WorkerPool> workers_;
+    Options options_;
+    std::shared_ptr<SmcPoolCounters> counters_;
+
+    // Started with the first pooled account and stopped when the pool is empty
+    td::actor::ActorOwn<AccountWatcher> watcher_;
+
+    EntryTable entries_;
+    // Loaded accounts, most recently used first
+    std::list<AccountKey> lru_;
+    size_t bytes_{0};
+};
+
+}  // namespace tjs
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <td/actor/actor.h>
+#include <td/utils/Status.h>
+
+#include <deque>
+#include <memory>
+#include <optional>
+
+#include "client.hpp"
+#include "memory_tracker.hpp"
+#include "tl_utils.hpp"
+
+namespace tjs
+{
+// Actor which produces a sequence of items for a single consumer.
+//
+// Derived actors call `push` for each item in order and `finish` or `fail`
+// at the end. `on_consumed` is called whenever the consumer takes an item
+// or waits for one, so the producer can keep its buffer filled. Items stay
+// accounted as responses from `push` until the consumer drops them.
+template <typename T>
+class StreamProducer : public td::actor::Actor {
+public:
+    // Resolves with `std::nullopt` after the last item
+    void next(td::Promise<std::optional<Tracked<T>>> promise)
+    {
+        if (!items_.empty()) {
+            auto item = std::move(items_.front());
+            items_.pop_front();
+            promise.set_value(std::optional<Tracked<T>>{std::move(item)});
+        }
+        else if (error_.is_error()) {
+            promise.set_error(error_.clone());
+            return;
+        }
+        else if (finished_) {
+            promise.set_value(std::nullopt);
+            return;
+        }
+        else {
+            waiting_.emplace_back(std::move(promise));
+        }
+        on_consumed();
+    }
+
+    // Items pushed before the tracker is set are accounted right away
+    void track_memory(std::shared_ptr<MemoryTracker> memory)
+    {
+        memory_ = std::move(memory);
+        for (auto& item : items_) {
+            item.reservation = MemoryReservation{memory_, MemoryKind::Responses, memory_size(item.value)};
+        }
+    }
+
+protected:
+    void push(T&& item)
+    {
+        auto reservation = memory_ != nullptr ? MemoryReservation{memory_, MemoryKind::Responses, memory_size(item)} : MemoryReservation{};
+        Tracked<T> tracked{std::move(item), std::move(reservation)};
+        if (waiting_.empty()) {
+            items_.emplace_back(std::move(tracked));
+            return;
+        }
+        auto promise = std::move(waiting_.front());
+        waiting_.pop_front();
+        promise.set_value(std::optional<Tracked<T>>{std::move(tracked)});
+    }
+
+    void finish()
+    {
+        finished_ = true;
+        for (auto& promise : waiting_) {
+            promise.set_value(std::nullopt);
+        }
+        waiting_.clear();
+    }
+
+    void fail(td::Status error)
+    {
+        for (auto& promise : waiting_) {
+            promise.set_error(error.clone());
+        }
+        waiting_.clear();
+        error_ = std::move(error);
+    }
+
+    [[nodiscard]] auto buffered() const -> size_t { return items_.size(); }
+    [[nodiscard]] auto waiting() const -> size_t { return waiting_.size(); }
+    [[nodiscard]] auto is_done() const -> bool { return finished_ || error_.is_error(); }
+
+    virtual void on_consumed() {}
+
+    void hangup() override
+    {
+        finish();
+        stop();
+    }
+
+private:
+    std::shared_ptr<MemoryTracker> memory_;
+    std::deque<Tracked<T>> items_;
+    std::deque<td::Promise<std::optional<Tracked<T>>>> waiting_;
+    bool finished_{false};
+    td::Status error_;
+};
+
+// Owns a producer running on the client's scheduler. Can be used from any thread.
+//
+// The client is referenced weakly, since the handle may outlive it. Its
+// actors are stopped together with the client.
+template <typename T>
+class StreamHandle final {
+public:
+    StreamHandle(std::weak_ptr<Client> client, td::actor::ActorOwn<StreamProducer<T>> producer)
+        : client_{std::move(client)}
+        , producer_{std::move(producer)}
+    {
+    }
+
+    template <typename ActorT, typename... Args>
+    static auto create(const std::shared_ptr<Client>& client, td::Slice name, Args&&... args) -> std::unique_ptr<StreamHandle>
+    {
+        td::actor::ActorOwn<StreamProducer<T>> producer;
+        client->run_in_context([&] {
+            producer = td::actor::create_actor<ActorT>(td::actor::ActorOptions().with_name(name), client->dispatcher(), std::forward<Args>(args)...);
+            td::actor::send_closure(producer, &StreamProducer<T>::track_memory, client->memory());
+        });
+        return std::make_unique<StreamHandle>(client, std::move(producer));
+    }
+
+    void next(td::Promise<std::optional<Tracked<T>>>&& promise)
+    {
+        auto client = client_.lock();
+        if (client == nullptr) {
+            promise.set_error(td::Status::Error("Client closed"));
+            return;
+        }
+        client->run_in_context([&] { td::actor::send_closure(producer_, &StreamProducer<T>::next, std::move(promise)); });
+    }
+
+    ~StreamHandle()
+    {
+        if (auto client = client_.lock()) {
+            client->run_in_context([&] { producer_.reset(); });
+        }
+        else {
+            // Already stopped with the scheduler of the closed client
+            producer_.release();
+        }
+    }
+    StreamHandle(const StreamHandle&) = delete;
+    StreamHandle& operator=(const StreamHandle&) = delete;
+    StreamHandle(StreamHandle&&) = delete;
+    StreamHandle& operator=(StreamHandle&&) = delete;
+
+private:
+    std::weak_ptr<Client> client_;
+    td::actor::ActorOwn<StreamProducer<T>> producer_;
+};
+
+}  // namespace tjs
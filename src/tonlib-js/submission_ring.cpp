@@ -0,0 +1,263 @@
+#include "submission_ring.hpp"
+
+#include <cstring>
+
+#include "dispatcher.hpp"
+#include "tl_utils.hpp"
+
+namespace tjs
+{
+namespace
+{
+static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t) && std::atomic<int32_t>::is_always_lock_free,
+              "Shared memory words must be plain lock-free integers");
+
+constexpr size_t word_size = sizeof(int32_t);
+// Free, submitted and completed sequences of a slot must differ from the free sequence of the next round
+constexpr uint32_t min_slot_count = 4;
+
+auto slots_offset() -> size_t
+{
+    return ring_header_words * word_size;
+}
+
+auto requests_offset(const SubmissionRing::Options& options) -> size_t
+{
+    return slots_offset() + options.slot_count * ring_slot_words * word_size;
+}
+
+auto responses_offset(const SubmissionRing::Options& options) -> size_t
+{
+    return requests_offset(options) + static_cast<size_t>(options.slot_count) * options.slot_size;
+}
+
+// Sequences are compared as raw words, positions wrap around at 2^32 on both sides
+auto sequence_word(uint32_t position, RingSlotStage stage) -> int32_t
+{
+    return static_cast<int32_t>(position + static_cast<uint32_t>(stage));
+}
+
+}  // namespace
+
+auto SubmissionRing::required_size(const Options& options) -> size_t
+{
+    return responses_offset(options) + static_cast<size_t>(options.slot_count) * options.slot_size;
+}
+
+auto SubmissionRing::init_memory(td::MutableSlice memory, const Options& options) -> td::Status
+{
+    if (options.slot_count < min_slot_count || (options.slot_count & (options.slot_count - 1)) != 0) {
+        // Positions wrap around at 2^32, which keeps the slot index continuous only for powers of two
+        return td::Status::Error(PSLICE() << "Slot count must be a power of two, at least " << min_slot_count);
+    }
+    if (options.slot_size == 0 || options.slot_size % word_size != 0) {
+        return td::Status::Error("Slot size must be a positive multiple of 4");
+    }
+    if (reinterpret_cast<uintptr_t>(memory.data()) % word_size != 0) {
+        return td::Status::Error("Ring memory is not aligned");
+    }
+    if (memory.size() < required_size(options)) {
+        return td::Status::Error(PSLICE() << "Ring memory is too small, " << required_size(options) << " bytes required");
+    }
+
+    std::memset(memory.data(), 0, requests_offset(options));
+    auto* words = reinterpret_cast<int32_t*>(memory.data());
+    words[static_cast<size_t>(RingWord::SlotCount)] = static_cast<int32_t>(options.slot_count);
+    words[static_cast<size_t>(RingWord::SlotSize)] = static_cast<int32_t>(options.slot_size);
+    // Slot `i` is free for the first round, which has position `i`
+    for (uint32_t slot = 0; slot < options.slot_count; ++slot) {
+        words[ring_header_words + slot * ring_slot_words + static_cast<size_t>(RingSlotWord::Sequence)] = sequence_word(slot, RingSlotStage::Free);
+    }
+    // Published last, so the ring is usable once producers see the magic
+    reinterpret_cast<std::atomic<int32_t>*>(&words[static_cast<size_t>(RingWord::Magic)])->store(ring_magic, std::memory_order_release);
+    return td::Status::OK();
+}
+
+SubmissionRing::SubmissionRing(td::actor::ActorId<RequestDispatcher> dispatcher, td::MutableSlice memory, const Options& options,
+                               CompletionListener listener)
+    : dispatcher_{std::move(dispatcher)}
+    , memory_{memory}
+    , options_{options}
+    , listener_{std::move(listener)}
+{
+}
+
+void SubmissionRing::start_up()
+{
+    taken_.assign(options_.slot_count, false);
+    stalls_.assign(options_.slot_count, Stall{});
+    poll();
+}
+
+void SubmissionRing::tear_down()
+{
+    // Producers stop waiting for slots which will never be completed
+    word(RingWord::Closed).store(1, std::memory_order_release);
+    word(RingWord::Completions).fetch_add(1, std::memory_order_release);
+    listener_();
+}
+
+void SubmissionRing::alarm()
+{
+    poll();
+}
+
+void SubmissionRing::wake()
+{
+    poll();
+}
+
+void SubmissionRing::poll()
+{
+    const auto now = td::Time::now();
+    const auto stall_timeout = options_.stall_timeout_ms / 1000.0;
+    const auto tail = static_cast<uint32_t>(word(RingWord::Tail).load(std::memory_order_acquire));
+    auto next_check = td::Timestamp::never();
+
+    for (uint32_t slot = 0; slot < options_.slot_count; ++slot) {
+        auto& stall = stalls_[slot];
+        const auto value = slot_word(slot, RingSlotWord::Sequence).load(std::memory_order_acquire);
+        // Positions of a slot are congruent to it, so the offset from the slot is the stage
+        const auto stage = static_cast<RingSlotStage>((static_cast<uint32_t>(value) - slot) % options_.slot_count);
+        const auto position = static_cast<uint32_t>(value) - static_cast<uint32_t>(stage);
+
+        if (stage == RingSlotStage::Submitted) {
+            stall.since = 0.0;
+            if (!taken_[slot]) {
+                taken_[slot] = true;
+                take(position);
+            }
+            continue;
+        }
+
+        // Only the producer may leave these stages: its position is taken but nothing is submitted, or its response is not collected
+        const bool claimed = stage == RingSlotStage::Free && static_cast<int32_t>(tail - position) > 0;
+        if (!claimed && stage != RingSlotStage::Completed) {
+            stall.since = 0.0;
+            continue;
+        }
+        if (stall.since == 0.0 || stall.sequence != value) {
+            stall = Stall{value, now};
+        } else if (now - stall.since >= stall_timeout) {
+            stall.since = 0.0;
+            expire(position, stage);
+            continue;
+        }
+        next_check.relax(td::Timestamp::at(stall.since + stall_timeout));
+    }
+
+    if (options_.poll_interval_ms > 0.0) {
+        next_check.relax(td::Timestamp::in(options_.poll_interval_ms / 1000.0));
+    }
+    alarm_timestamp() = next_check;
+}
+
+void SubmissionRing::take(uint32_t position)
+{
+    const auto slot = position % options_.slot_count;
+    const auto length = slot_word(slot, RingSlotWord::RequestLength).load(std::memory_order_relaxed);
+    if (length < 0 || static_cast<uint32_t>(length) > options_.slot_size) {
+        complete(position, tonlib_api::error(400, "Invalid request length"));
+        return;
+    }
+    auto r_request = tl_deserialize<tonlib_api::Function>(request_data(slot).substr(0, static_cast<size_t>(length)));
+    if (r_request.is_error()) {
+        complete(position, tonlib_api::error(400, PSTRING() << "Failed to parse request: " << r_request.error().message()));
+        return;
+    }
+
+    td::actor::send_closure(dispatcher_, &RequestDispatcher::request, r_request.move_as_ok(), options_.priority,
+                            td::PromiseCreator::lambda([self = actor_id(this), position](td::Result<Client::Response> result) {
+                                td::actor::send_closure(self, &SubmissionRing::on_response, position, std::move(result));
+                            }));
+}
+
+void SubmissionRing::expire(uint32_t position, RingSlotStage stage)
+{
+    const auto slot = position % options_.slot_count;
+    auto expected = sequence_word(position, stage);
+    if (stage == RingSlotStage::Completed) {
+        // The response is dropped, and the slot goes to the producer of the next round
+        if (sequence(position).compare_exchange_strong(expected, sequence_word(position + options_.slot_count, RingSlotStage::Free),
+                                                       std::memory_order_acq_rel)) {
+            LOG(WARNING) << "Response at position " << position << " was not collected in time, dropping it";
+        }
+        return;
+    }
+
+    // The slot is not in use by anyone else while it is free, so the error can be written before it is published
+    write_response(slot, tonlib_api::error(408, "Request was not submitted in time"));
+    if (!sequence(position).compare_exchange_strong(expected, sequence_word(position, RingSlotStage::Completed), std::memory_order_acq_rel)) {
+        // Submitted right now, it is taken on the next scan
+        alarm_timestamp() = td::Timestamp::now();
+        return;
+    }
+    LOG(WARNING) << "Request at position " << position << " was not submitted in time, completing it with an error";
+    word(RingWord::Completions).fetch_add(1, std::memory_order_release);
+    listener_();
+}
+
+void SubmissionRing::on_response(uint32_t position, td::Result<Client::Response> result)
+{
+    if (result.is_error()) {
+        const auto& error = result.error();
+        complete(position, tonlib_api::error(error.code(), error.message().str()));
+        return;
+    }
+    auto response = result.move_as_ok();
+    if (response == nullptr) {
+        complete(position, tonlib_api::error(500, "Empty response"));
+        return;
+    }
+    complete(position, *response);
+}
+
+void SubmissionRing::complete(uint32_t position, const tonlib_api::Object& response)
+{
+    const auto slot = position % options_.slot_count;
+    write_response(slot, response);
+    sequence(position).store(sequence_word(position, RingSlotStage::Completed), std::memory_order_release);
+    word(RingWord::Completions).fetch_add(1, std::memory_order_release);
+    taken_[slot] = false;
+
+    listener_();
+}
+
+void SubmissionRing::write_response(uint32_t slot, const tonlib_api::Object& response)
+{
+    auto data = tl_serialize(response);
+    if (data.size() > options_.slot_size) {
+        data = tl_serialize(tonlib_api::error(500, PSTRING() << "Response is too large: " << data.size() << " bytes"));
+    }
+
+    std::memcpy(response_data(slot).data(), data.data(), data.size());
+    slot_word(slot, RingSlotWord::ResponseLength).store(static_cast<int32_t>(data.size()), std::memory_order_relaxed);
+}
+
+auto SubmissionRing::word(RingWord index) -> std::atomic<int32_t>&
+{
+    return *reinterpret_cast<std::atomic<int32_t>*>(memory_.data() + static_cast<size_t>(index) * word_size);
+}
+
+auto SubmissionRing::sequence(uint32_t position) -> std::atomic<int32_t>&
+{
+    return slot_word(position % options_.slot_count, RingSlotWord::Sequence);
+}
+
+auto SubmissionRing::slot_word(uint32_t slot, RingSlotWord index) -> std::atomic<int32_t>&
+{
+    const auto offset = slots_offset() + (slot * ring_slot_words + static_cast<size_t>(index)) * word_size;
+    return *reinterpret_cast<std::atomic<int32_t>*>(memory_.data() + offset);
+}
+
+auto SubmissionRing::request_data(uint32_t slot) -> td::MutableSlice
+{
+    return memory_.substr(requests_offset(options_) + static_cast<size_t>(slot) * options_.slot_size, options_.slot_size);
+}
+
+auto SubmissionRing::response_data(uint32_t slot) -> td::MutableSlice
+{
+    return memory_.substr(responses_offset(options_) + static_cast<size_t>(slot) * options_.slot_size, options_.slot_size);
+}
+
+}  // namespace tjs
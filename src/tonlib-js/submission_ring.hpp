@@ -0,0 +1,139 @@
+#pragma once
+
+#include <td/actor/actor.h>
+#include <td/utils/Slice.h>
+#include <td/utils/Status.h>
+
+#include <atomic>
+#include <functional>
+#include <vector>
+
+#include "client.hpp"
+
+namespace tjs
+{
+// Layout of the shared memory, all words are little-endian int32 so that JS can use `Atomics` on an `Int32Array`:
+//
+//   header:     `ring_header_words` words, see `RingWord`
+//   slots:      `slot_count` * `ring_slot_words` words, see `RingSlotWord`
+//   requests:   `slot_count` * `slot_size` bytes
+//   responses:  `slot_count` * `slot_size` bytes
+//
+// Each slot has a sequence number, like in Vyukov's bounded queue, which
+// tells the position and the stage of the request the slot belongs to:
+//
+//   position       free for the producer of this position
+//   position + 1   request is submitted
+//   position + 2   response is written
+//
+// Producers take positions from `Tail` with `Atomics.add` and wait until the
+// sequence of the slot `position % slot_count` equals the position, write the
+// boxed TL request and publish `position + 1` with `Atomics.compareExchange`.
+// Then they increment `Submissions` and wake the consumer with `Atomics.notify`
+// on it. Each slot is consumed on its own, so a request never waits for
+// earlier positions. After the response is written, the sequence is set to
+// `position + 2`, `Completions` is incremented and waiters on it are woken
+// with `Atomics.notify`. The producer copies the response out and hands the
+// slot to the next round by exchanging `position + 2` for
+// `position + slot_count`, so a slot is never taken by a later round before
+// the previous one has finished with it. Sequences wrap around together with
+// positions at 2^32.
+//
+// A producer may stop between taking a position and publishing its request,
+// or before it collects the response, for example when its worker is
+// terminated. Slots which stay in such a stage for `stall_timeout_ms` are
+// completed with an error, or handed to the next round, so they don't block
+// later rounds forever. A producer which resumes after that sees the changed
+// sequence and fails the request.
+enum class RingWord : size_t {
+    Magic = 0,
+    SlotCount = 1,
+    SlotSize = 2,
+    Tail = 3,
+    Completions = 4,
+    Closed = 5,
+    Submissions = 6,
+};
+
+enum class RingSlotWord : size_t {
+    Sequence = 0,
+    RequestLength = 1,
+    ResponseLength = 2,
+};
+
+// Offsets of the slot sequence from the position of its request
+enum class RingSlotStage : uint32_t {
+    Free = 0,
+    Submitted = 1,
+    Completed = 2,
+};
+
+constexpr int32_t ring_magic = 0x524a5354;
+constexpr size_t ring_header_words = 16;
+constexpr size_t ring_slot_words = 4;
+
+// Consumes requests from a ring in shared memory and writes responses back.
+//
+// All slots are scanned within the client's scheduler whenever the ring is
+// woken with `wake`, which the JS side does after producers notify
+// `Submissions`, so producers never need to call into the addon. Without
+// wakeups the ring is scanned every `poll_interval_ms` instead.
+class SubmissionRing final : public td::actor::Actor {
+public:
+    struct Options {
+        uint32_t slot_count{1024};
+        uint32_t slot_size{16384};
+        Priority priority{Priority::Interactive};
+        // 0 to scan only when woken
+        double poll_interval_ms{1.0};
+        double stall_timeout_ms{10000.0};
+    };
+
+    // Called on the client's scheduler thread after new responses are written
+    using CompletionListener = std::function<void()>;
+
+    static auto required_size(const Options& options) -> size_t;
+    // Checks the options and the memory and writes the header
+    static auto init_memory(td::MutableSlice memory, const Options& options) -> td::Status;
+
+    // `listener` must keep `memory` alive, since the actor is destroyed asynchronously
+    SubmissionRing(td::actor::ActorId<RequestDispatcher> dispatcher, td::MutableSlice memory, const Options& options, CompletionListener listener);
+
+    // Scans the ring for submitted requests
+    void wake();
+
+private:
+    // Sequence of a slot which stays in a stage that only its producer can leave
+    struct Stall {
+        int32_t sequence{0};
+        double since{0.0};
+    };
+
+    void start_up() final;
+    void tear_down() final;
+    void alarm() final;
+
+    void poll();
+    void take(uint32_t position);
+    void expire(uint32_t position, RingSlotStage stage);
+    void on_response(uint32_t position, td::Result<Client::Response> result);
+    void complete(uint32_t position, const tonlib_api::Object& response);
+    void write_response(uint32_t slot, const tonlib_api::Object& response);
+
+    auto word(RingWord index) -> std::atomic<int32_t>&;
+    auto sequence(uint32_t position) -> std::atomic<int32_t>&;
+    auto slot_word(uint32_t slot, RingSlotWord index) -> std::atomic<int32_t>&;
+    auto request_data(uint32_t slot) -> td::MutableSlice;
+    auto response_data(uint32_t slot) -> td::MutableSlice;
+
+    td::actor::ActorId<RequestDispatcher> dispatcher_;
+    td::MutableSlice memory_;
+    Options options_;
+    CompletionListener listener_;
+
+    // Slots whose requests are being processed
+    std::vector<bool> taken_;
+    std::vector<Stall> stalls_;
+};
+
+}  // namespace tjs
@@ -0,0 +1,172 @@
+#include "sync_state.hpp"
+
+#include <algorithm>
+
+#include <td/utils/JsonBuilder.h>
+#include <td/utils/base64.h>
+#include <td/utils/filesystem.h>
+#include <td/utils/misc.h>
+#include <td/utils/port/path.h>
+
+namespace tjs
+{
+namespace
+{
+constexpr int32_t masterchain_id = -1;
+
+auto find_field(td::JsonValue::Object& object, td::Slice name) -> td::JsonValue*
+{
+    for (auto& field : object) {
+        if (field.first == name) {
+            return &field.second;
+        }
+    }
+    return nullptr;
+}
+
+template <typename T>
+auto get_integer_field(td::JsonValue::Object& object, td::Slice name) -> td::Result<T>
+{
+    auto* value = find_field(object, name);
+    if (value == nullptr || value->type() != td::JsonValue::Type::Number) {
+        return td::Status::Error(PSLICE() << "Expected number field " << name);
+    }
+    return td::to_integer_safe<T>(value->get_number());
+}
+
+auto get_hash_field(td::JsonValue::Object& object, td::Slice name) -> td::Result<std::string>
+{
+    auto* value = find_field(object, name);
+    if (value == nullptr || value->type() != td::JsonValue::Type::String) {
+        return td::Status::Error(PSLICE() << "Expected string field " << name);
+    }
+    TRY_RESULT(hash, td::base64_decode(value->get_string()))
+    if (hash.size() != 32) {
+        return td::Status::Error(PSLICE() << "Invalid " << name << " length");
+    }
+    return std::move(hash);
+}
+
+auto get_block(td::JsonValue::Object& object) -> td::Result<tonlib_api::object_ptr<tonlib_api::ton_blockIdExt>>
+{
+    auto block = tonlib_api::make_object<tonlib_api::ton_blockIdExt>();
+    TRY_RESULT_ASSIGN(block->workchain_, get_integer_field<int32_t>(object, "workchain"))
+    TRY_RESULT_ASSIGN(block->shard_, get_integer_field<int64_t>(object, "shard"))
+    TRY_RESULT_ASSIGN(block->seqno_, get_integer_field<int32_t>(object, "seqno"))
+    TRY_RESULT_ASSIGN(block->root_hash_, get_hash_field(object, "root_hash"))
+    TRY_RESULT_ASSIGN(block->file_hash_, get_hash_field(object, "file_hash"))
+    if (block->workchain_ != masterchain_id) {
+        return td::Status::Error("Expected a masterchain block");
+    }
+    return std::move(block);
+}
+
+auto get_block_field(td::JsonValue::Object& object, td::Slice name) -> td::Result<tonlib_api::object_ptr<tonlib_api::ton_blockIdExt>>
+{
+    auto* value = find_field(object, name);
+    if (value == nullptr || value->type() != td::JsonValue::Type::Object) {
+        return td::Status::Error(PSLICE() << "Expected object field " << name);
+    }
+    auto r_block = get_block(value->get_object());
+    if (r_block.is_error()) {
+        return r_block.move_as_error_prefix(PSLICE() << "Invalid " << name << ": ");
+    }
+    return r_block.move_as_ok();
+}
+
+auto get_validator(td::JsonValue& config) -> td::Result<td::JsonValue::Object*>
+{
+    if (config.type() != td::JsonValue::Type::Object) {
+        return td::Status::Error("Expected config object");
+    }
+    auto* validator = find_field(config.get_object(), "validator");
+    if (validator == nullptr || validator->type() != td::JsonValue::Type::Object) {
+        return td::Status::Error("Validator config not found");
+    }
+    return &validator->get_object();
+}
+
+auto find_trust_root(td::JsonValue::Object& validator) -> td::Result<tonlib_api::object_ptr<tonlib_api::ton_blockIdExt>>
+{
+    if (auto* init_block = find_field(validator, "init_block"); init_block != nullptr && init_block->type() == td::JsonValue::Type::Object) {
+        return get_block_field(validator, "init_block");
+    }
+    return get_block_field(validator, "zero_state");
+}
+
+auto same_block(const tonlib_api::ton_blockIdExt& left, const tonlib_api::ton_blockIdExt& right) -> bool
+{
+    return left.workchain_ == right.workchain_ && left.shard_ == right.shard_ && left.seqno_ == right.seqno_ && left.root_hash_ == right.root_hash_ &&
+           left.file_hash_ == right.file_hash_;
+}
+
+auto to_json(const tonlib_api::ton_blockIdExt& block) -> std::string
+{
+    return PSTRING() << "{\"workchain\":" << block.workchain_ << ",\"shard\":" << block.shard_ << ",\"seqno\":" << block.seqno_
+                     << ",\"root_hash\":\"" << td::base64_encode(block.root_hash_) << "\",\"file_hash\":\""
+                     << td::base64_encode(block.file_hash_) << "\"}";
+}
+
+}  // namespace
+
+auto load_sync_state(const std::string& path) -> td::Result<SyncState>
+{
+    TRY_RESULT(content, td::read_file_str(path))
+    TRY_RESULT(json, td::json_decode(td::MutableSlice{content}))
+    if (json.type() != td::JsonValue::Type::Object) {
+        return td::Status::Error("Expected sync state object");
+    }
+    auto& object = json.get_object();
+
+    SyncState state;
+    TRY_RESULT_ASSIGN(state.block, get_block_field(object, "block"))
+    TRY_RESULT_ASSIGN(state.root, get_block_field(object, "root"))
+    return std::move(state);
+}
+
+auto save_sync_state(const std::string& path, const SyncState& state) -> td::Status
+{
+    const auto temp_path = path + ".tmp";
+    TRY_STATUS(td::write_file(temp_path, PSTRING() << "{\"block\":" << to_json(*state.block) << ",\"root\":" << to_json(*state.root) << "}"))
+    return td::rename(temp_path, path);
+}
+
+auto get_trust_root(const std::string& config) -> td::Result<tonlib_api::object_ptr<tonlib_api::ton_blockIdExt>>
+{
+    std::string buffer = config;
+    TRY_RESULT(json, td::json_decode(td::MutableSlice{buffer}))
+    TRY_RESULT(validator, get_validator(json))
+    return find_trust_root(*validator);
+}
+
+auto apply_sync_state(const std::string& config, const SyncState& state) -> td::Result<std::string>
+{
+    std::string buffer = config;
+    TRY_RESULT(json, td::json_decode(td::MutableSlice{buffer}))
+    TRY_RESULT(validator, get_validator(json))
+    auto& validator_object = *validator;
+
+    // The file isn't signed, so the block is only trusted as a successor of the root it was verified from
+    TRY_RESULT(root, find_trust_root(validator_object))
+    if (!same_block(*root, *state.root)) {
+        return td::Status::Error(PSLICE() << "Sync state was verified from block " << state.root->seqno_ << " instead of the trusted block "
+                                          << root->seqno_ << " of the config");
+    }
+    if (root->seqno_ >= state.block->seqno_) {
+        return config;
+    }
+
+    // Decoded values point into these buffers, so they must outlive the encoding
+    std::string block_buffer = to_json(*state.block);
+    TRY_RESULT(block_json, td::json_decode(td::MutableSlice{block_buffer}))
+    std::string name_buffer = "init_block";
+
+    validator_object.erase(std::remove_if(validator_object.begin(), validator_object.end(),
+                                          [](const auto& field) { return field.first == td::Slice{"init_block"}; }),
+                           validator_object.end());
+    validator_object.emplace_back(td::MutableSlice{name_buffer}, std::move(block_json));
+
+    return td::json_encode<std::string>(json);
+}
+
+}  // namespace tjs
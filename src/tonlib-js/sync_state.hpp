@@ -0,0 +1,29 @@
+#pragma once
+
+#include <auto/tl/tonlib_api.h>
+#include <td/utils/Status.h>
+
+#include <string>
+
+namespace tjs
+{
+namespace tonlib_api = ton::tonlib_api;
+
+// Last verified key block, together with the trusted block of the config it was verified from
+struct SyncState {
+    tonlib_api::object_ptr<tonlib_api::ton_blockIdExt> block;
+    tonlib_api::object_ptr<tonlib_api::ton_blockIdExt> root;
+};
+
+auto load_sync_state(const std::string& path) -> td::Result<SyncState>;
+// Replaces the file atomically, so a crash never leaves a partially written state
+auto save_sync_state(const std::string& path, const SyncState& state) -> td::Status;
+
+// Block which tonlib trusts: `init_block` of the config if present, otherwise the zero state
+auto get_trust_root(const std::string& config) -> td::Result<tonlib_api::object_ptr<tonlib_api::ton_blockIdExt>>;
+
+// Makes tonlib start syncing from the saved key block unless the config already has a newer trusted block.
+// Fails if the block was verified from another trust root than the one of the config
+auto apply_sync_state(const std::string& config, const SyncState& state) -> td::Result<std::string>;
+
+}  // namespace tjs
@@ -2,6 +2,92 @@
 
 namespace tjs
 {
+auto NapiFields::parse(const Napi::Value& value) -> td::Result<std::shared_ptr<const NapiFields>>
+{
+    auto fields = std::make_shared<NapiFields>();
+    if (value.IsArray()) {
+        auto paths = value.As<Napi::Array>();
+        for (uint32_t i = 0; i < paths.Length(); ++i) {
+            auto path = paths.Get(i);
+            if (!path.IsString()) {
+                return td::Status::Error("Expected field path string");
+            }
+            TRY_STATUS(fields->add_path(path.As<Napi::String>().Utf8Value()))
+        }
+    }
+    else if (value.IsObject()) {
+        TRY_STATUS(fields->add_mask(value.As<Napi::Object>()))
+    }
+    else {
+        return td::Status::Error("Expected array of field paths or field mask");
+    }
+    if (fields->children_.empty()) {
+        return td::Status::Error("Field projection is empty");
+    }
+    return std::shared_ptr<const NapiFields>{std::move(fields)};
+}
+
+auto NapiFields::add_path(td::Slice path) -> td::Status
+{
+    auto* node = this;
+    auto rest = path;
+    while (!node->whole_) {
+        const auto dot = rest.find('.');
+        const auto name = rest.substr(0, dot);
+        if (name.empty()) {
+            return td::Status::Error(PSLICE() << "Invalid field path " << path);
+        }
+        node = &node->child(name);
+        if (dot == static_cast<size_t>(-1)) {
+            node->select_whole();
+            break;
+        }
+        rest.remove_prefix(dot + 1);
+    }
+    return td::Status::OK();
+}
+
+auto NapiFields::add_mask(const Napi::Object& mask) -> td::Status
+{
+    auto names = mask.GetPropertyNames();
+    for (uint32_t i = 0; i < names.Length(); ++i) {
+        const auto name = names.Get(i).As<Napi::String>().Utf8Value();
+        auto value = mask.Get(name);
+        if (value.IsBoolean()) {
+            if (value.As<Napi::Boolean>().Value()) {
+                child(name).select_whole();
+            }
+        }
+        else if (value.IsObject()) {
+            auto& nested = child(name);
+            TRY_STATUS(nested.add_mask(value.As<Napi::Object>()))
+            if (!nested.whole_ && nested.children_.empty()) {
+                return td::Status::Error(PSLICE() << "Empty field mask for " << name);
+            }
+        }
+        else {
+            return td::Status::Error(PSLICE() << "Expected boolean or object for field " << name);
+        }
+    }
+    return td::Status::OK();
+}
+
+auto NapiFields::child(td::Slice name) -> NapiFields&
+{
+    for (auto& [child_name, child] : children_) {
+        if (child_name == name) {
+            return *child;
+        }
+    }
+    return *children_.emplace_back(name.str(), std::make_unique<NapiFields>()).second;
+}
+
+void NapiFields::select_whole()
+{
+    // Requesting the whole field overrides its nested selection
+    whole_ = true;
+    children_.clear();
+}
 
 auto from_napi(const Napi::Value& from, int32_t& to) -> td::Status
 {
@@ -75,27 +161,75 @@ auto from_napi(const Napi::Value& from, td::SecureString& to) -> td::Status
     return td::Status::OK();
 }
 
+auto to_napi_encoded(const Napi::Env& env, BytesEncoding encoding, td::Slice data) -> Napi::Value
+{
+    thread_local std::string buffer;
+    buffer.resize(encoded_size(encoding, data.size()));
+    encode_bytes(encoding, data, &buffer[0]);
+
+    // Encoded bytes are always ASCII, so latin1 strings avoid utf8 validation
+    napi_value result;
+    const auto status = napi_create_string_latin1(env, buffer.data(), buffer.size(), &result);
+    if (status != napi_ok) {
+        Napi::Error::New(env).ThrowAsJavaScriptException();
+        return Napi::Value{};
+    }
+    return Napi::Value{env, result};
+}
+
+// Encoded copies of secret bytes are wiped when `secure` is set, the caller wipes `storage`
+static auto from_napi_bytes_view(const Napi::Value& from, td::Slice& to, std::string& storage, bool secure = false) -> td::Status
+{
+    if (from.IsArrayBuffer()) {
+        auto array_buffer = from.As<Napi::ArrayBuffer>();
+        to = td::Slice{static_cast<const char*>(array_buffer.Data()), array_buffer.ByteLength()};
+        return td::Status::OK();
+    }
+    if (from.IsTypedArray()) {
+        auto typed_array = from.As<Napi::TypedArray>();
+        auto* data = static_cast<const char*>(typed_array.ArrayBuffer().Data()) + typed_array.ByteOffset();
+        to = td::Slice{data, typed_array.ByteLength()};
+        return td::Status::OK();
+    }
+    if (from.IsString()) {
+        // Strings are decoded using the client encoding, base64 when bytes are returned as ArrayBuffer
+        auto encoded = from.As<Napi::String>().Utf8Value();
+        auto status = decode_bytes(napi_options().bytes_encoding, encoded, storage);
+        if (secure) {
+            td::MutableSlice{encoded}.fill_zero_secure();
+        }
+        TRY_STATUS(std::move(status))
+        to = storage;
+        return td::Status::OK();
+    }
+    return td::Status::Error("Expected ArrayBuffer, TypedArray or encoded string");
+}
+
 auto from_napi_bytes(const Napi::Value& from, std::string& to) -> td::Status
 {
-    if (!from.IsArrayBuffer()) {
-        return td::Status::Error("Expected ArrayBuffer");
+    td::Slice data;
+    std::string storage;
+    TRY_STATUS(from_napi_bytes_view(from, data, storage))
+    if (data.begin() == storage.data()) {
+        to = std::move(storage);
+    }
+    else {
+        to = data.str();
     }
-    auto array_buffer = from.As<Napi::ArrayBuffer>();
-    to.resize(array_buffer.ByteLength());
-    std::memcpy(to.data(), array_buffer.Data(), array_buffer.ByteLength());
     return td::Status::OK();
 }
 
 auto from_napi_bytes(const Napi::Value& from, td::SecureString& to) -> td::Status
 {
-    if (!from.IsArrayBuffer()) {
-        return td::Status::Error("Expected ArrayBuffer");
+    td::Slice data;
+    std::string storage;
+    auto status = from_napi_bytes_view(from, data, storage, true);
+    if (status.is_ok()) {
+        to = td::SecureString{data};
     }
-    auto array_buffer = from.As<Napi::ArrayBuffer>();
-    td::BufferSlice dest(array_buffer.ByteLength());
-    std::memcpy(dest.data(), array_buffer.Data(), array_buffer.ByteLength());
-    to = td::SecureString{std::move(dest)};
-    return td::Status::OK();
+    // Decoded size is known upfront, so the string was never reallocated and this is the only plain copy
+    td::MutableSlice{storage}.fill_zero_secure();
+    return status;
 }
 
 }  // namespace tjs
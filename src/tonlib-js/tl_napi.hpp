@@ -11,12 +11,180 @@
 #include <tl/TlObject.h>
 #include <tl/generate/auto/tl/tonlib_api.h>
 
+#include <deque>
+#include <functional>
+#include <memory>
 #include <type_traits>
 
+#include "encoding.hpp"
 #include "gen/tonlib_napi.h"
+#include "native_handle.hpp"
+#include "tl_utils.hpp"
 
 namespace tjs
 {
+// Subset of fields to convert. Nested objects are selected by field names,
+// and a selection applies to every item of an array field
+class NapiFields final {
+public:
+    // Accepts an array of dot-separated paths or a mask object, e.g. `{ transactions: { utime: true } }`
+    static auto parse(const Napi::Value& value) -> td::Result<std::shared_ptr<const NapiFields>>;
+
+    // Returns nullptr if the field is not selected
+    [[nodiscard]] auto find(td::Slice name) const -> const NapiFields*
+    {
+        if (whole_) {
+            return this;
+        }
+        for (const auto& [child_name, child] : children_) {
+            if (child_name == name) {
+                return child.get();
+            }
+        }
+        return nullptr;
+    }
+
+    // Field without nested selection, converted entirely
+    [[nodiscard]] auto is_whole() const -> bool { return whole_; }
+
+private:
+    auto add_path(td::Slice path) -> td::Status;
+    auto add_mask(const Napi::Object& mask) -> td::Status;
+    auto child(td::Slice name) -> NapiFields&;
+    void select_whole();
+
+    std::vector<std::pair<std::string, std::unique_ptr<NapiFields>>> children_;
+    bool whole_{false};
+};
+
+// Fields of the object which is being converted on the current thread, nullptr for all fields
+inline thread_local const NapiFields* current_napi_fields = nullptr;
+
+class NapiFieldsGuard final {
+public:
+    explicit NapiFieldsGuard(const NapiFields* fields)
+        : previous_{current_napi_fields}
+    {
+        current_napi_fields = fields != nullptr && fields->is_whole() ? nullptr : fields;
+    }
+    ~NapiFieldsGuard() { current_napi_fields = previous_; }
+
+    NapiFieldsGuard(const NapiFieldsGuard&) = delete;
+    NapiFieldsGuard& operator=(const NapiFieldsGuard&) = delete;
+    NapiFieldsGuard(NapiFieldsGuard&&) = delete;
+    NapiFieldsGuard& operator=(NapiFieldsGuard&&) = delete;
+
+private:
+    const NapiFields* previous_;
+};
+
+// Used by generated converters. Selects nested fields while the field is converted, and does nothing without a projection
+class NapiFieldScope final {
+public:
+    NapiFieldScope(const NapiFields* fields, td::Slice name)
+        : fields_{fields}
+    {
+        if (fields_ != nullptr) {
+            const auto* child = fields_->find(name);
+            selected_ = child != nullptr;
+            current_napi_fields = selected_ && !child->is_whole() ? child : nullptr;
+        }
+    }
+    ~NapiFieldScope()
+    {
+        if (fields_ != nullptr) {
+            current_napi_fields = fields_;
+        }
+    }
+
+    explicit operator bool() const { return selected_; }
+
+    NapiFieldScope(const NapiFieldScope&) = delete;
+    NapiFieldScope& operator=(const NapiFieldScope&) = delete;
+    NapiFieldScope(NapiFieldScope&&) = delete;
+    NapiFieldScope& operator=(NapiFieldScope&&) = delete;
+
+private:
+    const NapiFields* fields_;
+    bool selected_{true};
+};
+
+struct NapiOptions {
+    BytesEncoding bytes_encoding{BytesEncoding::ArrayBuffer};
+    // Max time of the single conversion step in ms. Zero disables time slicing
+    double time_slice_ms{0.0};
+    // Arrays with at least this number of items are filled during the next steps
+    size_t min_sliced_length{256};
+    // Converts only these fields of the response, nullptr for all fields
+    std::shared_ptr<const NapiFields> fields{};
+};
+
+// Options of the conversion which is running on the current thread
+inline thread_local const NapiOptions* current_napi_options = nullptr;
+
+inline auto napi_options() -> const NapiOptions&
+{
+    static const NapiOptions default_options{};
+    return current_napi_options != nullptr ? *current_napi_options : default_options;
+}
+
+class NapiOptionsGuard final {
+public:
+    explicit NapiOptionsGuard(const NapiOptions& options)
+        : previous_{current_napi_options}
+        , fields_guard_{options.fields.get()}
+    {
+        current_napi_options = &options;
+    }
+    ~NapiOptionsGuard() { current_napi_options = previous_; }
+
+    NapiOptionsGuard(const NapiOptionsGuard&) = delete;
+    NapiOptionsGuard& operator=(const NapiOptionsGuard&) = delete;
+    NapiOptionsGuard(NapiOptionsGuard&&) = delete;
+    NapiOptionsGuard& operator=(NapiOptionsGuard&&) = delete;
+
+private:
+    const NapiOptions* previous_;
+    NapiFieldsGuard fields_guard_;
+};
+
+// Collects large arrays whose items are converted later, see `SlicedConversion`
+class NapiDeferredArrays {
+public:
+    using SetItem = std::function<void(const Napi::Env&, Napi::Array&, uint32_t)>;
+
+    struct Job {
+        Napi::Reference<Napi::Array> array;
+        uint32_t size;
+        uint32_t next;
+        SetItem set_item;
+    };
+
+    explicit NapiDeferredArrays(size_t min_length)
+        : min_length_{min_length}
+    {
+    }
+
+    auto try_defer(Napi::Array& array, size_t size, SetItem&& set_item) -> bool
+    {
+        if (size < min_length_) {
+            return false;
+        }
+        jobs_.emplace_back(Job{Napi::Persistent(array), static_cast<uint32_t>(size), 0, std::move(set_item)});
+        return true;
+    }
+
+    [[nodiscard]] auto empty() const -> bool { return jobs_.empty(); }
+    auto front() -> Job& { return jobs_.front(); }
+    void pop_front() { jobs_.pop_front(); }
+
+private:
+    size_t min_length_;
+    std::deque<Job> jobs_;
+};
+
+inline thread_local NapiDeferredArrays* current_napi_deferred_arrays = nullptr;
+
 template <typename T>
 struct NapiPropsBase : Napi::ObjectWrap<T> {
     explicit NapiPropsBase(Napi::CallbackInfo& info)
@@ -63,8 +231,14 @@ struct NapiBytes {
     td::Slice value;
 };
 
+auto to_napi_encoded(const Napi::Env& env, BytesEncoding encoding, td::Slice data) -> Napi::Value;
+
 inline auto to_napi(const Napi::Env& env, const NapiBytes& data) -> Napi::Value
 {
+    const auto encoding = napi_options().bytes_encoding;
+    if (encoding != BytesEncoding::ArrayBuffer) {
+        return to_napi_encoded(env, encoding, data.value);
+    }
     auto array = Napi::ArrayBuffer::New(env, data.value.size());
     std::memcpy(array.Data(), data.value.begin(), data.value.size());
     return array;
@@ -132,6 +306,13 @@ template <typename T>
 auto to_napi(const Napi::Env& env, const std::vector<T>& data) -> Napi::Value
 {
     auto array = Napi::Array::New(env, data.size());
+    if (current_napi_deferred_arrays != nullptr &&
+        current_napi_deferred_arrays->try_defer(array, data.size(), [&data, fields = current_napi_fields](const Napi::Env& env, Napi::Array& array, uint32_t i) {
+            NapiFieldsGuard guard{fields};
+            array.Set(i, to_napi(env, data[i]));
+        })) {
+        return array;
+    }
     for (size_t i = 0; i < data.size(); ++i) {
         array.Set(i, to_napi(env, data[i]));
     }
@@ -198,6 +379,22 @@ private:
 
 constexpr auto napi_constructor = "constructor";
 
+template <typename T>
+auto from_native_handle(const NativeHandle& handle, std::unique_ptr<T>& to) -> td::Status
+{
+    const auto& object = handle.object();
+    if (object == nullptr) {
+        to = nullptr;
+        return td::Status::OK();
+    }
+    const auto* typed = dynamic_cast<const T*>(object.get());
+    if (typed == nullptr) {
+        return td::Status::Error("Native handle has incompatible type");
+    }
+    to = tl_clone(*typed);
+    return td::Status::OK();
+}
+
 template <typename T>
 auto from_napi(const Napi::Value& from, std::unique_ptr<T>& to) -> td::Status
 {
@@ -211,6 +408,9 @@ auto from_napi(const Napi::Value& from, std::unique_ptr<T>& to) -> td::Status
     auto object = from.As<Napi::Object>();
     auto props = object.Get("_props");
     if (props.IsUndefined()) {
+        if (const auto* handle = NativeHandle::unwrap(object); handle != nullptr) {
+            return from_native_handle(*handle, to);
+        }
         props = from.Env().Null();
     }
 
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <crypto/common/bitstring.h>
+#include <td/utils/SharedSlice.h>
+#include <td/utils/Status.h>
+#include <td/utils/format.h>
+#include <td/utils/tl_parsers.h>
+#include <td/utils/tl_storers.h>
+#include <tl/TlObject.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "gen/tonlib_tl.h"
+
+namespace tjs
+{
+template <typename T>
+auto tl_clone_field(const T& value) -> T
+{
+    return value;
+}
+
+inline auto tl_clone_field(const td::SecureString& value) -> td::SecureString
+{
+    return value.copy();
+}
+
+template <typename T>
+auto tl_clone_field(const ton::tl_object_ptr<T>& value) -> ton::tl_object_ptr<T>
+{
+    if (value == nullptr) {
+        return nullptr;
+    }
+    return tl_clone(*value);
+}
+
+template <typename T>
+auto tl_clone_field(const std::vector<T>& value) -> std::vector<T>
+{
+    std::vector<T> result;
+    result.reserve(value.size());
+    for (const auto& item : value) {
+        result.emplace_back(tl_clone_field(item));
+    }
+    return result;
+}
+
+// Heap bytes owned by the field, its inline size is already counted in the parent object.
+// Overloads for non-TL types which own TL objects are declared next to these types
+template <typename T>
+auto tl_memory_size_field(const T&) -> size_t
+{
+    return 0;
+}
+
+inline auto tl_memory_size_field(const std::string& value) -> size_t
+{
+    return value.capacity();
+}
+
+inline auto tl_memory_size_field(const td::SecureString& value) -> size_t
+{
+    return value.size();
+}
+
+template <typename T>
+auto tl_memory_size_field(const ton::tl_object_ptr<T>& value) -> size_t
+{
+    if (value == nullptr) {
+        return 0;
+    }
+    return tl_memory_size(*value);
+}
+
+template <typename T>
+auto tl_memory_size_field(const td::Result<T>& value) -> size_t
+{
+    return value.is_ok() ? tl_memory_size_field(value.ok()) : 0;
+}
+
+template <typename T>
+auto tl_memory_size_field(const std::optional<T>& value) -> size_t
+{
+    return value.has_value() ? tl_memory_size_field(*value) : 0;
+}
+
+template <typename T>
+auto tl_memory_size_field(const std::vector<T>& value) -> size_t
+{
+    size_t size = value.capacity() * sizeof(T);
+    for (const auto& item : value) {
+        size += tl_memory_size_field(item);
+    }
+    return size;
+}
+
+// Bytes of a standalone value, such as a result which is waiting for conversion
+template <typename T>
+auto memory_size(const T& value) -> size_t
+{
+    return sizeof(T) + tl_memory_size_field(value);
+}
+
+// Boxed binary TL representation, which starts with the constructor id
+template <typename T>
+auto tl_serialize(const T& object) -> std::string
+{
+    td::TlStorerCalcLength calc;
+    calc.store_binary(object.get_id());
+    object.store(calc);
+
+    std::string result(calc.get_length(), '\0');
+    td::TlStorerUnsafe storer{reinterpret_cast<unsigned char*>(&result[0])};
+    storer.store_binary(object.get_id());
+    object.store(storer);
+    return result;
+}
+
+// `T` must be a boxed type, like `Object` or `Function`
+template <typename T>
+auto tl_deserialize(td::Slice data) -> td::Result<ton::tl_object_ptr<T>>
+{
+    td::TlParser parser{data};
+    auto object = T::fetch(parser);
+    parser.fetch_end();
+    TRY_STATUS(parser.get_status())
+    if (object == nullptr) {
+        return td::Status::Error("Empty object");
+    }
+    return std::move(object);
+}
+
+// Checks the type of the tonlib response
+template <typename T>
+auto expect_object(td::Result<ton::tl_object_ptr<ton::tonlib_api::Object>> result) -> td::Result<ton::tl_object_ptr<T>>
+{
+    TRY_RESULT(object, std::move(result))
+    if (object == nullptr || object->get_id() != T::ID) {
+        return td::Status::Error(PSLICE() << "Unexpected response type, expected " << td::format::as_hex(T::ID));
+    }
+    return ton::move_tl_object_as<T>(std::move(object));
+}
+
+// Shards intersect if the shorter prefix is a prefix of the longer one
+inline auto shards_intersect(int64_t left, int64_t right) -> bool
+{
+    const auto a = static_cast<uint64_t>(left);
+    const auto b = static_cast<uint64_t>(right);
+    const auto bit = std::max(a & (~a + 1), b & (~b + 1));
+    const auto mask = ~((bit << 1) - 1);
+    return ((a ^ b) & mask) == 0;
+}
+
+}  // namespace tjs
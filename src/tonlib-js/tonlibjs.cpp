@@ -12,11 +12,32 @@
 #include <td/utils/logging.h>
 #include <td/utils/port/thread_local.h>
 
-#include <future>
+#include <iterator>
+#include <limits>
 
+#include "abi_decoder.hpp"
+#include "batch.hpp"
+#include "account_watcher.hpp"
+#include "block_events.hpp"
+#include "block_scanner.hpp"
 #include "client.hpp"
 #include "gen/tonlib_napi.h"
+#include "js_executor.hpp"
+#include "key_batch.hpp"
+#include "log_handler.hpp"
+#include "memory_tracker.hpp"
+#include "message_submitter.hpp"
+#include "native_account_watcher.hpp"
+#include "native_handle.hpp"
+#include "native_iterator.hpp"
+#include "native_submission_ring.hpp"
+#include "sliced_conversion.hpp"
+#include "smc_pool.hpp"
 #include "tl_napi.hpp"
+#include "tl_utils.hpp"
+#include "transactions_stream.hpp"
+#include "tvm_stack.hpp"
+#include "worker_pool.hpp"
 
 namespace tjs
 {
@@ -27,6 +48,586 @@ static td::Result<tonlib_api::object_ptr<tonlib_api::Function>> to_request(const
     return func;
 }
 
+static auto get_size_option(const Napi::Object& object, const char* name, size_t& to) -> td::Status
+{
+    auto value = object.Get(name);
+    if (value.IsUndefined() || value.IsNull()) {
+        return td::Status::OK();
+    }
+    if (!value.IsNumber() || value.As<Napi::Number>().Int64Value() < 0) {
+        return td::Status::Error(PSLICE() << "Expected non-negative number for " << name);
+    }
+    to = static_cast<size_t>(value.As<Napi::Number>().Int64Value());
+    return td::Status::OK();
+}
+
+static auto get_bool_option(const Napi::Object& object, const char* name, bool& to) -> td::Status
+{
+    auto value = object.Get(name);
+    if (value.IsUndefined() || value.IsNull()) {
+        return td::Status::OK();
+    }
+    if (!value.IsBoolean()) {
+        return td::Status::Error(PSLICE() << "Expected boolean for " << name);
+    }
+    to = value.As<Napi::Boolean>();
+    return td::Status::OK();
+}
+
+static auto get_number_option(const Napi::Object& object, const char* name, double& to) -> td::Status
+{
+    auto value = object.Get(name);
+    if (value.IsUndefined() || value.IsNull()) {
+        return td::Status::OK();
+    }
+    if (!value.IsNumber()) {
+        return td::Status::Error(PSLICE() << "Expected number for " << name);
+    }
+    to = value.As<Napi::Number>().DoubleValue();
+    return td::Status::OK();
+}
+
+static auto get_string_option(const Napi::Object& object, const char* name, std::string& to) -> td::Status
+{
+    auto value = object.Get(name);
+    if (value.IsUndefined() || value.IsNull()) {
+        return td::Status::OK();
+    }
+    if (!value.IsString()) {
+        return td::Status::Error(PSLICE() << "Expected string for " << name);
+    }
+    to = value.As<Napi::String>().Utf8Value();
+    return td::Status::OK();
+}
+
+static auto to_client_options(const Napi::Value& value) -> td::Result<Client::Options>
+{
+    Client::Options options{};
+    if (value.IsUndefined() || value.IsNull()) {
+        return options;
+    }
+    if (!value.IsObject()) {
+        return td::Status::Error("Expected options object");
+    }
+    auto object = value.As<Napi::Object>();
+    TRY_STATUS(get_size_option(object, "maxInFlight", options.max_in_flight))
+    TRY_STATUS(get_size_option(object, "reservedInteractive", options.reserved_interactive))
+    TRY_STATUS(get_size_option(object, "maxQueueSize", options.max_queue_size))
+    TRY_STATUS(get_bool_option(object, "pinLiteServers", options.pin_lite_servers))
+    TRY_STATUS(get_bool_option(object, "hedge", options.hedge))
+    TRY_STATUS(get_number_option(object, "hedgeQuantile", options.hedge_quantile))
+    TRY_STATUS(get_number_option(object, "minHedgeDelayMs", options.min_hedge_delay_ms))
+    TRY_STATUS(get_size_option(object, "workerThreads", options.worker_threads))
+    TRY_STATUS(get_string_option(object, "stateFile", options.state_file))
+    TRY_STATUS(get_number_option(object, "stateSaveIntervalMs", options.state_save_interval_ms))
+    TRY_STATUS(get_string_option(object, "cacheDir", options.cache_dir))
+    TRY_STATUS(get_size_option(object, "cacheMaxSize", options.cache_max_size))
+    TRY_STATUS(get_number_option(object, "blockPollIntervalMs", options.block_poll_interval_ms))
+    TRY_STATUS(get_size_option(object, "smcPoolBudget", options.smc_pool_budget))
+    TRY_STATUS(get_number_option(object, "smcPoolMaxAgeMs", options.smc_pool_max_age_ms))
+    if (options.max_in_flight == 0) {
+        return td::Status::Error("maxInFlight must be greater than zero");
+    }
+    if (options.hedge_quantile <= 0.0 || options.hedge_quantile > 1.0) {
+        return td::Status::Error("hedgeQuantile must be in range (0, 1]");
+    }
+    if (options.state_save_interval_ms <= 0.0) {
+        return td::Status::Error("stateSaveIntervalMs must be greater than zero");
+    }
+    if (options.block_poll_interval_ms <= 0.0) {
+        return td::Status::Error("blockPollIntervalMs must be greater than zero");
+    }
+    if (options.smc_pool_max_age_ms <= 0.0) {
+        return td::Status::Error("smcPoolMaxAgeMs must be greater than zero");
+    }
+    return options;
+}
+
+static auto get_bytes_encoding_option(const Napi::Object& object, const char* name, BytesEncoding& to) -> td::Status
+{
+    auto value = object.Get(name);
+    if (value.IsUndefined() || value.IsNull()) {
+        return td::Status::OK();
+    }
+    if (!value.IsString()) {
+        return td::Status::Error(PSLICE() << "Expected string for " << name);
+    }
+    TRY_RESULT_ASSIGN(to, parse_bytes_encoding(value.As<Napi::String>().Utf8Value()))
+    return td::Status::OK();
+}
+
+static auto read_napi_options(const Napi::Object& object, NapiOptions& options) -> td::Status
+{
+    TRY_STATUS(get_bytes_encoding_option(object, "bytesEncoding", options.bytes_encoding))
+    TRY_STATUS(get_number_option(object, "timeSliceMs", options.time_slice_ms))
+    TRY_STATUS(get_size_option(object, "minSlicedLength", options.min_sliced_length))
+    if (options.time_slice_ms < 0.0) {
+        return td::Status::Error("timeSliceMs must be non-negative");
+    }
+    if (options.min_sliced_length == 0) {
+        return td::Status::Error("minSlicedLength must be greater than zero");
+    }
+    return td::Status::OK();
+}
+
+static auto to_napi_options(const Napi::Value& value) -> td::Result<NapiOptions>
+{
+    NapiOptions options{};
+    if (!value.IsObject()) {
+        return options;
+    }
+    TRY_STATUS(read_napi_options(value.As<Napi::Object>(), options))
+    return options;
+}
+
+struct SendOptions {
+    Priority priority{Priority::Interactive};
+    NapiOptions napi{};
+    // Resolve with `NativeHandle` instead of the converted object
+    bool handle{false};
+};
+
+static auto to_send_options(const Napi::Value& value, const NapiOptions& napi_defaults, Priority default_priority = Priority::Interactive)
+    -> td::Result<SendOptions>
+{
+    SendOptions options{default_priority, napi_defaults};
+    if (value.IsUndefined() || value.IsNull()) {
+        return options;
+    }
+    if (!value.IsObject()) {
+        return td::Status::Error("Expected send options object");
+    }
+    auto object = value.As<Napi::Object>();
+
+    TRY_STATUS(read_napi_options(object, options.napi))
+    TRY_STATUS(get_bool_option(object, "handle", options.handle))
+
+    if (auto fields = object.Get("fields"); !fields.IsUndefined() && !fields.IsNull()) {
+        TRY_RESULT_ASSIGN(options.napi.fields, NapiFields::parse(fields))
+    }
+
+    auto priority = object.Get("priority");
+    if (priority.IsUndefined() || priority.IsNull()) {
+        return options;
+    }
+    if (!priority.IsString()) {
+        return td::Status::Error("Expected priority string");
+    }
+    const auto name = priority.As<Napi::String>().Utf8Value();
+    if (name == "interactive") {
+        options.priority = Priority::Interactive;
+    }
+    else if (name == "bulk") {
+        options.priority = Priority::Bulk;
+    }
+    else {
+        return td::Status::Error(PSLICE() << "Unknown priority " << name);
+    }
+    return options;
+}
+
+static auto to_transactions_stream_options(const Napi::Value& value, const SendOptions& send_options)
+    -> td::Result<TransactionsStream::Options>
+{
+    TransactionsStream::Options options{};
+    options.priority = send_options.priority;
+    if (value.IsObject()) {
+        TRY_STATUS(get_size_option(value.As<Napi::Object>(), "prefetchPages", options.prefetch_pages))
+    }
+    if (options.prefetch_pages == 0) {
+        return td::Status::Error("prefetchPages must be greater than zero");
+    }
+    return options;
+}
+
+static auto to_block_scanner_options(const Napi::Value& value, const SendOptions& send_options)
+    -> td::Result<BlockScanner::Options>
+{
+    BlockScanner::Options options{};
+    options.priority = send_options.priority;
+    if (value.IsObject()) {
+        TRY_STATUS(get_size_option(value.As<Napi::Object>(), "concurrency", options.concurrency))
+    }
+    if (options.concurrency == 0) {
+        return td::Status::Error("concurrency must be greater than zero");
+    }
+    return options;
+}
+
+static auto to_account_watcher_options(const Napi::Value& value, const SendOptions& send_options) -> td::Result<AccountWatcher::Options>
+{
+    AccountWatcher::Options options{};
+    options.priority = send_options.priority;
+    if (value.IsObject()) {
+        TRY_STATUS(get_size_option(value.As<Napi::Object>(), "concurrency", options.concurrency))
+    }
+    if (options.concurrency == 0) {
+        return td::Status::Error("concurrency must be greater than zero");
+    }
+    return options;
+}
+
+static auto to_message_submitter_options(const Napi::Value& value, const SendOptions& send_options) -> td::Result<MessageSubmitter::Options>
+{
+    MessageSubmitter::Options options{};
+    options.priority = send_options.priority;
+    if (value.IsObject()) {
+        TRY_STATUS(get_size_option(value.As<Napi::Object>(), "concurrency", options.concurrency))
+    }
+    if (options.concurrency == 0) {
+        return td::Status::Error("concurrency must be greater than zero");
+    }
+    return options;
+}
+
+static auto to_submission_ring_options(const Napi::Value& value, const SendOptions& send_options) -> td::Result<SubmissionRing::Options>
+{
+    SubmissionRing::Options options{};
+    options.priority = send_options.priority;
+    if (value.IsObject()) {
+        auto object = value.As<Napi::Object>();
+        size_t slots = options.slot_count;
+        size_t slot_size = options.slot_size;
+        TRY_STATUS(get_size_option(object, "slots", slots))
+        TRY_STATUS(get_size_option(object, "slotSize", slot_size))
+        TRY_STATUS(get_number_option(object, "pollIntervalMs", options.poll_interval_ms))
+        TRY_STATUS(get_number_option(object, "stallTimeoutMs", options.stall_timeout_ms))
+        if (slots > std::numeric_limits<int32_t>::max() || slot_size > std::numeric_limits<int32_t>::max()) {
+            return td::Status::Error("Ring is too large");
+        }
+        options.slot_count = static_cast<uint32_t>(slots);
+        options.slot_size = static_cast<uint32_t>(slot_size);
+    }
+    // Zero disables idle polling, the ring is then scanned only when woken
+    if (options.poll_interval_ms < 0.0) {
+        return td::Status::Error("pollIntervalMs must not be negative");
+    }
+    if (options.stall_timeout_ms <= 0.0) {
+        return td::Status::Error("stallTimeoutMs must be greater than zero");
+    }
+    return options;
+}
+
+static auto to_batch_options(const Napi::Value& value, const SendOptions& send_options) -> td::Result<BatchOptions>
+{
+    BatchOptions options{};
+    options.priority = send_options.priority;
+    if (value.IsObject()) {
+        TRY_STATUS(get_size_option(value.As<Napi::Object>(), "concurrency", options.concurrency))
+    }
+    if (options.concurrency == 0) {
+        return td::Status::Error("concurrency must be greater than zero");
+    }
+    return options;
+}
+
+static auto to_get_method_stack(const Napi::Value& options) -> td::Result<std::vector<vm::StackEntry>>
+{
+    std::vector<tonlib_api::object_ptr<tonlib_api::tvm_StackEntry>> stack;
+    if (options.IsObject()) {
+        auto value = options.As<Napi::Object>().Get("stack");
+        if (!value.IsUndefined() && !value.IsNull()) {
+            TRY_STATUS_PREFIX(from_napi(value, stack), "Invalid stack: ")
+        }
+    }
+    TRY_RESULT_PREFIX(vm_stack, to_vm_stack(stack), "Invalid stack: ")
+    return std::move(vm_stack);
+}
+
+static auto to_run_local_requests(const Napi::Value& function, const Napi::Value& items) -> td::Result<std::vector<Client::Request>>
+{
+    tonlib_api::object_ptr<tonlib_api::ftabi_function> fn;
+    TRY_STATUS_PREFIX(from_napi(function, fn), "Invalid function: ")
+    if (fn == nullptr) {
+        return td::Status::Error("Function expected");
+    }
+    if (!items.IsArray()) {
+        return td::Status::Error("Expected array of calls");
+    }
+
+    auto array = items.As<Napi::Array>();
+    std::vector<Client::Request> requests;
+    requests.reserve(array.Length());
+    for (uint32_t i = 0; i < array.Length(); ++i) {
+        auto item = array.Get(i);
+        if (!item.IsObject()) {
+            return td::Status::Error(PSLICE() << "Expected call object at " << i);
+        }
+        auto object = item.As<Napi::Object>();
+
+        std::string address;
+        TRY_STATUS_PREFIX(from_napi(object.Get("address"), address), PSLICE() << "Invalid address at " << i << ": ")
+        tonlib_api::object_ptr<tonlib_api::ftabi_FunctionCall> call;
+        TRY_STATUS_PREFIX(from_napi(object.Get("call"), call), PSLICE() << "Invalid call at " << i << ": ")
+
+        // The function is converted once and copied natively for each call
+        requests.emplace_back(tonlib_api::make_object<tonlib_api::ftabi_runLocal>(
+            tonlib_api::make_object<tonlib_api::accountAddress>(std::move(address)), tl_clone(*fn), std::move(call)));
+    }
+    return std::move(requests);
+}
+
+template <typename T, typename F>
+static auto to_napi_settled(const Napi::Env& env, const std::vector<td::Result<T>>& results, F&& convert) -> Napi::Value
+{
+    auto array = Napi::Array::New(env, results.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        auto item = Napi::Object::New(env);
+        if (results[i].is_ok()) {
+            item.Set("status", Napi::String::New(env, "fulfilled"));
+            item.Set("value", convert(env, results[i].ok()));
+        }
+        else {
+            item.Set("status", Napi::String::New(env, "rejected"));
+            item.Set("reason", Napi::Error::New(env, results[i].error().to_string()).Value());
+        }
+        array.Set(i, item);
+    }
+    return array;
+}
+
+template <typename T>
+static auto to_napi_settled(const Napi::Env& env, const std::vector<td::Result<T>>& results) -> Napi::Value
+{
+    return to_napi_settled(env, results, [](const Napi::Env& env, const T& value) { return to_napi(env, value); });
+}
+
+static auto to_napi(const Napi::Env& env, const GeneratedKey& key) -> Napi::Value
+{
+    auto result = Napi::Object::New(env);
+    result.Set("publicKey", Napi::String::New(env, key.public_key));
+    result.Set("privateKey", to_napi(env, NapiBytes{key.private_key.as_slice()}));
+    return result;
+}
+
+static auto to_sign_requests(const Napi::Value& items) -> td::Result<std::vector<SignRequest>>
+{
+    if (!items.IsArray()) {
+        return td::Status::Error("Expected array of sign requests");
+    }
+
+    auto array = items.As<Napi::Array>();
+    std::vector<SignRequest> requests;
+    requests.reserve(array.Length());
+    for (uint32_t i = 0; i < array.Length(); ++i) {
+        auto item = array.Get(i);
+        if (!item.IsObject()) {
+            return td::Status::Error(PSLICE() << "Expected sign request object at " << i);
+        }
+        auto object = item.As<Napi::Object>();
+
+        SignRequest request;
+        TRY_STATUS_PREFIX(from_napi_bytes(object.Get("privateKey"), request.private_key), PSLICE() << "Invalid private key at " << i << ": ")
+        TRY_STATUS_PREFIX(from_napi_bytes(object.Get("data"), request.data), PSLICE() << "Invalid data at " << i << ": ")
+        requests.emplace_back(std::move(request));
+    }
+    return std::move(requests);
+}
+
+static auto to_execute_requests(const Napi::Value& items) -> td::Result<std::vector<Client::Request>>
+{
+    if (!items.IsArray()) {
+        return td::Status::Error("Expected array of requests");
+    }
+
+    auto array = items.As<Napi::Array>();
+    std::vector<Client::Request> requests;
+    requests.reserve(array.Length());
+    for (uint32_t i = 0; i < array.Length(); ++i) {
+        TRY_RESULT_PREFIX(request, to_request(array.Get(i)), PSLICE() << "Invalid request at " << i << ": ")
+        requests.emplace_back(std::move(request));
+    }
+    return std::move(requests);
+}
+
+static auto to_abi_messages(const Napi::Value& items) -> td::Result<std::vector<AbiMessage>>
+{
+    if (!items.IsArray()) {
+        return td::Status::Error("Expected array of messages");
+    }
+
+    auto array = items.As<Napi::Array>();
+    std::vector<AbiMessage> messages;
+    messages.reserve(array.Length());
+    for (uint32_t i = 0; i < array.Length(); ++i) {
+        auto item = array.Get(i);
+        if (!item.IsObject()) {
+            return td::Status::Error(PSLICE() << "Expected message object at " << i);
+        }
+        auto object = item.As<Napi::Object>();
+
+        AbiMessage message;
+        TRY_STATUS_PREFIX(from_napi_bytes(object.Get("body"), message.body), PSLICE() << "Invalid body at " << i << ": ")
+        TRY_STATUS_PREFIX(get_bool_option(object, "internal", message.internal), PSLICE() << "Invalid message at " << i << ": ")
+        TRY_STATUS_PREFIX(get_bool_option(object, "output", message.output), PSLICE() << "Invalid message at " << i << ": ")
+        messages.emplace_back(std::move(message));
+    }
+    return std::move(messages);
+}
+
+// Messages of all transactions are decoded as a single batch, `counts` splits the results back
+static auto to_transaction_messages(const Napi::Value& items, std::vector<size_t>& counts) -> td::Result<std::vector<AbiMessage>>
+{
+    if (!items.IsArray()) {
+        return td::Status::Error("Expected array of transactions");
+    }
+
+    auto array = items.As<Napi::Array>();
+    std::vector<AbiMessage> messages;
+    counts.reserve(array.Length());
+    for (uint32_t i = 0; i < array.Length(); ++i) {
+        tonlib_api::object_ptr<tonlib_api::raw_transaction> transaction;
+        TRY_STATUS_PREFIX(from_napi(array.Get(i), transaction), PSLICE() << "Invalid transaction at " << i << ": ")
+        if (transaction == nullptr) {
+            return td::Status::Error(PSLICE() << "Expected transaction at " << i);
+        }
+        auto transaction_items = transaction_messages(*transaction);
+        counts.emplace_back(transaction_items.size());
+        std::move(transaction_items.begin(), transaction_items.end(), std::back_inserter(messages));
+    }
+    return std::move(messages);
+}
+
+static auto to_napi(const Napi::Env& env, const AccountSnapshot::Account& account) -> Napi::Value
+{
+    auto result = Napi::Object::New(env);
+    result.Set("shard", to_napi(env, account.shard));
+    result.Set("state", to_napi(env, account.state));
+    return result;
+}
+
+static auto to_napi(const Napi::Env& env, const AccountSnapshot::Result& snapshot) -> Napi::Value
+{
+    auto result = Napi::Object::New(env);
+    result.Set("block", to_napi(env, snapshot.block));
+    result.Set("shards", to_napi(env, snapshot.shards));
+    result.Set("accounts", to_napi_settled(env, snapshot.accounts));
+    return result;
+}
+
+static auto to_napi(const Napi::Env& env, const DecodedMessage& message) -> Napi::Value
+{
+    auto result = Napi::Object::New(env);
+    result.Set("function", Napi::String::New(env, message.function));
+    result.Set("output", Napi::Boolean::New(env, message.output));
+    result.Set("values", to_napi(env, message.values));
+    return result;
+}
+
+static auto to_napi(const Napi::Env& env, const ScannedBlockTransactions& block) -> Napi::Value
+{
+    auto result = Napi::Object::New(env);
+    result.Set("id", to_napi(env, block.id));
+    result.Set("transactions", to_napi(env, block.transactions));
+    return result;
+}
+
+static auto to_napi(const Napi::Env& env, const ScannedBlock& block) -> Napi::Value
+{
+    auto shards = Napi::Array::New(env, block.shards.size());
+    for (size_t i = 0; i < block.shards.size(); ++i) {
+        shards.Set(i, to_napi(env, block.shards[i]));
+    }
+
+    auto result = to_napi(env, block.masterchain).As<Napi::Object>();
+    result.Set("shards", shards);
+    return result;
+}
+
+static auto to_napi(const Napi::Env& env, const SubmitResult& result) -> Napi::Value
+{
+    auto object = Napi::Object::New(env);
+    object.Set("index", Napi::Number::New(env, static_cast<double>(result.index)));
+    object.Set("hash", result.hash.has_value() ? to_napi(env, *result.hash) : env.Null());
+    // Failed duplicates keep the index of the sent message, so the failure can be traced back to it
+    if (result.duplicate_of.has_value()) {
+        object.Set("duplicateOf", Napi::Number::New(env, static_cast<double>(*result.duplicate_of)));
+    }
+    if (result.status.is_error()) {
+        object.Set("status", Napi::String::New(env, "failed"));
+        object.Set("error", Napi::String::New(env, result.status.message().str()));
+    }
+    else {
+        object.Set("status", Napi::String::New(env, result.duplicate_of.has_value() ? "duplicate" : "sent"));
+    }
+    return object;
+}
+
+template <typename T>
+static auto to_napi(const Napi::Env& env, const Tracked<T>& tracked) -> Napi::Value
+{
+    return to_napi(env, tracked.value);
+}
+
+// Keeps the result accounted from the moment it is produced until it is converted,
+// and the copied input until the result is produced
+template <typename T>
+static auto track_result(std::shared_ptr<MemoryTracker> memory, td::Promise<Tracked<T>>&& promise, MemoryReservation input = {}) -> td::Promise<T>
+{
+    return td::PromiseCreator::lambda([memory = std::move(memory), promise = std::move(promise), input = std::move(input)](td::Result<T> R) mutable {
+        input.reset();
+        if (R.is_error()) {
+            promise.set_error(R.move_as_error());
+            return;
+        }
+        auto value = R.move_as_ok();
+        const auto size = memory_size(value);
+        promise.set_value(Tracked<T>{std::move(value), MemoryReservation{std::move(memory), MemoryKind::Responses, size}});
+    });
+}
+
+template <typename T>
+static auto track_input(const std::shared_ptr<MemoryTracker>& memory, const T& input) -> MemoryReservation
+{
+    return MemoryReservation{memory, MemoryKind::Requests, memory_size(input)};
+}
+
+static auto to_napi(const Napi::Env& env, const Client::MemoryStats& stats) -> Napi::Value
+{
+    auto result = Napi::Object::New(env);
+    result.Set("requests", Napi::Number::New(env, static_cast<double>(stats.requests)));
+    result.Set("responses", Napi::Number::New(env, static_cast<double>(stats.responses)));
+    result.Set("handles", Napi::Number::New(env, static_cast<double>(stats.handles)));
+    result.Set("total", Napi::Number::New(env, static_cast<double>(stats.total)));
+    result.Set("peak", Napi::Number::New(env, static_cast<double>(stats.peak)));
+    return result;
+}
+
+static auto to_napi(const Napi::Env& env, const Client::SmcPoolStats& stats) -> Napi::Value
+{
+    auto result = Napi::Object::New(env);
+    result.Set("entries", Napi::Number::New(env, static_cast<double>(stats.entries)));
+    result.Set("bytes", Napi::Number::New(env, static_cast<double>(stats.bytes)));
+    result.Set("hits", Napi::Number::New(env, static_cast<double>(stats.hits)));
+    result.Set("misses", Napi::Number::New(env, static_cast<double>(stats.misses)));
+    result.Set("evictions", Napi::Number::New(env, static_cast<double>(stats.evictions)));
+    result.Set("invalidations", Napi::Number::New(env, static_cast<double>(stats.invalidations)));
+    return result;
+}
+
+static auto to_napi(const Napi::Env& env, const Client::LaneStats& stats) -> Napi::Value
+{
+    auto result = Napi::Object::New(env);
+    result.Set("queued", Napi::Number::New(env, static_cast<double>(stats.queued)));
+    result.Set("inFlight", Napi::Number::New(env, static_cast<double>(stats.in_flight)));
+    result.Set("started", Napi::Number::New(env, static_cast<double>(stats.started)));
+    result.Set("rejected", Napi::Number::New(env, static_cast<double>(stats.rejected)));
+    result.Set("avgWaitMs", Napi::Number::New(env, static_cast<double>(stats.avg_wait_us) / 1000.0));
+    result.Set("maxWaitMs", Napi::Number::New(env, static_cast<double>(stats.max_wait_us) / 1000.0));
+    return result;
+}
+
+static auto to_napi(const Napi::Env& env, const Client::BackendStats& stats) -> Napi::Value
+{
+    auto result = Napi::Object::New(env);
+    result.Set("ready", Napi::Boolean::New(env, stats.ready));
+    result.Set("outstanding", Napi::Number::New(env, static_cast<double>(stats.outstanding)));
+    result.Set("completed", Napi::Number::New(env, static_cast<double>(stats.completed)));
+    result.Set("errors", Napi::Number::New(env, static_cast<double>(stats.errors)));
+    result.Set("avgLatencyMs", Napi::Number::New(env, static_cast<double>(stats.avg_latency_us) / 1000.0));
+    return result;
+}
+
 struct ClientHandler final : public Napi::ObjectWrap<ClientHandler> {
 public:
     static Napi::FunctionReference* constructor;
@@ -40,7 +641,28 @@ public:
             class_name,
             {
                 InstanceMethod("send", &ClientHandler::send),
+                InstanceMethod("ready", &ClientHandler::ready),
+                InstanceMethod("iterateTransactions", &ClientHandler::iterate_transactions),
+                InstanceMethod("scanBlocks", &ClientHandler::scan_blocks),
+                InstanceMethod("subscribeBlocks", &ClientHandler::subscribe_blocks),
+                InstanceMethod("watchAccounts", &ClientHandler::watch_accounts),
+                InstanceMethod("submitMessages", &ClientHandler::submit_messages),
+                InstanceMethod("runGetMethod", &ClientHandler::run_get_method),
+                InstanceMethod("runGetMethodBatch", &ClientHandler::run_get_method_batch),
+                InstanceMethod("getAccountsSnapshot", &ClientHandler::get_accounts_snapshot),
+                InstanceMethod("runLocalBatch", &ClientHandler::run_local_batch),
+                InstanceMethod("generateKeyPairs", &ClientHandler::generate_key_pairs),
+                InstanceMethod("signBatch", &ClientHandler::sign_batch),
+                InstanceMethod("executeBatch", &ClientHandler::execute_batch),
+                InstanceMethod("decodeMessages", &ClientHandler::decode_messages),
+                InstanceMethod("decodeTransactions", &ClientHandler::decode_transactions),
+                InstanceMethod("attachSubmissionRing", &ClientHandler::attach_submission_ring),
+                InstanceMethod("stats", &ClientHandler::stats),
+                InstanceMethod("setLogVerbosity", &ClientHandler::set_log_verbosity),
+                InstanceAccessor<&ClientHandler::id>("id"),
                 StaticMethod("execute", &ClientHandler::execute),
+                StaticMethod("serialize", &ClientHandler::serialize),
+                StaticMethod("deserialize", &ClientHandler::deserialize),
             });
 
         constructor = new Napi::FunctionReference();
@@ -54,9 +676,42 @@ public:
     explicit ClientHandler(Napi::CallbackInfo& info)
         : Napi::ObjectWrap<ClientHandler>{info}
     {
+        // Options are validated before the client starts, an invalid one only throws and leaves the handler empty
+        auto r_options = to_client_options(info[0]);
+        if (r_options.is_error()) {
+            throw_invalid_options(info.Env(), r_options.error());
+            return;
+        }
+        auto r_napi_options = to_napi_options(info[0]);
+        if (r_napi_options.is_error()) {
+            throw_invalid_options(info.Env(), r_napi_options.error());
+            return;
+        }
+
+        client_ = std::make_shared<Client>(r_options.move_as_ok());
+        napi_options_ = r_napi_options.move_as_ok();
+        executor_ = JsExecutor::create(info.Env(), client_->memory());
+        block_events_ = std::make_shared<BlockEvents>(*client_, executor_, napi_options_);
+    }
+
+    ~ClientHandler() override
+    {
+        if (executor_ != nullptr) {
+            executor_->release_memory(Env());
+        }
     }
+    ClientHandler(const ClientHandler&) = delete;
+    ClientHandler& operator=(const ClientHandler&) = delete;
+    ClientHandler(ClientHandler&&) = delete;
+    ClientHandler& operator=(ClientHandler&&) = delete;
 
 private:
+    static void throw_invalid_options(Napi::Env env, const td::Status& error)
+    {
+        const auto message = PSLICE() << "Invalid client options: " << error;
+        Napi::TypeError::New(env, message.c_str()).ThrowAsJavaScriptException();
+    }
+
     static auto execute(const Napi::CallbackInfo& info) -> Napi::Value
     {
         auto env = info.Env();
@@ -67,6 +722,13 @@ private:
             return Napi::Value{};
         }
 
+        auto r_options = to_napi_options(info[1]);
+        if (r_options.is_error()) {
+            Napi::TypeError::New(env, r_options.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        NapiOptionsGuard guard{r_options.ok()};
         auto r_request = to_request(info[0].As<Napi::Object>());
         if (r_request.is_error()) {
             const auto message = PSLICE() << "Failed to parse request: " << r_request.error();
@@ -78,6 +740,61 @@ private:
         return to_napi(env, result);
     }
 
+    // Boxed TL representation of a request, as expected by submission rings
+    static auto serialize(const Napi::CallbackInfo& info) -> Napi::Value
+    {
+        auto env = info.Env();
+
+        auto r_options = to_napi_options(info[1]);
+        if (r_options.is_error()) {
+            Napi::TypeError::New(env, r_options.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        NapiOptionsGuard guard{r_options.ok()};
+        auto r_request = to_request(info[0]);
+        if (r_request.is_error()) {
+            const auto message = PSLICE() << "Failed to parse request: " << r_request.error();
+            Napi::Error::New(env, message.c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        if (r_request.ok() == nullptr) {
+            Napi::TypeError::New(env, "Request object expected").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        const auto data = tl_serialize(*r_request.ok());
+        return to_napi(env, NapiBytes{data});
+    }
+
+    static auto deserialize(const Napi::CallbackInfo& info) -> Napi::Value
+    {
+        auto env = info.Env();
+
+        auto r_options = to_napi_options(info[1]);
+        if (r_options.is_error()) {
+            Napi::TypeError::New(env, r_options.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        NapiOptionsGuard guard{r_options.ok()};
+        std::string data;
+        auto status = from_napi_bytes(info[0], data);
+        if (status.is_error()) {
+            const auto message = PSLICE() << "Invalid data: " << status;
+            Napi::TypeError::New(env, message.c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        auto r_object = tl_deserialize<tonlib_api::Object>(data);
+        if (r_object.is_error()) {
+            const auto message = PSLICE() << "Failed to parse object: " << r_object.error();
+            Napi::Error::New(env, message.c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        return to_napi(env, r_object.ok());
+    }
+
     auto send(const Napi::CallbackInfo& info) -> Napi::Value
     {
         auto env = info.Env();
@@ -88,6 +805,14 @@ private:
             return Napi::Value{};
         }
 
+        auto r_options = to_send_options(info[1], napi_options_);
+        if (r_options.is_error()) {
+            Napi::TypeError::New(env, r_options.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        auto options = r_options.move_as_ok();
+
+        NapiOptionsGuard guard{options.napi};
         auto r_request = to_request(info[0].As<Napi::Object>());
         if (r_request.is_error()) {
             const auto message = PSLICE() << "Failed to parse request: " << r_request.error();
@@ -95,48 +820,606 @@ private:
             return env.Null();
         }
 
-        struct RequestWorker final : Napi::AsyncWorker {
-            explicit RequestWorker(Napi::Env& env, std::future<td::Result<Client::Response>>&& fut)
-                : Napi::AsyncWorker{env}
-                , response_fut{std::move(fut)}
-                , deferred{Napi::Promise::Deferred::New(env)}
-            {
+        using TrackedResponse = Tracked<Client::Response>;
+        auto [js_promise, promise] = executor_->make_deferred<TrackedResponse>(
+            env, [napi_options = options.napi, handle = options.handle, memory = client_->memory()](
+                     Napi::Env env, Napi::Promise::Deferred&& deferred, TrackedResponse&& response) {
+                if (handle) {
+                    response.reservation.reset();
+                    deferred.Resolve(NativeHandle::create(env, std::move(response.value), memory));
+                    return;
+                }
+                if (napi_options.time_slice_ms > 0.0) {
+                    // Stays accounted until the last slice is converted
+                    SlicedConversion::start(env, napi_options, std::move(response), std::move(deferred));
+                    return;
+                }
+                NapiOptionsGuard guard{napi_options};
+                deferred.Resolve(to_napi(env, response.value));
+            });
+        // Responses are accounted from the moment they arrive until they are converted
+        client_->send(r_request.move_as_ok(), options.priority, track_result(client_->memory(), std::move(promise)));
+        executor_->report_memory(env);
+
+        return js_promise;
+    }
+
+    auto ready(const Napi::CallbackInfo& info) -> Napi::Value
+    {
+        auto [js_promise, promise] = executor_->make_promise<Client::Response>(
+            info.Env(), [napi_options = napi_options_](Napi::Env env, Client::Response&& response) {
+                NapiOptionsGuard guard{napi_options};
+                return to_napi(env, response);
+            });
+        client_->ready(std::move(promise));
+        return js_promise;
+    }
+
+    auto iterate_transactions(const Napi::CallbackInfo& info) -> Napi::Value
+    {
+        auto env = info.Env();
+
+        tonlib_api::object_ptr<tonlib_api::raw_getTransactions> request;
+        auto status = from_napi(info[0], request);
+        if (status.is_ok() && request == nullptr) {
+            status = td::Status::Error("Request object expected");
+        }
+        if (status.is_error()) {
+            const auto message = PSLICE() << "Failed to parse request: " << status;
+            Napi::TypeError::New(env, message.c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        auto r_send_options = to_send_options(info[1], napi_options_, Priority::Bulk);
+        if (r_send_options.is_error()) {
+            Napi::TypeError::New(env, r_send_options.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        auto send_options = r_send_options.move_as_ok();
+
+        auto r_options = to_transactions_stream_options(info[1], send_options);
+        if (r_options.is_error()) {
+            Napi::TypeError::New(env, r_options.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        using Item = tonlib_api::object_ptr<tonlib_api::raw_transaction>;
+        auto stream = StreamHandle<Item>::create<TransactionsStream>(client_, "TransactionsStream", std::move(request), r_options.move_as_ok());
+        auto source = std::make_unique<StreamIteratorSource<Item>>(std::move(stream), executor_, send_options.napi);
+        return NativeIterator::create(env, Value(), std::move(source));
+    }
+
+    auto scan_blocks(const Napi::CallbackInfo& info) -> Napi::Value
+    {
+        auto env = info.Env();
+
+        if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsNumber()) {
+            Napi::TypeError::New(env, "Seqno range expected").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        auto r_send_options = to_send_options(info[2], napi_options_, Priority::Bulk);
+        if (r_send_options.is_error()) {
+            Napi::TypeError::New(env, r_send_options.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        auto send_options = r_send_options.move_as_ok();
+
+        auto r_options = to_block_scanner_options(info[2], send_options);
+        if (r_options.is_error()) {
+            Napi::TypeError::New(env, r_options.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        auto options = r_options.move_as_ok();
+        options.from_seqno = info[0].As<Napi::Number>().Int32Value();
+        options.to_seqno = info[1].As<Napi::Number>().Int32Value();
+
+        auto stream = StreamHandle<ScannedBlock>::create<BlockScanner>(client_, "BlockScanner", options);
+        auto source = std::make_unique<StreamIteratorSource<ScannedBlock>>(std::move(stream), executor_, send_options.napi);
+        return NativeIterator::create(env, Value(), std::move(source));
+    }
+
+    auto subscribe_blocks(const Napi::CallbackInfo& info) -> Napi::Value
+    {
+        auto env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsFunction()) {
+            Napi::TypeError::New(env, "Listener function expected").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        bool with_shards = false;
+        if (info[1].IsObject()) {
+            auto status = get_bool_option(info[1].As<Napi::Object>(), "shards", with_shards);
+            if (status.is_error()) {
+                Napi::TypeError::New(env, status.message().c_str()).ThrowAsJavaScriptException();
+                return env.Null();
             }
+        }
 
-            void Execute() final
-            {
-                auto result_r = response_fut.get();
-                if (result_r.is_error()) {
-                    SetError(result_r.move_as_error().to_string());
-                }
-                else {
-                    response = result_r.move_as_ok();
+        return block_events_->add_listener(env, Value(), info[0].As<Napi::Function>(), with_shards);
+    }
+
+    auto watch_accounts(const Napi::CallbackInfo& info) -> Napi::Value
+    {
+        auto env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsFunction()) {
+            Napi::TypeError::New(env, "Listener function expected").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        auto r_send_options = to_send_options(info[1], napi_options_, Priority::Bulk);
+        if (r_send_options.is_error()) {
+            Napi::TypeError::New(env, r_send_options.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        auto send_options = r_send_options.move_as_ok();
+
+        auto r_options = to_account_watcher_options(info[1], send_options);
+        if (r_options.is_error()) {
+            Napi::TypeError::New(env, r_options.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        return NativeAccountWatcher::create(env, Value(), client_, executor_, info[0].As<Napi::Function>(), send_options.napi, r_options.ok());
+    }
+
+    auto submit_messages(const Napi::CallbackInfo& info) -> Napi::Value
+    {
+        auto env = info.Env();
+
+        auto r_send_options = to_send_options(info[1], napi_options_, Priority::Bulk);
+        if (r_send_options.is_error()) {
+            Napi::TypeError::New(env, r_send_options.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        auto send_options = r_send_options.move_as_ok();
+
+        std::vector<std::string> messages;
+        auto status = [&]() -> td::Status {
+            NapiOptionsGuard guard{send_options.napi};
+            return from_napi_vector_bytes(info[0], messages);
+        }();
+        if (status.is_error()) {
+            const auto message = PSLICE() << "Invalid messages: " << status;
+            Napi::TypeError::New(env, message.c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        auto r_options = to_message_submitter_options(info[1], send_options);
+        if (r_options.is_error()) {
+            Napi::TypeError::New(env, r_options.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        auto input = track_input(client_->memory(), messages);
+        auto stream = StreamHandle<SubmitResult>::create<MessageSubmitter>(client_, "MessageSubmitter", client_->workers(), std::move(messages),
+                                                                           r_options.move_as_ok());
+        auto source = std::make_unique<StreamIteratorSource<SubmitResult>>(std::move(stream), executor_, send_options.napi, std::move(input));
+        return NativeIterator::create(env, Value(), std::move(source));
+    }
+
+    auto run_get_method_batch(const Napi::CallbackInfo& info) -> Napi::Value
+    {
+        auto env = info.Env();
+
+        std::string method;
+        std::vector<std::string> addresses;
+        std::vector<vm::StackEntry> stack;
+        auto status = [&]() -> td::Status {
+            TRY_STATUS_PREFIX(from_napi(info[0], method), "Invalid method: ")
+            TRY_STATUS_PREFIX(from_napi(info[1], addresses), "Invalid addresses: ")
+            TRY_RESULT_ASSIGN(stack, to_get_method_stack(info[2]))
+            return td::Status::OK();
+        }();
+        if (status.is_error()) {
+            Napi::TypeError::New(env, status.message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        auto r_send_options = to_send_options(info[2], napi_options_, Priority::Bulk);
+        if (r_send_options.is_error()) {
+            Napi::TypeError::New(env, r_send_options.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        auto send_options = r_send_options.move_as_ok();
+
+        auto r_options = to_batch_options(info[2], send_options);
+        if (r_options.is_error()) {
+            Napi::TypeError::New(env, r_options.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        auto [js_promise, promise] = executor_->make_promise<Tracked<GetMethodBatch::Results>>(
+            env, [napi_options = send_options.napi](Napi::Env env, Tracked<GetMethodBatch::Results>&& results) {
+                NapiOptionsGuard guard{napi_options};
+                return to_napi_settled(env, results.value);
+            });
+
+        auto input = track_input(client_->memory(), addresses);
+        client_->run_in_context([&] {
+            td::actor::create_actor<GetMethodBatch>("GetMethodBatch", client_->smc_pool(), std::move(method), std::move(addresses), std::move(stack),
+                                                    r_options.move_as_ok(), track_result(client_->memory(), std::move(promise), std::move(input)))
+                .release();
+        });
+        return js_promise;
+    }
+
+    auto run_get_method(const Napi::CallbackInfo& info) -> Napi::Value
+    {
+        auto env = info.Env();
+
+        std::string address;
+        std::string method;
+        std::vector<vm::StackEntry> stack;
+        auto status = [&]() -> td::Status {
+            TRY_STATUS_PREFIX(from_napi(info[0], address), "Invalid address: ")
+            TRY_STATUS_PREFIX(from_napi(info[1], method), "Invalid method: ")
+            TRY_RESULT_ASSIGN(stack, to_get_method_stack(info[2]))
+            return td::Status::OK();
+        }();
+        if (status.is_error()) {
+            Napi::TypeError::New(env, status.message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        auto r_send_options = to_send_options(info[2], napi_options_);
+        if (r_send_options.is_error()) {
+            Napi::TypeError::New(env, r_send_options.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        auto send_options = r_send_options.move_as_ok();
+
+        auto [js_promise, promise] = executor_->make_promise<Tracked<SmcPool::Result>>(
+            env, [napi_options = send_options.napi](Napi::Env env, Tracked<SmcPool::Result>&& result) {
+                NapiOptionsGuard guard{napi_options};
+                return to_napi(env, result.value);
+            });
+
+        client_->run_in_context([&] {
+            td::actor::send_closure(client_->smc_pool(), &SmcPool::run_get_method, std::move(address), std::move(method),
+                                    std::make_shared<const std::vector<vm::StackEntry>>(std::move(stack)), send_options.priority,
+                                    track_result(client_->memory(), std::move(promise)));
+        });
+        return js_promise;
+    }
+
+    auto get_accounts_snapshot(const Napi::CallbackInfo& info) -> Napi::Value
+    {
+        auto env = info.Env();
+
+        std::vector<std::string> addresses;
+        tonlib_api::object_ptr<tonlib_api::ton_blockIdExt> block;
+        auto status = [&]() -> td::Status {
+            TRY_STATUS_PREFIX(from_napi(info[0], addresses), "Invalid addresses: ")
+            if (info[1].IsObject()) {
+                TRY_STATUS_PREFIX(from_napi(info[1].As<Napi::Object>().Get("block"), block), "Invalid block: ")
+                if (block != nullptr && block->workchain_ != -1) {
+                    return td::Status::Error("Snapshot block must be a masterchain block");
                 }
             }
+            return td::Status::OK();
+        }();
+        if (status.is_error()) {
+            Napi::TypeError::New(env, status.message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
 
-            void OnOK() final { deferred.Resolve(to_napi(Env(), response)); }
+        auto r_send_options = to_send_options(info[1], napi_options_, Priority::Bulk);
+        if (r_send_options.is_error()) {
+            Napi::TypeError::New(env, r_send_options.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        auto send_options = r_send_options.move_as_ok();
 
-            void OnError(const Napi::Error& error) final { deferred.Reject(error.Value()); }
+        auto r_options = to_batch_options(info[1], send_options);
+        if (r_options.is_error()) {
+            Napi::TypeError::New(env, r_options.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        auto [js_promise, promise] = executor_->make_promise<Tracked<AccountSnapshot::Result>>(
+            env, [napi_options = send_options.napi](Napi::Env env, Tracked<AccountSnapshot::Result>&& snapshot) {
+                NapiOptionsGuard guard{napi_options};
+                return to_napi(env, snapshot.value);
+            });
+
+        auto input = track_input(client_->memory(), addresses);
+        client_->run_in_context([&] {
+            td::actor::create_actor<AccountSnapshot>("AccountSnapshot", client_->dispatcher(), std::move(addresses), std::move(block),
+                                                     r_options.move_as_ok(), track_result(client_->memory(), std::move(promise), std::move(input)))
+                .release();
+        });
+        return js_promise;
+    }
+
+    auto run_local_batch(const Napi::CallbackInfo& info) -> Napi::Value
+    {
+        auto env = info.Env();
+
+        auto r_requests = to_run_local_requests(info[0], info[1]);
+        if (r_requests.is_error()) {
+            Napi::TypeError::New(env, r_requests.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        auto r_send_options = to_send_options(info[2], napi_options_, Priority::Bulk);
+        if (r_send_options.is_error()) {
+            Napi::TypeError::New(env, r_send_options.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        auto send_options = r_send_options.move_as_ok();
+
+        auto r_options = to_batch_options(info[2], send_options);
+        if (r_options.is_error()) {
+            Napi::TypeError::New(env, r_options.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        auto [js_promise, promise] = executor_->make_promise<Tracked<RequestBatch::Results>>(
+            env, [napi_options = send_options.napi](Napi::Env env, Tracked<RequestBatch::Results>&& results) {
+                NapiOptionsGuard guard{napi_options};
+                return to_napi_settled(env, results.value);
+            });
+
+        auto input = track_input(client_->memory(), r_requests.ok());
+        client_->run_in_context([&] {
+            td::actor::create_actor<RequestBatch>("RunLocalBatch", client_->dispatcher(), r_requests.move_as_ok(), r_options.move_as_ok(),
+                                                  track_result(client_->memory(), std::move(promise), std::move(input)))
+                .release();
+        });
+        return js_promise;
+    }
+
+    auto attach_submission_ring(const Napi::CallbackInfo& info) -> Napi::Value
+    {
+        auto env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsTypedArray() || info[0].As<Napi::TypedArray>().TypedArrayType() != napi_int32_array) {
+            Napi::TypeError::New(env, "Int32Array over a SharedArrayBuffer expected").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        auto r_send_options = to_send_options(info[1], napi_options_);
+        if (r_send_options.is_error()) {
+            Napi::TypeError::New(env, r_send_options.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        auto r_options = to_submission_ring_options(info[1], r_send_options.ok());
+        if (r_options.is_error()) {
+            Napi::TypeError::New(env, r_options.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        return NativeSubmissionRing::create(env, Value(), client_, executor_, info[0].As<Napi::Int32Array>(), r_options.ok());
+    }
+
+    auto generate_key_pairs(const Napi::CallbackInfo& info) -> Napi::Value
+    {
+        auto env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsNumber() || info[0].As<Napi::Number>().Int64Value() < 0) {
+            Napi::TypeError::New(env, "Key count expected").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        const auto count = static_cast<size_t>(info[0].As<Napi::Number>().Int64Value());
+
+        auto r_options = to_napi_options(info[1]);
+        if (r_options.is_error()) {
+            Napi::TypeError::New(env, r_options.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
 
-            std::future<td::Result<Client::Response>> response_fut;
-            Client::Response response;
-            Napi::Promise::Deferred deferred;
-        };
+        auto [js_promise, promise] = executor_->make_deferred<Tracked<GeneratedKeys>>(
+            env, [napi_options = r_options.move_as_ok()](Napi::Env env, Napi::Promise::Deferred&& deferred, Tracked<GeneratedKeys>&& tracked) {
+                NapiOptionsGuard guard{napi_options};
+                const auto& keys = tracked.value;
+                auto array = Napi::Array::New(env, keys.size());
+                for (size_t i = 0; i < keys.size(); ++i) {
+                    if (keys[i].is_error()) {
+                        deferred.Reject(Napi::Error::New(env, keys[i].error().to_string()).Value());
+                        return;
+                    }
+                    array.Set(i, to_napi(env, keys[i].ok()));
+                }
+                deferred.Resolve(array);
+            });
 
-        std::promise<td::Result<Client::Response>> client_promise;
-        auto* worker = new RequestWorker(env, client_promise.get_future());
-        auto js_promise = worker->deferred.Promise();
+        generate_keys(*client_->workers(), count, track_result(client_->memory(), std::move(promise)));
+        return js_promise;
+    }
 
-        auto P = td::PromiseCreator::lambda(
-            [client_promise = std::move(client_promise)](td::Result<Client::Response> R) mutable { client_promise.set_value(std::move(R)); });
-        client_.send(r_request.move_as_ok(), std::move(P));
+    auto sign_batch(const Napi::CallbackInfo& info) -> Napi::Value
+    {
+        auto env = info.Env();
 
-        worker->Queue();
+        auto r_options = to_napi_options(info[1]);
+        if (r_options.is_error()) {
+            Napi::TypeError::New(env, r_options.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        auto napi_options = r_options.move_as_ok();
+
+        auto r_requests = [&] {
+            NapiOptionsGuard guard{napi_options};
+            return to_sign_requests(info[0]);
+        }();
+        if (r_requests.is_error()) {
+            Napi::TypeError::New(env, r_requests.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
 
+        auto [js_promise, promise] =
+            executor_->make_promise<Tracked<Signatures>>(env, [napi_options](Napi::Env env, Tracked<Signatures>&& signatures) {
+                NapiOptionsGuard guard{napi_options};
+                return to_napi_settled(env, signatures.value, [](const Napi::Env& env, const td::SecureString& signature) {
+                    return to_napi(env, NapiBytes{signature.as_slice()});
+                });
+            });
+
+        auto input = track_input(client_->memory(), r_requests.ok());
+        tjs::sign_batch(*client_->workers(), r_requests.move_as_ok(), track_result(client_->memory(), std::move(promise), std::move(input)));
         return js_promise;
     }
 
-    Client client_;
+    auto execute_batch(const Napi::CallbackInfo& info) -> Napi::Value
+    {
+        auto env = info.Env();
+
+        auto r_options = to_napi_options(info[1]);
+        if (r_options.is_error()) {
+            Napi::TypeError::New(env, r_options.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        auto napi_options = r_options.move_as_ok();
+
+        auto r_requests = [&] {
+            NapiOptionsGuard guard{napi_options};
+            return to_execute_requests(info[0]);
+        }();
+        if (r_requests.is_error()) {
+            Napi::TypeError::New(env, r_requests.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        auto [js_promise, promise] =
+            executor_->make_promise<Tracked<ExecuteResults>>(env, [napi_options](Napi::Env env, Tracked<ExecuteResults>&& results) {
+                NapiOptionsGuard guard{napi_options};
+                return to_napi_settled(env, results.value);
+            });
+
+        auto input = track_input(client_->memory(), r_requests.ok());
+        tjs::execute_batch(*client_->workers(), r_requests.move_as_ok(), track_result(client_->memory(), std::move(promise), std::move(input)));
+        return js_promise;
+    }
+
+    auto decode_messages(const Napi::CallbackInfo& info) -> Napi::Value
+    {
+        auto env = info.Env();
+        if (info.Length() < 1 || !info[0].IsString()) {
+            Napi::TypeError::New(env, "ABI string expected").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        const auto abi = info[0].As<Napi::String>().Utf8Value();
+
+        auto r_options = to_napi_options(info[2]);
+        if (r_options.is_error()) {
+            Napi::TypeError::New(env, r_options.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        auto napi_options = r_options.move_as_ok();
+
+        auto r_messages = [&] {
+            NapiOptionsGuard guard{napi_options};
+            return to_abi_messages(info[1]);
+        }();
+        if (r_messages.is_error()) {
+            Napi::TypeError::New(env, r_messages.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        auto [js_promise, promise] =
+            executor_->make_promise<Tracked<DecodedMessages>>(env, [napi_options](Napi::Env env, Tracked<DecodedMessages>&& results) {
+                NapiOptionsGuard guard{napi_options};
+                return to_napi_settled(env, results.value);
+            });
+
+        auto input = track_input(client_->memory(), r_messages.ok());
+        tjs::decode_messages(client_->workers(), decoders_, abi, r_messages.move_as_ok(), track_result(client_->memory(), std::move(promise), std::move(input)));
+        return js_promise;
+    }
+
+    auto decode_transactions(const Napi::CallbackInfo& info) -> Napi::Value
+    {
+        auto env = info.Env();
+        if (info.Length() < 1 || !info[0].IsString()) {
+            Napi::TypeError::New(env, "ABI string expected").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        const auto abi = info[0].As<Napi::String>().Utf8Value();
+
+        auto r_options = to_napi_options(info[2]);
+        if (r_options.is_error()) {
+            Napi::TypeError::New(env, r_options.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        auto napi_options = r_options.move_as_ok();
+
+        std::vector<size_t> counts;
+        auto r_messages = [&] {
+            NapiOptionsGuard guard{napi_options};
+            return to_transaction_messages(info[1], counts);
+        }();
+        if (r_messages.is_error()) {
+            Napi::TypeError::New(env, r_messages.error().message().c_str()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        auto [js_promise, promise] = executor_->make_promise<Tracked<DecodedMessages>>(
+            env, [napi_options, counts = std::move(counts)](Napi::Env env, Tracked<DecodedMessages>&& tracked) {
+                NapiOptionsGuard guard{napi_options};
+                auto& results = tracked.value;
+                auto array = Napi::Array::New(env, counts.size());
+                auto it = std::make_move_iterator(results.begin());
+                for (size_t i = 0; i < counts.size(); ++i) {
+                    DecodedMessages transaction_results{it, it + static_cast<std::ptrdiff_t>(counts[i])};
+                    it += static_cast<std::ptrdiff_t>(counts[i]);
+                    array.Set(i, to_napi_settled(env, transaction_results));
+                }
+                return array;
+            });
+
+        auto input = track_input(client_->memory(), r_messages.ok());
+        tjs::decode_messages(client_->workers(), decoders_, abi, r_messages.move_as_ok(), track_result(client_->memory(), std::move(promise), std::move(input)));
+        return js_promise;
+    }
+
+    auto stats(const Napi::CallbackInfo& info) -> Napi::Value
+    {
+        auto env = info.Env();
+        const auto stats = client_->stats();
+
+        auto result = Napi::Object::New(env);
+        result.Set("interactive", to_napi(env, stats.lanes[static_cast<size_t>(Priority::Interactive)]));
+        result.Set("bulk", to_napi(env, stats.lanes[static_cast<size_t>(Priority::Bulk)]));
+
+        auto backends = Napi::Array::New(env, stats.backends.size());
+        for (size_t i = 0; i < stats.backends.size(); ++i) {
+            backends.Set(i, to_napi(env, stats.backends[i]));
+        }
+        result.Set("backends", backends);
+        result.Set("hedged", Napi::Number::New(env, static_cast<double>(stats.hedged)));
+        result.Set("hedgeWins", Napi::Number::New(env, static_cast<double>(stats.hedge_wins)));
+        result.Set("hedgeDelayMs", Napi::Number::New(env, static_cast<double>(stats.hedge_delay_us) / 1000.0));
+        result.Set("cacheHits", Napi::Number::New(env, static_cast<double>(stats.cache_hits)));
+        result.Set("cacheMisses", Napi::Number::New(env, static_cast<double>(stats.cache_misses)));
+        result.Set("memory", to_napi(env, stats.memory));
+        result.Set("smcPool", to_napi(env, stats.smc_pool));
+        return result;
+    }
+
+    auto set_log_verbosity(const Napi::CallbackInfo& info) -> Napi::Value
+    {
+        auto env = info.Env();
+        if (info.Length() < 1 || !info[0].IsNumber()) {
+            Napi::TypeError::New(env, "Verbosity level expected").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        client_->set_log_verbosity(info[0].As<Napi::Number>().Int32Value());
+        return env.Undefined();
+    }
+
+    auto id(const Napi::CallbackInfo& info) -> Napi::Value { return Napi::Number::New(info.Env(), client_->id()); }
+
+    // Shared with native wrappers, which may be finalized after the handler at environment teardown
+    std::shared_ptr<Client> client_;
+    NapiOptions napi_options_;
+    std::shared_ptr<JsExecutor> executor_;
+    std::shared_ptr<BlockEvents> block_events_;
+    // Shared with the decoding tasks on the worker threads
+    std::shared_ptr<AbiDecoderCache> decoders_{std::make_shared<AbiDecoderCache>()};
     std::mutex mutex_;  // for extra_
     std::unordered_map<std::int64_t, std::string> extra_;
     std::atomic<std::uint64_t> extra_id_{1};
@@ -147,6 +1430,11 @@ Napi::FunctionReference* ClientHandler::constructor = nullptr;
 Napi::Object init(Napi::Env env, Napi::Object exports)
 {
     ClientHandler::init(env, exports);
+    NativeIterator::init(env);
+    NativeAccountWatcher::init(env);
+    NativeSubmissionRing::init(env);
+    NativeHandle::init(env, exports);
+    init_log_handler(env, exports);
     init_napi(env, exports);
     return exports;
 }
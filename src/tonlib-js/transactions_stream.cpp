@@ -0,0 +1,73 @@
+#include "transactions_stream.hpp"
+
+#include "dispatcher.hpp"
+#include "tl_utils.hpp"
+
+namespace tjs
+{
+TransactionsStream::TransactionsStream(td::actor::ActorId<RequestDispatcher> dispatcher,
+                                       tonlib_api::object_ptr<tonlib_api::raw_getTransactions> request,
+                                       const Options& options)
+    : dispatcher_{std::move(dispatcher)}
+    , request_{std::move(request)}
+    , options_{options}
+{
+}
+
+void TransactionsStream::start_up()
+{
+    fetch();
+}
+
+void TransactionsStream::on_consumed()
+{
+    fetch();
+}
+
+void TransactionsStream::fetch()
+{
+    if (in_flight_ || last_page_ || is_done()) {
+        return;
+    }
+    // Continue while the consumer waits or the buffer is shorter than the prefetch window
+    if (waiting() == 0 && buffered() >= options_.prefetch_pages * page_size_) {
+        return;
+    }
+
+    in_flight_ = true;
+    auto request = tl_clone(*request_);
+    td::actor::send_closure(dispatcher_, &RequestDispatcher::request, std::move(request), options_.priority,
+                            td::PromiseCreator::lambda([self = actor_id(this)](td::Result<Client::Response> result) {
+                                td::actor::send_closure(self, &TransactionsStream::on_page, std::move(result));
+                            }));
+}
+
+void TransactionsStream::on_page(td::Result<Client::Response> result)
+{
+    in_flight_ = false;
+    auto r_page = expect_object<tonlib_api::raw_transactions>(std::move(result));
+    if (r_page.is_error()) {
+        fail(r_page.move_as_error());
+        return;
+    }
+    auto page = r_page.move_as_ok();
+
+    auto& next_id = page->previous_transaction_id_;
+    last_page_ = page->transactions_.empty() || next_id == nullptr || next_id->lt_ == 0;
+    if (!page->transactions_.empty()) {
+        page_size_ = page->transactions_.size();
+    }
+
+    for (auto& transaction : page->transactions_) {
+        push(std::move(transaction));
+    }
+
+    if (last_page_) {
+        finish();
+        return;
+    }
+    request_->from_transaction_id_ = std::move(next_id);
+    fetch();
+}
+
+}  // namespace tjs
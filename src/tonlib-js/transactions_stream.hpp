@@ -0,0 +1,38 @@
+#pragma once
+
+#include "stream.hpp"
+
+namespace tjs
+{
+// Walks account transactions from the newest to the oldest.
+//
+// Pages are requested one after another with `raw.getTransactions`, each
+// starting from the previous page's last transaction id, until
+// `prefetch_pages` pages are buffered ahead of the consumer.
+class TransactionsStream final : public StreamProducer<tonlib_api::object_ptr<tonlib_api::raw_transaction>> {
+public:
+    struct Options {
+        size_t prefetch_pages{2};
+        Priority priority{Priority::Bulk};
+    };
+
+    TransactionsStream(td::actor::ActorId<RequestDispatcher> dispatcher, tonlib_api::object_ptr<tonlib_api::raw_getTransactions> request,
+                       const Options& options);
+
+private:
+    void start_up() final;
+    void on_consumed() final;
+
+    void fetch();
+    void on_page(td::Result<Client::Response> result);
+
+    td::actor::ActorId<RequestDispatcher> dispatcher_;
+    tonlib_api::object_ptr<tonlib_api::raw_getTransactions> request_;
+    Options options_;
+
+    bool in_flight_{false};
+    bool last_page_{false};
+    size_t page_size_{1};
+};
+
+}  // namespace tjs
@@ -0,0 +1,143 @@
+#include "tvm_stack.hpp"
+
+#include <common/refint.h>
+#include <td/utils/overloaded.h>
+#include <vm/boc.h>
+#include <vm/cellslice.h>
+
+namespace tjs
+{
+namespace
+{
+auto deserialize_cell(td::Slice data) -> td::Result<td::Ref<vm::Cell>>
+{
+    TRY_RESULT(cell, vm::std_boc_deserialize(data))
+    if (cell.is_null()) {
+        return td::Status::Error("Empty cell");
+    }
+    return std::move(cell);
+}
+
+auto serialize_cell(const td::Ref<vm::Cell>& cell) -> td::Result<std::string>
+{
+    TRY_RESULT(data, vm::std_boc_serialize(cell))
+    return data.as_slice().str();
+}
+
+}  // namespace
+
+auto to_vm_stack_entry(const tonlib_api::tvm_StackEntry& entry) -> td::Result<vm::StackEntry>
+{
+    td::Result<vm::StackEntry> result = td::Status::Error("Unsupported stack entry");
+    tonlib_api::downcast_call(
+        const_cast<tonlib_api::tvm_StackEntry&>(entry),
+        td::overloaded(
+            [&](const tonlib_api::tvm_stackEntryNumber& number) {
+                if (number.number_ == nullptr) {
+                    result = td::Status::Error("Empty number");
+                    return;
+                }
+                auto value = td::dec_string_to_int256(number.number_->number_);
+                if (value.is_null()) {
+                    result = td::Status::Error("Invalid number");
+                    return;
+                }
+                result = vm::StackEntry{std::move(value)};
+            },
+            [&](const tonlib_api::tvm_stackEntryCell& cell) {
+                if (cell.cell_ == nullptr) {
+                    result = td::Status::Error("Empty cell");
+                    return;
+                }
+                auto r_cell = deserialize_cell(cell.cell_->bytes_);
+                if (r_cell.is_error()) {
+                    result = r_cell.move_as_error();
+                    return;
+                }
+                result = vm::StackEntry{r_cell.move_as_ok()};
+            },
+            [&](const tonlib_api::tvm_stackEntrySlice& slice) {
+                if (slice.slice_ == nullptr) {
+                    result = td::Status::Error("Empty slice");
+                    return;
+                }
+                auto r_cell = deserialize_cell(slice.slice_->bytes_);
+                if (r_cell.is_error()) {
+                    result = r_cell.move_as_error();
+                    return;
+                }
+                result = vm::StackEntry{vm::load_cell_slice_ref(r_cell.move_as_ok())};
+            },
+            [&](const tonlib_api::tvm_stackEntryTuple& tuple) {
+                if (tuple.tuple_ == nullptr) {
+                    result = td::Status::Error("Empty tuple");
+                    return;
+                }
+                auto r_elements = to_vm_stack(tuple.tuple_->elements_);
+                if (r_elements.is_error()) {
+                    result = r_elements.move_as_error();
+                    return;
+                }
+                result = vm::StackEntry{td::make_cnt_ref<std::vector<vm::StackEntry>>(r_elements.move_as_ok())};
+            },
+            [&](const auto&) {}));
+    return result;
+}
+
+auto to_vm_stack(const std::vector<tonlib_api::object_ptr<tonlib_api::tvm_StackEntry>>& stack) -> td::Result<std::vector<vm::StackEntry>>
+{
+    std::vector<vm::StackEntry> result;
+    result.reserve(stack.size());
+    for (const auto& entry : stack) {
+        if (entry == nullptr) {
+            return td::Status::Error("Empty stack entry");
+        }
+        TRY_RESULT(value, to_vm_stack_entry(*entry))
+        result.emplace_back(std::move(value));
+    }
+    return std::move(result);
+}
+
+auto from_vm_stack_entry(const vm::StackEntry& entry) -> td::Result<tonlib_api::object_ptr<tonlib_api::tvm_StackEntry>>
+{
+    switch (entry.type()) {
+        case vm::StackEntry::t_int:
+            return tonlib_api::make_object<tonlib_api::tvm_stackEntryNumber>(
+                tonlib_api::make_object<tonlib_api::tvm_numberDecimal>(td::dec_string(entry.as_int())));
+        case vm::StackEntry::t_cell: {
+            TRY_RESULT(data, serialize_cell(entry.as_cell()))
+            return tonlib_api::make_object<tonlib_api::tvm_stackEntryCell>(tonlib_api::make_object<tonlib_api::tvm_cell>(std::move(data)));
+        }
+        case vm::StackEntry::t_slice: {
+            vm::CellBuilder builder;
+            builder.append_cellslice(entry.as_slice());
+            TRY_RESULT(data, serialize_cell(builder.finalize()))
+            return tonlib_api::make_object<tonlib_api::tvm_stackEntrySlice>(tonlib_api::make_object<tonlib_api::tvm_slice>(std::move(data)));
+        }
+        case vm::StackEntry::t_tuple: {
+            const auto& tuple = *entry.as_tuple();
+            std::vector<tonlib_api::object_ptr<tonlib_api::tvm_StackEntry>> elements;
+            elements.reserve(tuple.size());
+            for (const auto& item : tuple) {
+                TRY_RESULT(element, from_vm_stack_entry(item))
+                elements.emplace_back(std::move(element));
+            }
+            return tonlib_api::make_object<tonlib_api::tvm_stackEntryTuple>(tonlib_api::make_object<tonlib_api::tvm_tuple>(std::move(elements)));
+        }
+        default:
+            return tonlib_api::make_object<tonlib_api::tvm_stackEntryUnsupported>();
+    }
+}
+
+auto from_vm_stack(const vm::Stack& stack) -> td::Result<std::vector<tonlib_api::object_ptr<tonlib_api::tvm_StackEntry>>>
+{
+    std::vector<tonlib_api::object_ptr<tonlib_api::tvm_StackEntry>> result;
+    result.reserve(stack.depth());
+    for (const auto& entry : stack.as_span()) {
+        TRY_RESULT(value, from_vm_stack_entry(entry))
+        result.emplace_back(std::move(value));
+    }
+    return std::move(result);
+}
+
+}  // namespace tjs
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <auto/tl/tonlib_api.h>
+#include <td/utils/Status.h>
+#include <vm/stack.hpp>
+
+#include <vector>
+
+namespace tjs
+{
+namespace tonlib_api = ton::tonlib_api;
+
+// Numbers, cells, slices and tuples are supported
+auto to_vm_stack_entry(const tonlib_api::tvm_StackEntry& entry) -> td::Result<vm::StackEntry>;
+auto to_vm_stack(const std::vector<tonlib_api::object_ptr<tonlib_api::tvm_StackEntry>>& stack) -> td::Result<std::vector<vm::StackEntry>>;
+
+auto from_vm_stack_entry(const vm::StackEntry& entry) -> td::Result<tonlib_api::object_ptr<tonlib_api::tvm_StackEntry>>;
+auto from_vm_stack(const vm::Stack& stack) -> td::Result<std::vector<tonlib_api::object_ptr<tonlib_api::tvm_StackEntry>>>;
+
+}  // namespace tjs
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace tjs
+{
+template <typename Signature>
+class UniqueFunction;
+
+// Move-only counterpart of `std::function`, for callbacks which own promises or other move-only state
+template <typename R, typename... Args>
+class UniqueFunction<R(Args...)> final {
+public:
+    UniqueFunction() = default;
+
+    template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, UniqueFunction>>>
+    UniqueFunction(F&& f)
+        : impl_{std::make_unique<Impl<std::decay_t<F>>>(std::forward<F>(f))}
+    {
+    }
+
+    explicit operator bool() const { return impl_ != nullptr; }
+
+    auto operator()(Args... args) -> R { return impl_->call(std::forward<Args>(args)...); }
+
+private:
+    struct ImplBase {
+        virtual ~ImplBase() = default;
+        virtual auto call(Args&&... args) -> R = 0;
+    };
+
+    template <typename F>
+    struct Impl final : ImplBase {
+        template <typename G>
+        explicit Impl(G&& f)
+            : f{std::forward<G>(f)}
+        {
+        }
+
+        auto call(Args&&... args) -> R final { return f(std::forward<Args>(args)...); }
+
+        F f;
+    };
+
+    std::unique_ptr<ImplBase> impl_;
+};
+
+}  // namespace tjs
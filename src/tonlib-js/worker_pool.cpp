@@ -0,0 +1,87 @@
+#include "worker_pool.hpp"
+
+namespace tjs
+{
+WorkerPool::WorkerPool(size_t threads, td::actor::Scheduler& scheduler)
+    : threads_{threads}
+    , scheduler_{scheduler}
+{
+}
+
+void WorkerPool::post(Task&& task)
+{
+    {
+        std::lock_guard<std::mutex> guard{mutex_};
+        if (!closed_) {
+            tasks_.emplace_back(std::move(task));
+            cv_.notify_one();
+            return;
+        }
+    }
+    task(false);
+}
+
+void WorkerPool::loop()
+{
+    while (true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock{mutex_};
+            cv_.wait(lock, [this] { return closed_ || !tasks_.empty(); });
+            if (closed_) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task(true);
+    }
+}
+
+auto WorkerPool::close() -> std::deque<Task>
+{
+    std::deque<Task> tasks;
+    {
+        std::lock_guard<std::mutex> guard{mutex_};
+        closed_ = true;
+        tasks.swap(tasks_);
+    }
+    cv_.notify_all();
+    return tasks;
+}
+
+WorkerThreads::WorkerThreads(size_t threads, td::actor::Scheduler& scheduler, std::shared_ptr<LogTag> log_tag)
+    : pool_{std::make_shared<WorkerPool>(threads, scheduler)}
+    , scheduler_{scheduler}
+{
+    threads_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        threads_.emplace_back([pool = pool_, log_tag] {
+            LogSink::set_thread_tag(log_tag);
+            pool->loop();
+        });
+    }
+}
+
+WorkerThreads::~WorkerThreads()
+{
+    auto tasks = pool_->close();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+
+    // Failed promises report errors to their actors, which requires the scheduler context
+    auto fail_all = [&] {
+        for (auto& task : tasks) {
+            task(false);
+        }
+    };
+    if (td::actor::SchedulerContext::get() != nullptr) {
+        fail_all();
+    }
+    else {
+        scheduler_.run_in_context_external(fail_all);
+    }
+}
+
+}  // namespace tjs
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <td/actor/actor.h>
+#include <td/utils/port/thread.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "log_sink.hpp"
+#include "unique_function.hpp"
+
+namespace tjs
+{
+// Queue of CPU-heavy work which shouldn't occupy the client's scheduler.
+//
+// Producers share the queue, while its threads are owned by the client (see
+// `WorkerThreads`) and are joined before the scheduler stops. Tasks posted
+// after that fail right away, so producers which outlive the client never
+// touch its scheduler.
+class WorkerPool final {
+public:
+    // Called with `true` on a worker thread, or with `false` within the scheduler
+    // context or on the posting thread if the pool is closed before the task runs
+    using Task = UniqueFunction<void(bool)>;
+
+    WorkerPool(size_t threads, td::actor::Scheduler& scheduler);
+
+    // Runs `f` on a worker thread and resolves `promise` within the scheduler context
+    template <typename T, typename F>
+    void run(F&& f, td::Promise<T>&& promise)
+    {
+        post(Task{[this, f = std::forward<F>(f), promise = std::move(promise)](bool run) mutable {
+            if (!run) {
+                promise.set_error(closed_error());
+                return;
+            }
+            auto result = invoke<T>(f);
+            scheduler_.run_in_context_external([&] { promise.set_result(std::move(result)); });
+        }});
+    }
+
+    // Calls `f(i)` for each index in `[0, count)` on worker threads, `chunk_size` indices per task.
+    // Resolves `promise` within the scheduler context with results in the index order
+    template <typename T, typename F>
+    void map(size_t count, size_t chunk_size, F&& f, td::Promise<std::vector<td::Result<T>>>&& promise)
+    {
+        if (count == 0) {
+            promise.set_value(std::vector<td::Result<T>>{});
+            return;
+        }
+        chunk_size = std::max<size_t>(chunk_size, 1);
+
+        struct State {
+            std::vector<td::Result<T>> results;
+            std::atomic<size_t> remaining;
+            td::Promise<std::vector<td::Result<T>>> promise;
+        };
+        const auto chunks = (count + chunk_size - 1) / chunk_size;
+        auto state = std::make_shared<State>();
+        state->results.resize(count);
+        state->remaining = chunks;
+        state->promise = std::move(promise);
+        auto shared_f = std::make_shared<std::decay_t<F>>(std::forward<F>(f));
+
+        for (size_t begin = 0; begin < count; begin += chunk_size) {
+            const auto end = std::min(begin + chunk_size, count);
+            // Chunks write disjoint ranges, the last one to finish hands the results over
+            post(Task{[this, state, shared_f, begin, end](bool run) {
+                for (size_t i = begin; i < end; ++i) {
+                    state->results[i] = run ? invoke<T>([&] { return (*shared_f)(i); }) : td::Result<T>{closed_error()};
+                }
+                if (state->remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+                    return;
+                }
+                if (run) {
+                    scheduler_.run_in_context_external([&] { state->promise.set_value(std::move(state->results)); });
+                }
+                else {
+                    state->promise.set_value(std::move(state->results));
+                }
+            }});
+        }
+    }
+
+    [[nodiscard]] auto size() const -> size_t { return threads_; }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+    WorkerPool(WorkerPool&&) = delete;
+    WorkerPool& operator=(WorkerPool&&) = delete;
+
+private:
+    friend class WorkerThreads;
+
+    static auto closed_error() -> td::Status { return td::Status::Error("Worker pool closed"); }
+
+    // Exceptions such as `std::bad_alloc` are turned into errors, so the promise is always resolved
+    template <typename T, typename F>
+    static auto invoke(F&& f) -> td::Result<T>
+    {
+        try {
+            return f();
+        }
+        catch (const std::exception& e) {
+            return td::Status::Error(PSLICE() << "Worker task failed: " << e.what());
+        }
+    }
+
+    void post(Task&& task);
+    void loop();
+    // Wakes the threads up and returns tasks which were not started
+    auto close() -> std::deque<Task>;
+
+    const size_t threads_;
+    td::actor::Scheduler& scheduler_;
+
+    std::mutex mutex_;  // for tasks_ and closed_
+    std::condition_variable cv_;
+    std::deque<Task> tasks_;
+    bool closed_{false};
+};
+
+// Threads of a worker pool, owned by the client
+class WorkerThreads final {
+public:
+    WorkerThreads(size_t threads, td::actor::Scheduler& scheduler, std::shared_ptr<LogTag> log_tag);
+
+    [[nodiscard]] auto pool() const -> const std::shared_ptr<WorkerPool>& { return pool_; }
+
+    // Joins the threads and fails tasks which were not started. The scheduler must still be running
+    ~WorkerThreads();
+    WorkerThreads(const WorkerThreads&) = delete;
+    WorkerThreads& operator=(const WorkerThreads&) = delete;
+    WorkerThreads(WorkerThreads&&) = delete;
+    WorkerThreads& operator=(WorkerThreads&&) = delete;
+
+private:
+    std::shared_ptr<WorkerPool> pool_;
+    td::actor::Scheduler& scheduler_;
+    std::vector<td::thread> threads_;
+};
+
+}  // namespace tjs
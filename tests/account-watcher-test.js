@@ -0,0 +1,69 @@
+const { createClient, assert, run } = require('./common');
+
+// Shard blocks are checked until a shard produces several blocks per masterchain block
+const MAX_MASTERCHAIN_BLOCKS = 200;
+const WATCHED_ACCOUNTS = [
+  '-1:3333333333333333333333333333333333333333333333333333333333333333',
+  '0:2e4492152c323667733ba555ad0165642ae7e5e346e6b1077ab6866ae39a3dc3'
+];
+
+function isSkipped(skipped, workchain, seqno) {
+  return (skipped || []).some(range => range.workchain === workchain && range.fromSeqno <= seqno && seqno <= range.toSeqno);
+}
+
+run('account-watcher', async () => {
+  const client = await createClient();
+
+  const lastSeqnos = new Map();
+  let masterchainBlocks = 0;
+  let multiBlockShards = 0;
+  let changes = 0;
+
+  const watcher = client.watchAccounts(event => {
+    changes += event.accounts.length;
+    for (const account of event.accounts) {
+      assert(WATCHED_ACCOUNTS.includes(account.address), `unexpected account ${account.address}`);
+    }
+  });
+  watcher.add(WATCHED_ACCOUNTS);
+
+  await new Promise((resolve, reject) => {
+    const unsubscribe = client.subscribeBlocks(event => {
+      try {
+        masterchainBlocks++;
+
+        const perShard = new Map();
+        for (const shard of event.shards) {
+          const key = `${shard.workchain}:${shard.shard}`;
+          perShard.set(key, (perShard.get(key) || 0) + 1);
+
+          // Split and merged shards start new keys, so only continued shards are checked
+          const last = lastSeqnos.get(key);
+          if (last != null) {
+            for (let seqno = last + 1; seqno < shard.seqno; ++seqno) {
+              assert(isSkipped(event.skipped, shard.workchain, seqno), `shard block ${key}:${seqno} is missing`);
+            }
+          }
+          lastSeqnos.set(key, shard.seqno);
+        }
+        for (const count of perShard.values()) {
+          if (count > 1) {
+            multiBlockShards++;
+          }
+        }
+
+        if (multiBlockShards > 0 || masterchainBlocks >= MAX_MASTERCHAIN_BLOCKS) {
+          unsubscribe();
+          resolve();
+        }
+      } catch (e) {
+        unsubscribe();
+        reject(e);
+      }
+    }, { shards: true });
+  });
+
+  watcher.close();
+  console.log({ masterchainBlocks, multiBlockShards, changes });
+  assert(multiBlockShards > 0, `no shard produced several blocks within ${masterchainBlocks} masterchain blocks`);
+});
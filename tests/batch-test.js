@@ -0,0 +1,142 @@
+const { tl, createClient, assert, assertEqual, run } = require('./common');
+const msigAbi = JSON.stringify(require('./msig.abi.json'));
+
+const WALLET = '0:2e4492152c323667733ba555ad0165642ae7e5e346e6b1077ab6866ae39a3dc3';
+const ELECTOR = '-1:3333333333333333333333333333333333333333333333333333333333333333';
+
+function crc16(data) {
+  let crc = 0;
+  for (const byte of data) {
+    crc ^= byte << 8;
+    for (let i = 0; i < 8; ++i) {
+      crc = crc & 0x8000 ? ((crc << 1) ^ 0x1021) & 0xffff : (crc << 1) & 0xffff;
+    }
+  }
+  return crc;
+}
+
+// Bounceable user-friendly form of a raw address
+function userFriendly(address) {
+  const [workchain, hex] = address.split(':');
+  const data = Buffer.concat([Buffer.from([0x11, Number(workchain) & 0xff]), Buffer.from(hex, 'hex')]);
+  const crc = crc16(data);
+  return Buffer.concat([data, Buffer.from([crc >> 8, crc & 0xff])]).toString('base64').replace(/\+/g, '-').replace(/\//g, '_');
+}
+
+run('get-method-batch', async () => {
+  const client = await createClient();
+  const results = await client.runGetMethodBatch('active_election_id', [ELECTOR, ELECTOR, 'invalid'], { concurrency: 2 });
+  assert(results.length === 3, 'missing results');
+  for (const result of results.slice(0, 2)) {
+    assert(result.status === 'fulfilled' && result.value.exitCode === 0, `get-method failed: ${result.reason}`);
+  }
+  assertEqual(results[0].value, results[1].value, 'results of the same account differ');
+  assert(results[2].status === 'rejected', 'invalid address was accepted');
+});
+
+run('run-local-batch', async () => {
+  const client = await createClient();
+  const fn = await client.send(new tl.FtabiGetFunction({ abi: msigAbi, name: 'getCustodians' }), { handle: true });
+  const call = new tl.FtabiFunctionCallJson({ value: JSON.stringify({}) });
+
+  const results = await client.runLocalBatch(fn, [{ address: WALLET, call }, { address: WALLET, call }]);
+  assert(results.length === 2 && results.every(result => result.status === 'fulfilled'), 'runLocal failed');
+  assertEqual(results[0].value, results[1].value, 'results of the same call differ');
+});
+
+run('keys-and-signatures', async () => {
+  const client = await createClient();
+  const keys = await client.generateKeyPairs(8);
+  assert(keys.length === 8 && new Set(keys.map(key => key.publicKey)).size === 8, 'keys are not unique');
+  assert(keys.every(key => key.privateKey instanceof ArrayBuffer && key.privateKey.byteLength === 32), 'unexpected private key');
+
+  const data = Buffer.from('message to sign');
+  const signatures = await client.signBatch([...keys.map(key => ({ privateKey: key.privateKey, data })), { privateKey: new ArrayBuffer(3), data }]);
+  assert(signatures.slice(0, 8).every(result => result.status === 'fulfilled' && result.value.byteLength === 64), 'signing failed');
+  assert(signatures[8].status === 'rejected', 'invalid key was accepted');
+
+  // Static requests run off the event loop and keep their order
+  const secret = Buffer.from('secret');
+  const inputs = [...Array(16).keys()].map(i => Buffer.alloc(32 * (i + 1), i));
+  const executed = await client.executeBatch(inputs.map(input => new tl.Encrypt({ decryptedData: input, secret })));
+  assert(executed.every(result => result.status === 'fulfilled'), 'static request failed');
+  for (let i = 1; i < executed.length; ++i) {
+    assert(executed[i].value.bytes.byteLength > executed[i - 1].value.bytes.byteLength, 'results are out of order');
+  }
+});
+
+run('abi-decoding', async () => {
+  const client = await createClient();
+  const state = await client.send(new tl.RawGetAccountState({ accountAddress: new tl.AccountAddress({ accountAddress: WALLET }) }));
+  const { transactions } = await client.send(new tl.RawGetTransactions({
+    accountAddress: new tl.AccountAddress({ accountAddress: WALLET }),
+    fromTransactionId: state.lastTransactionId
+  }));
+  assert(transactions.length > 0, 'wallet has no transactions');
+
+  const decoded = await client.decodeTransactions(msigAbi, transactions);
+  assert(decoded.length === transactions.length, 'missing transactions');
+  const messages = [].concat(...decoded);
+  for (const result of messages) {
+    if (result.status === 'fulfilled') {
+      assert(typeof result.value.function === 'string' && typeof result.value.output === 'boolean', 'malformed decoded message');
+    } else {
+      assert(result.reason instanceof Error, 'malformed decoding error');
+    }
+  }
+
+  // Bodies which no function accepts are rejected every time
+  const garbage = Buffer.from('deadbeef', 'hex');
+  for (let i = 0; i < 2; ++i) {
+    const [result] = await client.decodeMessages(msigAbi, [{ body: garbage, internal: true }]);
+    assert(result.status === 'rejected', 'garbage body was decoded');
+  }
+
+  // ABIs are parsed off the event loop, so invalid ones reject the promise
+  let rejected = false;
+  await client.decodeMessages('{"functions": []}', [{ body: garbage, internal: true }]).catch(() => {
+    rejected = true;
+  });
+  assert(rejected, 'ABI without functions was accepted');
+});
+
+run('accounts-snapshot', async () => {
+  const client = await createClient();
+  const addresses = [WALLET, userFriendly(WALLET), ELECTOR, 'invalid'];
+  const snapshot = await client.getAccountsSnapshot(addresses);
+
+  assert(snapshot.block.workchain === -1 && snapshot.shards.length > 0, 'snapshot block is missing');
+  assert(snapshot.accounts.length === addresses.length, 'missing accounts');
+  assert(snapshot.accounts.slice(0, 3).every(account => account.status === 'fulfilled'), 'account state failed');
+  assert(snapshot.accounts[3].status === 'rejected', 'invalid address was accepted');
+  // Both forms of one address are the same account
+  assertEqual(snapshot.accounts[1].value, snapshot.accounts[0].value, 'states of the same account differ');
+  assert(snapshot.accounts[0].value.shard.workchain === 0 && snapshot.accounts[2].value.shard.workchain === -1, 'unexpected shards');
+
+  // The same block gives the same states
+  const repeated = await client.getAccountsSnapshot([WALLET], { block: snapshot.block });
+  assertEqual(repeated.accounts[0].value.state, snapshot.accounts[0].value.state, 'states at the same block differ');
+});
+
+run('smc-pool', async () => {
+  const unpooled = await createClient();
+  await unpooled.runGetMethod(ELECTOR, 'active_election_id');
+  await unpooled.runGetMethod(ELECTOR, 'active_election_id');
+  assert(unpooled.stats().smcPool.entries === 0 && unpooled.stats().smcPool.hits === 0, 'states are pooled by default');
+
+  // The elector has a tick-tock transaction in every masterchain block, so its state may also be invalidated in between
+  const client = await createClient({ smcPoolBudget: 16 << 20, smcPoolMaxAgeMs: 500 });
+  const first = await client.runGetMethod(ELECTOR, 'active_election_id');
+  const second = await client.runGetMethod(ELECTOR, 'active_election_id');
+  assertEqual(second, first, 'pooled state gives a different result');
+  let stats = client.stats().smcPool;
+  assert(stats.hits + stats.misses === 2 && (stats.hits === 1 || stats.invalidations > 0), `unexpected pool stats ${JSON.stringify(stats)}`);
+  assert(stats.entries <= 1 && (stats.entries === 0) === (stats.bytes === 0), 'unexpected pool size');
+
+  // Expired states are loaded again
+  const misses = stats.misses;
+  await new Promise(resolve => setTimeout(resolve, 600));
+  await client.runGetMethod(ELECTOR, 'active_election_id');
+  stats = client.stats().smcPool;
+  assert(stats.misses === misses + 1, `expired state was used ${JSON.stringify(stats)}`);
+});
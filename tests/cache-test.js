@@ -0,0 +1,61 @@
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const { tl, createClient, assert, assertEqual, run } = require('./common');
+
+function countEntries(directory) {
+  if (!fs.existsSync(directory)) {
+    return 0;
+  }
+  let count = 0;
+  for (const entry of fs.readdirSync(directory, { withFileTypes: true })) {
+    count += entry.isDirectory() ? countEntries(path.join(directory, entry.name)) : 1;
+  }
+  return count;
+}
+
+run('immutable-cache', async () => {
+  const cacheDir = fs.mkdtempSync(path.join(os.tmpdir(), 'tonlib-cache-'));
+  try {
+    const client = await createClient({ cacheDir, bytesEncoding: 'hex' });
+    const info = await client.send(new tl.LiteServerGetMasterchainInfo());
+
+    // Shards of a block with known hashes never change, so the second request is served from disk
+    const shards = await client.send(new tl.BlocksGetShards({ id: info.last }));
+    assert(countEntries(cacheDir) === 1, 'entry was not stored');
+    const cached = await client.send(new tl.BlocksGetShards({ id: info.last }));
+    assertEqual(cached, shards, 'cached response differs');
+    let stats = client.stats();
+    assert(stats.cacheMisses === 1 && stats.cacheHits === 1, `unexpected cache stats ${JSON.stringify(stats)}`);
+
+    // Headers are cached too, they are requested for each shard block by block walks
+    const header = await client.send(new tl.BlocksGetBlockHeader({ id: info.last }));
+    assertEqual(await client.send(new tl.BlocksGetBlockHeader({ id: info.last })), header, 'cached header differs');
+    stats = client.stats();
+    assert(stats.cacheMisses === 2 && stats.cacheHits === 2, `header was not cached ${JSON.stringify(stats)}`);
+
+    // Requests without full block ids are not cached
+    await client.send(new tl.LiteServerGetMasterchainInfo());
+    stats = client.stats();
+    assert(stats.cacheMisses === 2 && stats.cacheHits === 2, 'masterchain info was cached');
+
+    // Another client reads entries written by the first one
+    const other = await createClient({ cacheDir, bytesEncoding: 'hex' });
+    assertEqual(await other.send(new tl.BlocksGetShards({ id: info.last })), shards, 'shared entry differs');
+    assert(other.stats().cacheHits === 1, 'shared entry was not used');
+
+    // Limits below a single entry remove everything right after it is written
+    const limited = await createClient({ cacheDir, cacheMaxSize: 1, bytesEncoding: 'hex' });
+    const transactions = await limited.send(new tl.BlocksGetTransactions({
+      id: info.last,
+      mode: 7,
+      count: 16,
+      after: new tl.BlocksAccountTransactionId({ account: '00'.repeat(32), lt: '0' })
+    }));
+    assert(transactions.id.seqno === info.last.seqno, 'unexpected transactions');
+    assert(countEntries(cacheDir) === 0, 'cache directory was not trimmed');
+    assert(limited.stats().cacheMisses === 1, 'trimmed entry was used');
+  } finally {
+    fs.rmSync ? fs.rmSync(cacheDir, { recursive: true, force: true }) : fs.rmdirSync(cacheDir, { recursive: true });
+  }
+});
@@ -0,0 +1,98 @@
+const tl = require('..');
+
+// Mainnet lite server used by `createClient`, so every script which creates a client needs
+// access to the mainnet
+const CONFIG = `{
+  "liteservers": [
+    {
+      "ip": 916349379,
+      "port": 3031,
+      "id": {
+        "@type": "pub.ed25519",
+        "key": "uNRRL+6enQjuiZ/s6Z+vO7yxUUR7uxdfzIy+RxkECrc="
+      }
+    }
+  ],
+  "validator": {
+     "@type": "validator.config.global",
+     "zero_state": {
+        "workchain": -1,
+        "shard": -9223372036854775808,
+        "seqno": 0,
+        "root_hash": "WP/KGheNr/cF3lQhblQzyb0ufYUAcNM004mXhHq56EU=",
+        "file_hash": "0nC4eylStbp9qnCq8KjDYb789NjS25L5ZA1UQwcIOOQ="
+     }
+  }
+}`;
+
+async function createClient(options, config = CONFIG) {
+  const client = new tl.TonlibClient(options);
+  await client.send(new tl.Init({
+    options: new tl.Options({
+      config: new tl.Config({
+        config,
+        blockchainName: 'mainnet',
+        useCallbacksForNetwork: false,
+        ignoreCache: true
+      }),
+      keystoreType: new tl.KeyStoreTypeInMemory()
+    })
+  }));
+  return client;
+}
+
+function assert(condition, message) {
+  if (!condition) {
+    throw new Error(`Assertion failed: ${message}`);
+  }
+}
+
+// Converts TL objects to plain values, so responses can be compared structurally
+function plain(value) {
+  if (value instanceof ArrayBuffer) {
+    return Buffer.from(value).toString('hex');
+  }
+  if (Array.isArray(value)) {
+    return value.map(plain);
+  }
+  if (value != null && typeof value === 'object') {
+    const props = value._props !== undefined ? value._props : value;
+    const result = {};
+    for (const key of Object.keys(props)) {
+      result[key] = plain(props[key]);
+    }
+    return result;
+  }
+  return value;
+}
+
+function assertEqual(actual, expected, message) {
+  const a = JSON.stringify(plain(actual));
+  const e = JSON.stringify(plain(expected));
+  assert(a === e, `${message}: ${a} !== ${e}`);
+}
+
+function assertThrows(f, pattern, message) {
+  try {
+    f();
+  } catch (e) {
+    assert(pattern.test(e.message), `${message}: unexpected error ${e.message}`);
+    return;
+  }
+  assert(false, `${message}: no error`);
+}
+
+// Runs the test body and sets the exit code, so scripts can be chained
+function run(name, body) {
+  (async () => {
+    try {
+      await body();
+      console.log(`${name}: ok`);
+    } catch (e) {
+      console.error(`${name}: failed`, e);
+      process.exitCode = 1;
+    }
+  })();
+}
+
+module.exports = { tl, CONFIG, createClient, plain, assert, assertEqual, assertThrows, run };
@@ -0,0 +1,157 @@
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const { Worker } = require('worker_threads');
+const { tl, CONFIG, createClient, assert, assertEqual, run } = require('./common');
+
+function sleep(ms) {
+  return new Promise(resolve => setTimeout(resolve, ms));
+}
+
+async function waitFor(condition, timeoutMs, message) {
+  const deadline = Date.now() + timeoutMs;
+  while (!condition()) {
+    assert(Date.now() < deadline, message);
+    await sleep(50);
+  }
+}
+
+run('admission-control', async () => {
+  // A single bulk request runs at a time and two more wait, the rest are rejected right away
+  const client = await createClient({ maxInFlight: 1, maxQueueSize: 2 });
+  const results = await Promise.allSettled([...Array(10).keys()].map(() => client.send(new tl.LiteServerGetMasterchainInfo(), { priority: 'bulk' })));
+
+  const rejected = results.filter(result => result.status === 'rejected');
+  assert(results.filter(result => result.status === 'fulfilled').length === 3, 'unexpected number of started requests');
+  assert(rejected.length === 7 && rejected.every(result => /Request queue is full/.test(result.reason.message)), 'unexpected rejections');
+
+  const stats = client.stats();
+  assert(stats.bulk.rejected === 7 && stats.bulk.started === 3, `unexpected lane stats ${JSON.stringify(stats.bulk)}`);
+  assert(stats.bulk.queued === 0 && stats.bulk.inFlight === 0, 'lane is not drained');
+  assert(stats.interactive.started >= 1, 'init was not counted as interactive');
+});
+
+run('pinned-backends', async () => {
+  const client = await createClient({ pinLiteServers: true, hedge: true, minHedgeDelayMs: 1 });
+  for (let i = 0; i < 20; ++i) {
+    await client.send(new tl.LiteServerGetMasterchainInfo());
+  }
+
+  // The test config has a single lite server, so there is nothing to hedge to
+  const stats = client.stats();
+  assert(stats.backends.length === 1 && stats.backends[0].ready, `unexpected backends ${JSON.stringify(stats.backends)}`);
+  assert(stats.backends[0].completed >= 20 && stats.backends[0].outstanding === 0, 'requests were not accounted');
+  assert(stats.hedged === 0, 'request was hedged without a second backend');
+});
+
+run('pinned-requests', async () => {
+  // The same lite server twice gives two backends, so read-only requests are spread and hedged
+  const config = JSON.parse(CONFIG);
+  config.liteservers.push(config.liteservers[0]);
+  const client = await createClient({ pinLiteServers: true, hedge: true, minHedgeDelayMs: 1 }, JSON.stringify(config));
+  await client.ready();
+  const info = await client.send(new tl.LiteServerGetMasterchainInfo());
+  for (let i = 0; i < 20; ++i) {
+    await client.send(new tl.LiteServerGetMasterchainInfo());
+  }
+
+  // Requests pinned to a block are answered, whichever backend serves them
+  const elector = new tl.AccountAddress({ accountAddress: '-1:' + '3'.repeat(64) });
+  const results = await Promise.all([...Array(8).keys()].map(i => i % 2 === 0
+    ? client.send(new tl.BlocksGetShards({ id: info.last }))
+    : client.send(new tl.WithBlock({ id: info.last, function: new tl.RawGetAccountState({ accountAddress: elector }) }))));
+  assert(results.every(result => result != null), 'pinned request failed');
+  const stats = client.stats();
+  assert(stats.backends.length === 2 && stats.backends.every(backend => backend.outstanding === 0), `unexpected backends ${JSON.stringify(stats.backends)}`);
+});
+
+run('log-handler', async () => {
+  const records = [];
+  tl.setLogHandler(batch => records.push(...batch));
+  try {
+    const client = await createClient();
+    client.setLogVerbosity(5);
+    await client.send(new tl.LiteServerGetMasterchainInfo());
+    await waitFor(() => records.some(record => record.clientId === client.id), 5000, 'no records of the client');
+
+    const record = records.find(record => record.clientId === client.id);
+    assert(typeof record.message === 'string' && typeof record.level === 'number' && record.time > 0, 'malformed record');
+    assert(tl.getLogStats().delivered >= records.length, 'delivered records are not counted');
+
+    // Teardown of another environment which loaded the addon keeps the handler of this one
+    await new Promise((resolve, reject) => {
+      const worker = new Worker(`require(${JSON.stringify(path.join(__dirname, '..', 'index.js'))})`, { eval: true });
+      worker.once('exit', resolve);
+      worker.once('error', reject);
+    });
+    const delivered = records.length;
+    await client.send(new tl.LiteServerGetMasterchainInfo());
+    await waitFor(() => records.length > delivered, 5000, 'handler was released by another environment');
+  } finally {
+    tl.setLogHandler(null);
+  }
+});
+
+run('sliced-conversion', async () => {
+  const client = await createClient({ bytesEncoding: 'hex' });
+  const info = await client.send(new tl.LiteServerGetMasterchainInfo());
+  const request = () => new tl.BlocksGetTransactions({
+    id: info.last,
+    mode: 7,
+    count: 256,
+    after: new tl.BlocksAccountTransactionId({ account: '00'.repeat(32), lt: '0' })
+  });
+
+  const whole = await client.send(request());
+  const sliced = await client.send(request(), { timeSliceMs: 0.001, minSlicedLength: 1 });
+  assertEqual(sliced, whole, 'sliced conversion differs');
+});
+
+run('sync-state', async () => {
+  const stateFile = path.join(fs.mkdtempSync(path.join(os.tmpdir(), 'tonlib-state-')), 'state.json');
+  try {
+    const client = await createClient({ stateFile, stateSaveIntervalMs: 100 });
+    const synced = await client.ready();
+    await waitFor(() => fs.existsSync(stateFile), 5000, 'state was not saved');
+
+    // Only key blocks are saved, together with the trusted block they were verified from
+    const state = JSON.parse(fs.readFileSync(stateFile, 'utf8'));
+    assert(state.block.workchain === -1 && state.block.seqno > 0 && state.block.seqno <= synced.seqno, `unexpected saved block ${JSON.stringify(state)}`);
+    assert(state.root.seqno === 0, 'saved state is not bound to the zero state');
+
+    // The next client starts from the saved block
+    const restarted = await createClient({ stateFile });
+    const restored = await restarted.ready();
+    assert(restored.seqno >= synced.seqno, `restored block ${restored.seqno} is older than ${synced.seqno}`);
+
+    // States verified from another trusted block are ignored
+    state.root.root_hash = Buffer.alloc(32).toString('base64');
+    fs.writeFileSync(stateFile, JSON.stringify(state));
+    const untrusted = await createClient({ stateFile });
+    assert((await untrusted.ready()).seqno >= synced.seqno, 'client with an ignored state did not sync');
+  } finally {
+    fs.rmdirSync(path.dirname(stateFile), { recursive: true });
+  }
+});
+
+run('memory-accounting', async () => {
+  const client = await createClient();
+  const handle = await client.send(new tl.LiteServerGetMasterchainInfo(), { handle: true });
+  assert(handle instanceof tl.NativeHandle, 'handle expected');
+
+  const memory = client.stats().memory;
+  assert(memory.handles > 0 && memory.total >= memory.handles && memory.peak >= memory.total, `unexpected memory stats ${JSON.stringify(memory)}`);
+  // Converted responses are released
+  assert(memory.responses === 0 && memory.requests === 0, 'responses are still accounted');
+  assert(handle.get('last').toObject().seqno > 0, 'handle is empty');
+});
+
+run('field-projection', async () => {
+  const client = await createClient();
+  const info = await client.send(new tl.LiteServerGetMasterchainInfo(), { fields: ['last.seqno', 'last.workchain'] });
+  assert(info.last.seqno > 0 && info.last.workchain === -1, 'selected fields are missing');
+  assert(info.last.rootHash === undefined && info.init === undefined && info.stateRootHash === undefined, 'unselected fields are converted');
+
+  const masked = await client.send(new tl.LiteServerGetMasterchainInfo(), { fields: { last: true } });
+  assert(masked.last.rootHash instanceof ArrayBuffer && masked.init === undefined, 'unexpected masked fields');
+});
@@ -0,0 +1,79 @@
+const { tl, assert, assertEqual, assertThrows, run } = require('./common');
+
+// Conversions which run without a network
+
+const ROOT_HASH = Buffer.alloc(32, 0xab);
+const FILE_HASH = Buffer.from([...Array(32).keys()]);
+
+function blockId() {
+  return new tl.TonBlockIdExt({
+    workchain: -1,
+    shard: '-9223372036854775808',
+    seqno: 1234,
+    rootHash: ROOT_HASH.toString('base64'),
+    fileHash: FILE_HASH.toString('base64')
+  });
+}
+
+function toBase64Url(buffer) {
+  return buffer.toString('base64').replace(/\+/g, '-').replace(/\//g, '_').replace(/=+$/, '');
+}
+
+run('encoding', async () => {
+  // Every encoding produces the same serialized request
+  const serialized = Buffer.from(tl.TonlibClient.serialize(new tl.BlocksGetShards({ id: blockId() })));
+  assert(serialized.length > 64, 'serialized request is too short');
+  assert(tl.TonlibClient.serialize(new tl.BlocksGetShards({ id: blockId() }), { bytesEncoding: 'hex' }) === serialized.toString('hex'), 'hex');
+  assert(tl.TonlibClient.serialize(new tl.BlocksGetShards({ id: blockId() }), { bytesEncoding: 'base64' }) === serialized.toString('base64'), 'base64');
+  assert(tl.TonlibClient.serialize(new tl.BlocksGetShards({ id: blockId() }), { bytesEncoding: 'base64url' }) === toBase64Url(serialized), 'base64url');
+
+  // Input strings are decoded with the same encoding, and both base64 alphabets are accepted with or without padding
+  const hexId = new tl.TonBlockIdExt(Object.assign({}, blockId()._props, { rootHash: ROOT_HASH.toString('hex'), fileHash: FILE_HASH.toString('hex') }));
+  assert(Buffer.from(tl.TonlibClient.serialize(new tl.BlocksGetShards({ id: hexId }), { bytesEncoding: 'hex' }), 'hex').equals(serialized), 'hex input');
+  const urlId = new tl.TonBlockIdExt(Object.assign({}, blockId()._props, { rootHash: toBase64Url(ROOT_HASH), fileHash: toBase64Url(FILE_HASH) }));
+  assert(Buffer.from(tl.TonlibClient.serialize(new tl.BlocksGetShards({ id: urlId }))).equals(serialized), 'unpadded base64url input');
+  const typedId = new tl.TonBlockIdExt(Object.assign({}, blockId()._props, { rootHash: new Uint8Array(ROOT_HASH), fileHash: FILE_HASH.subarray(0) }));
+  assert(Buffer.from(tl.TonlibClient.serialize(new tl.BlocksGetShards({ id: typedId }))).equals(serialized), 'typed array input');
+
+  assertThrows(() => tl.TonlibClient.serialize(new tl.BlocksGetShards({ id: hexId }), { bytesEncoding: 'base32' }), /Unknown bytes encoding/, 'unknown encoding');
+  const invalidId = new tl.TonBlockIdExt(Object.assign({}, blockId()._props, { rootHash: 'zz' }));
+  assertThrows(() => tl.TonlibClient.serialize(new tl.BlocksGetShards({ id: invalidId }), { bytesEncoding: 'hex' }), /Failed to parse request/, 'invalid hex');
+
+  // Padding only completes the last group, and unused bits of the last character are zero
+  const encrypt = decryptedData => tl.TonlibClient.execute(new tl.Encrypt({ decryptedData, secret: 'c2VjcmV0' }), { bytesEncoding: 'base64' });
+  assert(typeof encrypt('YWI=').bytes === 'string' && typeof encrypt('YWI').bytes === 'string', 'valid padding was rejected');
+  for (const invalid of ['YWI==', 'YQ===', 'YWJj=', 'YW=I', 'YWJ=', 'YR==']) {
+    assertThrows(() => encrypt(invalid), /Failed to parse request/, `invalid base64 ${invalid}`);
+  }
+
+  // Secret bytes are decoded and encoded the same way
+  const secret = Buffer.from('secret');
+  const data = Buffer.from('hello, tonlib');
+  for (const bytesEncoding of ['hex', 'base64', 'base64url']) {
+    const encode = buffer => (bytesEncoding === 'hex' ? buffer.toString('hex') : bytesEncoding === 'base64' ? buffer.toString('base64') : toBase64Url(buffer));
+    const encrypted = tl.TonlibClient.execute(new tl.Encrypt({ decryptedData: encode(data), secret: encode(secret) }), { bytesEncoding });
+    assert(typeof encrypted.bytes === 'string', `${bytesEncoding} output is not a string`);
+    const decrypted = tl.TonlibClient.execute(new tl.Decrypt({ encryptedData: encrypted.bytes, secret: encode(secret) }), { bytesEncoding });
+    assert(decrypted.bytes === encode(data), `${bytesEncoding} roundtrip`);
+  }
+  const decrypted = tl.TonlibClient.execute(new tl.Decrypt({
+    encryptedData: tl.TonlibClient.execute(new tl.Encrypt({ decryptedData: data, secret })).bytes,
+    secret
+  }));
+  assert(decrypted.bytes instanceof ArrayBuffer && Buffer.from(decrypted.bytes).equals(data), 'arraybuffer roundtrip');
+});
+
+run('native-handle', async () => {
+  // Requests built from a handle are cloned from the native object and serialize identically
+  const handle = new tl.NativeHandle(blockId());
+  const fromHandle = Buffer.from(tl.TonlibClient.serialize(new tl.BlocksGetShards({ id: handle })));
+  const fromObject = Buffer.from(tl.TonlibClient.serialize(new tl.BlocksGetShards({ id: blockId() })));
+  assert(fromHandle.equals(fromObject), 'handle serializes differently');
+  // The handle stays usable after it was cloned into a request
+  assert(Buffer.from(tl.TonlibClient.serialize(new tl.BlocksGetShards({ id: handle }))).equals(fromObject), 'handle was consumed');
+  assertEqual(handle.toObject(), blockId(), 'toObject');
+
+  const info = new tl.NativeHandle(new tl.LiteServerMasterchainInfo({ last: blockId(), stateRootHash: ROOT_HASH.toString('base64'), init: blockId() }));
+  assertEqual(info.get('last').toObject(), blockId(), 'nested handle');
+  assert(info.get('missing') === null, 'missing field');
+});
@@ -0,0 +1,24 @@
+const { tl, assert, assertThrows, run } = require('./common');
+
+// Validation of client and request options, which runs without a network
+
+run('options', async () => {
+  // Invalid options are rejected before anything is sent
+  const client = new tl.TonlibClient();
+  const request = new tl.LiteServerGetMasterchainInfo();
+
+  assertThrows(() => client.send(request, { priority: 'urgent' }), /Unknown priority urgent/, 'priority');
+  assertThrows(() => new tl.TonlibClient({ maxInFlight: 0 }), /maxInFlight must be greater than zero/, 'maxInFlight');
+  assertThrows(() => new tl.TonlibClient({ hedgeQuantile: 1.5 }), /hedgeQuantile must be in range/, 'hedgeQuantile');
+  assertThrows(() => new tl.TonlibClient({ bytesEncoding: 'utf8' }), /Unknown bytes encoding/, 'bytesEncoding');
+  assertThrows(() => client.send(request, { timeSliceMs: -1 }), /timeSliceMs must be non-negative/, 'time slice');
+  assertThrows(() => new tl.TonlibClient({ cacheMaxSize: -1 }), /Expected non-negative number for cacheMaxSize/, 'cacheMaxSize');
+  assertThrows(() => client.send(request, { fields: [] }), /Field projection is empty/, 'empty projection');
+  assertThrows(() => client.send(request, { fields: ['last..seqno'] }), /Invalid field path/, 'invalid path');
+  assertThrows(() => client.send(request, { fields: { last: {} } }), /Empty field mask for last/, 'empty mask');
+  assertThrows(() => client.send(request, { fields: 'last' }), /Expected array of field paths or field mask/, 'projection type');
+  assertThrows(() => new tl.TonlibClient({ smcPoolMaxAgeMs: 0 }), /smcPoolMaxAgeMs must be greater than zero/, 'smcPoolMaxAgeMs');
+
+  // Pooling of get-method states is opt-in
+  assert(client.stats().smcPool.entries === 0 && client.stats().smcPool.misses === 0, 'smc pool is used by default');
+});
@@ -0,0 +1,147 @@
+const { tl, createClient, assert, run } = require('./common');
+
+const WALLET = '0:2e4492152c323667733ba555ad0165642ae7e5e346e6b1077ab6866ae39a3dc3';
+const MAX_TRANSACTIONS = 40;
+// Masterchain blocks scanned until a shard produces several blocks per masterchain block
+const SHARD_CHAIN_MASTERCHAIN_BLOCKS = 200;
+
+// External inbound message to `address` with an empty body, as a single-cell BoC
+function externalMessage(workchain, addressHex) {
+  const bits = [];
+  const push = (value, length) => {
+    for (let i = length - 1; i >= 0; --i) {
+      bits.push((value >> i) & 1);
+    }
+  };
+  push(0b10, 2); // ext_in_msg_info$10
+  push(0b00, 2); // src: addr_none
+  push(0b100, 3); // dest: addr_std without anycast
+  push(workchain & 0xff, 8);
+  for (const byte of Buffer.from(addressHex, 'hex')) {
+    push(byte, 8);
+  }
+  push(0, 4); // import_fee: 0
+  push(0, 1); // init: nothing
+  push(0, 1); // body: inline, empty
+
+  const dataBits = bits.length;
+  bits.push(1); // completion tag
+  while (bits.length % 8 !== 0) {
+    bits.push(0);
+  }
+  const data = Buffer.alloc(bits.length / 8);
+  bits.forEach((bit, i) => {
+    data[i >> 3] |= bit << (7 - (i & 7));
+  });
+
+  const cell = Buffer.concat([Buffer.from([0, Math.ceil(dataBits / 8) + Math.floor(dataBits / 8)]), data]);
+  const header = Buffer.from([0xb5, 0xee, 0x9c, 0x72, 0x01, 0x01, 0x01, 0x01, 0x00, cell.length, 0x00]);
+  return Buffer.concat([header, cell]).toString('base64');
+}
+
+run('transactions-iterator', async () => {
+  const client = await createClient();
+  const state = await client.send(new tl.RawGetAccountState({ accountAddress: new tl.AccountAddress({ accountAddress: WALLET }) }));
+  assert(state.lastTransactionId != null && state.lastTransactionId.lt !== '0', 'wallet has no transactions');
+
+  let count = 0;
+  let previousLt = null;
+  const iterator = client.iterateTransactions(new tl.RawGetTransactions({
+    accountAddress: new tl.AccountAddress({ accountAddress: WALLET }),
+    fromTransactionId: state.lastTransactionId
+  }), { prefetchPages: 2 });
+  for await (const transaction of iterator) {
+    const lt = BigInt(transaction.transactionId.lt);
+    if (count === 0) {
+      assert(transaction.transactionId.lt === state.lastTransactionId.lt, 'iteration does not start at the given transaction');
+    } else {
+      assert(lt < previousLt, 'transactions are not ordered by lt');
+    }
+    previousLt = lt;
+    // Breaking out closes the stream, which stops the prefetching
+    if (++count === MAX_TRANSACTIONS) {
+      break;
+    }
+  }
+  assert(count > 0, 'no transactions');
+});
+
+run('block-scanner', async () => {
+  const client = await createClient();
+  const info = await client.send(new tl.LiteServerGetMasterchainInfo());
+  const to = info.last.seqno - 1;
+  const from = to - 15;
+
+  let next = from;
+  for await (const block of client.scanBlocks(from, to, { concurrency: 4 })) {
+    // Blocks are fetched in parallel, but delivered in order
+    assert(block.id.seqno === next, `expected block ${next}, got ${block.id.seqno}`);
+    assert(block.id.workchain === -1 && Array.isArray(block.transactions), 'malformed masterchain block');
+    for (const shard of block.shards) {
+      assert(shard.id.workchain !== -1 && Array.isArray(shard.transactions), 'malformed shard block');
+    }
+    next++;
+  }
+  assert(next === to + 1, `scan stopped at ${next}`);
+
+  let failed = false;
+  try {
+    for await (const block of client.scanBlocks(to, from)) {
+      assert(block == null, 'reversed range produced blocks');
+    }
+  } catch (e) {
+    failed = true;
+  }
+  assert(failed, 'reversed range was accepted');
+});
+
+run('block-scanner-shard-chains', async () => {
+  const client = await createClient();
+  const info = await client.send(new tl.LiteServerGetMasterchainInfo());
+  const to = info.last.seqno - 1;
+  const from = to - SHARD_CHAIN_MASTERCHAIN_BLOCKS + 1;
+
+  const lastSeqnos = new Map();
+  let multiBlockShards = 0;
+  for await (const block of client.scanBlocks(from, to, { concurrency: 8 })) {
+    const perShard = new Map();
+    for (const shard of block.shards) {
+      const key = `${shard.id.workchain}:${shard.id.shard}`;
+      perShard.set(key, (perShard.get(key) || 0) + 1);
+
+      // Split and merged shards start new keys, so only continued shards are checked
+      const last = lastSeqnos.get(key);
+      assert(last == null || shard.id.seqno === last + 1, `shard block ${key}:${last + 1} is missing or repeated`);
+      lastSeqnos.set(key, shard.id.seqno);
+    }
+    for (const count of perShard.values()) {
+      if (count > 1) {
+        multiBlockShards++;
+      }
+    }
+  }
+  assert(multiBlockShards > 0, `no shard produced several blocks within ${SHARD_CHAIN_MASTERCHAIN_BLOCKS} masterchain blocks`);
+});
+
+run('message-submitter', async () => {
+  const client = await createClient();
+  const message = externalMessage(0, '00'.repeat(31) + '01');
+  const messages = [message, 'AAAA', message, message];
+
+  const results = [];
+  for await (const result of client.submitMessages(messages, { concurrency: 2 })) {
+    results.push(result);
+  }
+  results.sort((a, b) => a.index - b.index);
+  assert(results.length === messages.length, 'missing results');
+
+  assert(results[0].hash != null && results[0].duplicateOf === undefined, 'first message was reported as a duplicate');
+  assert(results[1].status === 'failed' && results[1].hash === null, 'invalid message was not rejected');
+  for (const duplicate of [results[2], results[3]]) {
+    // Duplicates report the outcome of the sent message
+    const expectedStatus = results[0].status === 'failed' ? 'failed' : 'duplicate';
+    assert(duplicate.status === expectedStatus && duplicate.duplicateOf === 0, 'duplicate was sent');
+    assert(Buffer.from(duplicate.hash).equals(Buffer.from(results[0].hash)), 'duplicate hash differs');
+    assert(duplicate.error === results[0].error, 'duplicate outcome differs');
+  }
+});
@@ -0,0 +1,175 @@
+const { Worker, isMainThread, parentPort, workerData } = require('worker_threads');
+const { tl, createClient, assert, run } = require('./common');
+
+// Layout of `submission_ring.hpp`
+const RING_MAGIC = 0x524a5354;
+const RING_HEADER_WORDS = 16;
+const RING_SLOT_WORDS = 4;
+const WORD_MAGIC = 0;
+const WORD_SLOT_COUNT = 1;
+const WORD_SLOT_SIZE = 2;
+const WORD_TAIL = 3;
+const WORD_COMPLETIONS = 4;
+const WORD_SUBMISSIONS = 6;
+const SLOT_SEQUENCE = 0;
+const SLOT_REQUEST_LENGTH = 1;
+const SLOT_RESPONSE_LENGTH = 2;
+
+const SLOTS = 8;
+const SLOT_SIZE = 64;
+const PRODUCERS = 4;
+const REQUESTS_PER_PRODUCER = 500;
+// Requests each producer keeps outstanding, together more than there are slots
+const PIPELINE_DEPTH = 3;
+// Positions start right before 2^32, so sequences wrap around within the test
+const FIRST_POSITION = 0x100000000 - 16 * SLOTS;
+
+function ringSize() {
+  return (RING_HEADER_WORDS + SLOTS * RING_SLOT_WORDS) * 4 + 2 * SLOTS * SLOT_SIZE;
+}
+
+// Same as `SubmissionRing::init_memory`, but with an arbitrary first position
+function initRing(buffer, firstPosition) {
+  const words = new Int32Array(buffer);
+  words[WORD_SLOT_COUNT] = SLOTS;
+  words[WORD_SLOT_SIZE] = SLOT_SIZE;
+  words[WORD_TAIL] = firstPosition | 0;
+  for (let i = 0; i < SLOTS; ++i) {
+    const position = firstPosition + i;
+    words[RING_HEADER_WORDS + (position % SLOTS) * RING_SLOT_WORDS + SLOT_SEQUENCE] = position | 0;
+  }
+  Atomics.store(words, WORD_MAGIC, RING_MAGIC);
+}
+
+// Consumer of the native side: takes each submitted slot on its own and answers them out of order
+function startConsumer(buffer, total) {
+  const words = new Int32Array(buffer);
+  const bytes = new Uint8Array(buffer);
+  const requestsOffset = (RING_HEADER_WORDS + SLOTS * RING_SLOT_WORDS) * 4;
+  const responsesOffset = requestsOffset + SLOTS * SLOT_SIZE;
+  let consumed = 0;
+  const pending = [];
+
+  const complete = position => {
+    const slot = position % SLOTS;
+    const base = RING_HEADER_WORDS + slot * RING_SLOT_WORDS;
+    const length = Atomics.load(words, base + SLOT_REQUEST_LENGTH);
+    const request = bytes.slice(requestsOffset + slot * SLOT_SIZE, requestsOffset + slot * SLOT_SIZE + length);
+    // The response is the reversed request, so producers can check they got their own
+    bytes.set(request.reverse(), responsesOffset + slot * SLOT_SIZE);
+    Atomics.store(words, base + SLOT_RESPONSE_LENGTH, length);
+    Atomics.store(words, base + SLOT_SEQUENCE, (position + 2) | 0);
+    Atomics.add(words, WORD_COMPLETIONS, 1);
+    Atomics.notify(words, WORD_COMPLETIONS);
+  };
+
+  return new Promise(resolve => {
+    let polls = 0;
+    const poll = () => {
+      polls++;
+      for (let slot = 0; slot < SLOTS; ++slot) {
+        const sequence = Atomics.load(words, RING_HEADER_WORDS + slot * RING_SLOT_WORDS + SLOT_SEQUENCE) >>> 0;
+        const position = (sequence - 1 + 0x100000000) % 0x100000000;
+        if (position % SLOTS === slot && !pending.some(request => request.position === position)) {
+          // Requests are answered after a random delay, so later positions must not wait for earlier ones
+          pending.push({ position, due: polls + Math.floor(Math.random() * 8) });
+          consumed++;
+        }
+      }
+      for (const request of pending.filter(request => request.due <= polls)) {
+        pending.splice(pending.indexOf(request), 1);
+        complete(request.position);
+      }
+      if (consumed === total && pending.length === 0) {
+        resolve(Atomics.load(words, WORD_TAIL) >>> 0);
+        return;
+      }
+      setImmediate(poll);
+    };
+    poll();
+  });
+}
+
+function runWorker(data) {
+  return new Promise((resolve, reject) => {
+    const worker = new Worker(__filename, { workerData: data });
+    worker.once('message', resolve);
+    worker.once('error', reject);
+  });
+}
+
+function producerMain() {
+  const producer = new tl.SubmissionRingProducer(workerData.buffer);
+  if (workerData.mode === 'echo') {
+    const tickets = [];
+    const check = () => {
+      const { request, ticket } = tickets.splice(Math.floor(Math.random() * tickets.length), 1)[0];
+      const response = Buffer.from(producer.collect(ticket));
+      if (!response.equals(Buffer.from(request).reverse())) {
+        throw new Error(`Unexpected response for ${request}`);
+      }
+    };
+    for (let i = 0; i < REQUESTS_PER_PRODUCER; ++i) {
+      const request = Buffer.from(`${workerData.id}:${i}:${'x'.repeat(i % 32)}`);
+      tickets.push({ request, ticket: producer.submit(request) });
+      if (tickets.length === PIPELINE_DEPTH) {
+        check();
+      }
+    }
+    while (tickets.length > 0) {
+      check();
+    }
+    parentPort.postMessage(REQUESTS_PER_PRODUCER);
+  } else {
+    const request = tl.TonlibClient.serialize(new tl.LiteServerGetMasterchainInfo());
+    const responses = [];
+    for (let i = 0; i < workerData.count; ++i) {
+      responses.push(producer.request(request));
+    }
+    parentPort.postMessage(responses);
+  }
+}
+
+if (!isMainThread) {
+  producerMain();
+} else {
+  run('submission-ring-protocol', async () => {
+    const buffer = new SharedArrayBuffer(ringSize());
+    initRing(buffer, FIRST_POSITION);
+
+    const total = PRODUCERS * REQUESTS_PER_PRODUCER;
+    const consumer = startConsumer(buffer, total);
+    const counts = await Promise.all([...Array(PRODUCERS).keys()].map(id => runWorker({ mode: 'echo', buffer, id })));
+    const head = await consumer;
+
+    assert(counts.every(count => count === REQUESTS_PER_PRODUCER), 'producer did not finish');
+    assert(head === (FIRST_POSITION + total) % 0x100000000, `unexpected head ${head}`);
+    assert(head < FIRST_POSITION, 'positions did not wrap around');
+    assert(new Int32Array(buffer)[WORD_SUBMISSIONS] === total, 'submissions were not announced');
+    // Every slot was handed over to the next round after its last response was taken
+    const words = new Int32Array(buffer);
+    for (let position = head; position < head + SLOTS; ++position) {
+      const sequence = words[RING_HEADER_WORDS + (position % SLOTS) * RING_SLOT_WORDS + SLOT_SEQUENCE];
+      assert(sequence === (position | 0), `slot ${position % SLOTS} is not free for position ${position}`);
+    }
+  });
+
+  run('submission-ring-client', async () => {
+    const client = await createClient();
+    const ring = tl.createSubmissionRing(client, { slots: 4, slotSize: 4096, stallTimeoutMs: 300 });
+    // A producer which takes a position and never submits it must not block the following rounds of its slot
+    Atomics.add(new Int32Array(ring.buffer), WORD_TAIL, 1);
+    const count = 8;
+    const results = await Promise.all([0, 1].map(() => runWorker({ mode: 'client', buffer: ring.buffer, count })));
+    ring.close();
+
+    for (const responses of results) {
+      assert(responses.length === count, 'missing responses');
+      for (const data of responses) {
+        const info = tl.TonlibClient.deserialize(data);
+        assert(info instanceof tl.LiteServerMasterchainInfo, `unexpected response ${JSON.stringify(info)}`);
+        assert(info.last.seqno > 0, 'empty masterchain info');
+      }
+    }
+  });
+}